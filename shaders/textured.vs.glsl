@@ -10,10 +10,11 @@ out vec2 texcoord;
 // Application data
 uniform mat3 transform;
 uniform mat3 projection;
+uniform vec4 uv_rect; // where the texture lies in its atlas page, offset in xy and size in zw
 
 void main()
 {
-	texcoord = in_texcoord;
+	texcoord = uv_rect.xy + in_texcoord * uv_rect.zw;
 	vec3 pos = projection * transform * vec3(in_position.xy, 1.0);
 	gl_Position = vec4(pos.xy, in_position.z, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,30 @@
+#version 330
+
+// Input attributes
+in vec3 in_position;
+in vec2 in_texcoord;
+
+// Per instance attributes (see SpriteInstance)
+in vec2 in_transform_0; // columns of the model matrix, the bottom row is (0, 0, 1)
+in vec2 in_transform_1;
+in vec2 in_transform_2;
+in vec3 in_color;
+in float in_texture_index;
+
+// Passed to fragment shader
+out vec2 texcoord;
+out vec3 vcolor;
+
+// Application data
+uniform mat3 projection;
+uniform vec4 uv_rects[16]; // atlas rect of every texture, indexed by in_texture_index
+
+void main()
+{
+	vec4 uv_rect = uv_rects[int(in_texture_index)];
+	texcoord = uv_rect.xy + in_texcoord * uv_rect.zw;
+	vcolor = in_color;
+	mat3 transform = mat3(vec3(in_transform_0, 0.0), vec3(in_transform_1, 0.0), vec3(in_transform_2, 1.0));
+	vec3 pos = projection * transform * vec3(in_position.xy, 1.0);
+	gl_Position = vec4(pos.xy, in_position.z, 1.0);
+}
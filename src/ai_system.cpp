@@ -1,7 +1,200 @@
 // internal
 #include "ai_system.hpp"
+#include "physics_system.hpp"
+#include "profiler.hpp"
+#include "world_init.hpp"
+
+// stlib
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace {
+	// Distances in car lengths: how far ahead a car looks, where it starts to
+	// brake for what is ahead in its lane and where it comes to a stop behind it
+	const float LOOK_AHEAD = 3.f;
+	const float BRAKE_DISTANCE = 2.f;
+	const float STOP_DISTANCE = .5f;
+
+	// Steering, in pixels per second (squared)
+	const float MAX_ACCELERATION = 600.f;
+	const float MAX_LANE_CHANGE_SPEED = 250.f;
+	const float VELOCITY_RESPONSE = 4.f; // per second, how quickly it closes in on the velocity it wants
+	const float LANE_RESPONSE = 2.f; // per second, sideways speed per pixel off the lane centre
+
+	// The budget is checked after this many decisions, not after every one
+	const uint DECISIONS_PER_CLOCK_CHECK = 16;
+}
+
+AISystem::AISystem()
+	: lane_count(LANE_COUNT)
+	, lane_width(LANE_WIDTH) {
+}
+
+void AISystem::init(PhysicsSystem* physics_arg)
+{
+	this->physics = physics_arg;
+}
+
+void AISystem::set_lanes(int count, float width)
+{
+	assert(count > 0 && width > 0.f);
+	lane_count = count;
+	lane_width = width;
+}
 
 void AISystem::step(float elapsed_ms)
 {
-	(void)elapsed_ms; // placeholder to silence unused warning until implemented
-}
\ No newline at end of file
+	PROFILE_SCOPE("AISystem::step");
+	auto& cars = registry.trafficCars;
+	uint count = (uint)cars.size();
+	stats.agents = count;
+	stats.decisions = 0;
+	if (count == 0) {
+		stats.decide_ms = 0.f;
+		stats.steer_ms = 0.f;
+		return;
+	}
+
+	// Deciding gets what is left of the budget once steering, timed last step, is done.
+	// Cars removed since the last step swapped places with others, some get to decide
+	// twice as often for a round, which does no harm.
+	{
+		PROFILE_SCOPE_TIMED("decide", stats.decide_ms);
+		auto start = Clock::now();
+		if (cursor >= count)
+			cursor = 0;
+		float decide_budget_ms = budget_ms - stats.steer_ms;
+		uint decided = 0;
+		while (decided < count) {
+			decide(cursor);
+			cursor = (cursor + 1) % count;
+			decided++;
+			if (budget_ms > 0.f && decided % DECISIONS_PER_CLOCK_CHECK == 0 &&
+				profiler::milliseconds(Clock::now() - start) >= decide_budget_ms)
+				break;
+		}
+		stats.decisions = decided;
+	}
+
+	steer(elapsed_ms);
+}
+
+void AISystem::decide(uint i)
+{
+	Entity entity = registry.trafficCars.entities[i];
+	TrafficCar& car = registry.trafficCars.components[i];
+	const Motion& motion = registry.motions.get(entity);
+	vec2 position = motion.position;
+	float half_length = fabsf(motion.scale.x) / 2.f;
+	float half_width = fabsf(motion.scale.y) / 2.f;
+	float look_ahead = LOOK_AHEAD * 2.f * half_length;
+	car.lane = std::min(std::max(car.lane, 0), lane_count - 1);
+
+	// Everything deadly from right next to the car to look_ahead in front of it,
+	// across the lanes either side of it too, to know where it could move over to
+	vec2 lo = { position.x - half_length, std::min(position.y, lane_center(car.lane - 1)) - half_width };
+	vec2 hi = { position.x + half_length + look_ahead, std::max(position.y, lane_center(car.lane + 1)) + half_width };
+	physics->get_spatial_index().overlap_aabb(lo, hi, MASK_DEADLY, nearby);
+
+	// Free road in front of the car in its lane and the ones either side, zero if
+	// something is next to it. And the closest thing ahead of where it drives now.
+	float clear[3] = { look_ahead, look_ahead, look_ahead };
+	float gap_ahead = look_ahead;
+	float speed_ahead = 0.f;
+	float swerve = 0.f;
+	for (const SpatialIndex::Body* body : nearby) {
+		Entity other = body->entity;
+		if (other == entity)
+			continue;
+		float gap = std::max(0.f, body->aabb_min.x - (position.x + half_length));
+		for (int k = 0; k < 3; k++) {
+			float center = lane_center(car.lane - 1 + k);
+			if (body->aabb_min.y < center + half_width && body->aabb_max.y > center - half_width)
+				clear[k] = std::min(clear[k], gap);
+		}
+
+		// Space between the body and the car's sides, negative if it is in the car's way
+		float below = body->aabb_min.y - (position.y + half_width);
+		float above = (position.y - half_width) - body->aabb_max.y;
+		float side_gap = std::max(below, above);
+		if (side_gap < 0.f) {
+			if (gap < gap_ahead) {
+				gap_ahead = gap;
+				// along the road, barriers stand still on it
+				speed_ahead = body->motion.velocity.x - BARRIER_SPEED;
+			}
+		}
+		else if (gap == 0.f && side_gap < half_width)
+			// right next to it, keep out of each other's way
+			swerve += (below > above ? -1.f : 1.f) * (1.f - side_gap / half_width);
+	}
+
+	// Move over when something blocks the lane and a lane next to it is clearer
+	int best = 1;
+	if (clear[1] < look_ahead)
+		for (int k = 0; k < 3; k += 2) {
+			int lane = car.lane - 1 + k;
+			if (lane >= 0 && lane < lane_count && clear[k] > clear[best])
+				best = k;
+		}
+	car.lane += best - 1;
+
+	// Slow down to the speed of what is ahead, coming to a stop behind it if it doesn't move
+	float brake = BRAKE_DISTANCE * 2.f * half_length;
+	float stop = STOP_DISTANCE * 2.f * half_length;
+	float t = clamp((gap_ahead - stop) / (brake - stop), 0.f, 1.f);
+	float follow = clamp(speed_ahead, 0.f, car.cruise_speed);
+	car.target_speed = follow + (car.cruise_speed - follow) * t;
+	car.swerve = clamp(swerve, -1.f, 1.f);
+}
+
+void AISystem::steer(float elapsed_ms)
+{
+	PROFILE_SCOPE_TIMED("steer", stats.steer_ms);
+	auto& cars = registry.trafficCars;
+	uint count = (uint)cars.size();
+	motions.resize(count);
+	y.resize(count);
+	vx.resize(count);
+	vy.resize(count);
+	target_y.resize(count);
+	target_speed.resize(count);
+	swerve.resize(count);
+
+	for (uint i = 0; i < count; i++) {
+		Motion& motion = registry.motions.get(cars.entities[i]);
+		const TrafficCar& car = cars.components[i];
+		motions[i] = &motion;
+		y[i] = motion.position.y;
+		vx[i] = motion.velocity.x;
+		vy[i] = motion.velocity.y;
+		target_y[i] = lane_center(car.lane);
+		target_speed[i] = car.target_speed;
+		swerve[i] = car.swerve;
+	}
+
+	// No branches or lookups in here, the compiler can vectorize it
+	float step_seconds = elapsed_ms / 1000.f;
+	for (uint i = 0; i < count; i++) {
+		// seek the target speed along the road
+		float ax = (target_speed[i] - (vx[i] - BARRIER_SPEED)) * VELOCITY_RESPONSE;
+		// keep to the lane, or move over to the new one, and out of the way of cars alongside
+		float lane_vy = clamp((target_y[i] - y[i]) * LANE_RESPONSE, -MAX_LANE_CHANGE_SPEED, MAX_LANE_CHANGE_SPEED);
+		float ay = (lane_vy - vy[i]) * VELOCITY_RESPONSE + swerve[i] * MAX_ACCELERATION;
+		// no harder than the tyres allow
+		float length = sqrtf(ax * ax + ay * ay);
+		float scale = length > MAX_ACCELERATION ? MAX_ACCELERATION / length : 1.f;
+		vx[i] += ax * scale * step_seconds;
+		vy[i] += ay * scale * step_seconds;
+	}
+
+	for (uint i = 0; i < count; i++) {
+		Motion& motion = *motions[i];
+		motion.velocity = { vx[i], vy[i] };
+		// faces where it drives on the road, a car that stands still keeps its heading
+		float forward = std::max(vx[i] - BARRIER_SPEED, 0.f);
+		if (forward * forward + vy[i] * vy[i] > 1.f)
+			motion.angle = atan2f(-vy[i], -forward);
+	}
+}
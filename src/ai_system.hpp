@@ -1,12 +1,69 @@
 #pragma once
 
+#include <chrono>
 #include <vector>
 
 #include "tiny_ecs_registry.hpp"
 #include "common.hpp"
+#include "spatial_index.hpp"
 
+class PhysicsSystem;
+
+// Work done by the last step
+struct AIStats
+{
+	uint agents = 0;
+	uint decisions = 0; // cars that looked around this step
+	float decide_ms = 0.f;
+	float steer_ms = 0.f;
+};
+
+// Drives every entity with a TrafficCar, in two parts:
+// - deciding looks around through the spatial index, picks a lane to be in and
+//   a speed to drive at. It is the costly part, so it goes round the cars and
+//   stops once the step's budget is used up, the next step carries on from there.
+// - steering seeks that lane and speed. It runs every step over all cars copied
+//   into one array per field, which is cheap enough to not need a budget.
+// The clock is only read every few decisions, so with only a handful of cars
+// all of them decide every step and runs stay reproducible.
 class AISystem
 {
 public:
+	AISystem(); // the lanes of the game's road
+
+	void init(PhysicsSystem* physics);
+
 	void step(float elapsed_ms);
-};
\ No newline at end of file
+
+	// Time a step may take, in ms, 0 lets every car decide every step
+	void set_budget_ms(float budget) { budget_ms = budget; }
+	float get_budget_ms() const { return budget_ms; }
+
+	// count lanes of width pixels, numbered from y = 0 down
+	void set_lanes(int count, float width);
+	float lane_center(int lane) const { return (lane + .5f) * lane_width; }
+
+	const AIStats& get_stats() const { return stats; }
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	// Picks lane, target speed and swerve of car i in registry.trafficCars
+	void decide(uint i);
+	void steer(float elapsed_ms);
+
+	PhysicsSystem* physics = nullptr;
+	float budget_ms = 2.f;
+	int lane_count;
+	float lane_width;
+	uint cursor = 0; // the car that decides next
+	AIStats stats;
+
+	// reused result buffer for spatial queries
+	std::vector<const SpatialIndex::Body*> nearby;
+
+	// What steering works on, one entry per car in the order of registry.trafficCars
+	std::vector<Motion*> motions;
+	std::vector<float> y, vx, vy;
+	std::vector<float> target_y, target_speed, swerve;
+};
@@ -0,0 +1,201 @@
+// internal
+#include "asset_archive.hpp"
+
+// stlib
+#include <cstring>
+#include <fstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace {
+	const uint32_t archive_magic = 0x4b504343; // "CCPK"
+	const uint32_t archive_version = 2;
+	const size_t blob_alignment = 16;
+
+	struct ArchiveHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t layout;
+		uint32_t entry_count;
+		uint64_t index_offset;
+		uint64_t source_hash;
+	};
+
+	struct ArchiveEntry
+	{
+		char name[48]; // zero terminated
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	size_t align_up(size_t value) {
+		return (value + blob_alignment - 1) & ~(blob_alignment - 1);
+	}
+
+	// Blobs start after the header
+	const size_t first_blob_offset = align_up(sizeof(ArchiveHeader));
+}
+
+bool AssetArchive::open(const std::string& path, uint32_t layout, uint64_t source_hash)
+{
+	close();
+
+#ifdef _WIN32
+	file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+		close();
+		return false;
+	}
+	mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr) {
+		close();
+		return false;
+	}
+	data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	size = (size_t)file_size.QuadPart;
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0) {
+		::close(fd);
+		return false;
+	}
+	void* mapped = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// The mapping keeps the file alive on its own
+	::close(fd);
+	if (mapped == MAP_FAILED)
+		return false;
+	data = (const unsigned char*)mapped;
+	size = (size_t)info.st_size;
+#endif
+	if (data == nullptr) {
+		close();
+		return false;
+	}
+
+	ArchiveHeader header;
+	if (size < sizeof(header)) {
+		close();
+		return false;
+	}
+	memcpy(&header, data, sizeof(header));
+	if (header.magic != archive_magic || header.version != archive_version || header.layout != layout ||
+		header.index_offset > size || (size - header.index_offset) / sizeof(ArchiveEntry) < header.entry_count)
+	{
+		fprintf(stderr, "%s is damaged or out of date, pack the assets again\n", path.c_str());
+		close();
+		return false;
+	}
+	if (header.source_hash != source_hash)
+	{
+		fprintf(stderr, "%s was packed before the last edit to the assets, pack them again\n", path.c_str());
+		close();
+		return false;
+	}
+	index = data + header.index_offset;
+	entry_count = header.entry_count;
+
+	// Checked once here, so find() can trust the table
+	for (uint32_t i = 0; i < entry_count; i++)
+	{
+		ArchiveEntry entry;
+		memcpy(&entry, index + i * sizeof(ArchiveEntry), sizeof(entry));
+		if (entry.offset > size || entry.size > size - entry.offset || entry.name[sizeof(entry.name) - 1] != '\0')
+		{
+			fprintf(stderr, "%s is damaged, pack the assets again\n", path.c_str());
+			close();
+			return false;
+		}
+	}
+	return true;
+}
+
+void AssetArchive::close()
+{
+#ifdef _WIN32
+	if (data != nullptr)
+		UnmapViewOfFile(data);
+	if (mapping != nullptr)
+		CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE)
+		CloseHandle(file);
+	mapping = nullptr;
+	file = INVALID_HANDLE_VALUE;
+#else
+	if (data != nullptr)
+		munmap((void*)data, size);
+#endif
+	data = nullptr;
+	size = 0;
+	index = nullptr;
+	entry_count = 0;
+}
+
+const void* AssetArchive::find(const std::string& name, size_t& out_size) const
+{
+	// A few dozen entries, a linear scan is plenty
+	for (uint32_t i = 0; i < entry_count; i++)
+	{
+		const ArchiveEntry* entry = (const ArchiveEntry*)(index + i * sizeof(ArchiveEntry));
+		if (name == entry->name)
+		{
+			out_size = (size_t)entry->size;
+			return data + entry->offset;
+		}
+	}
+	return nullptr;
+}
+
+void AssetArchiveWriter::add(const std::string& name, const void* blob, size_t length)
+{
+	assert(name.size() < sizeof(ArchiveEntry::name) && "archive entry name is too long");
+	const size_t offset = align_up(bytes.size());
+	bytes.resize(offset + length, 0);
+	if (length > 0)
+		memcpy(bytes.data() + offset, blob, length);
+	blobs.push_back({ name, first_blob_offset + offset, length });
+}
+
+bool AssetArchiveWriter::write(const std::string& path, uint32_t layout, uint64_t source_hash) const
+{
+	ArchiveHeader header;
+	header.magic = archive_magic;
+	header.version = archive_version;
+	header.layout = layout;
+	header.entry_count = (uint32_t)blobs.size();
+	header.index_offset = first_blob_offset + align_up(bytes.size());
+	header.source_hash = source_hash;
+
+	std::vector<ArchiveEntry> entries(blobs.size());
+	for (size_t i = 0; i < blobs.size(); i++)
+	{
+		memset(&entries[i], 0, sizeof(ArchiveEntry));
+		strncpy(entries[i].name, blobs[i].name.c_str(), sizeof(entries[i].name) - 1);
+		entries[i].offset = blobs[i].offset;
+		entries[i].size = blobs[i].length;
+	}
+
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if (!out.good())
+	{
+		fprintf(stderr, "Could not write the archive %s\n", path.c_str());
+		return false;
+	}
+	const std::vector<char> padding(blob_alignment, 0);
+	out.write((const char*)&header, sizeof(header));
+	out.write(padding.data(), first_blob_offset - sizeof(header));
+	out.write((const char*)bytes.data(), bytes.size());
+	out.write(padding.data(), align_up(bytes.size()) - bytes.size());
+	out.write((const char*)entries.data(), entries.size() * sizeof(ArchiveEntry));
+	return out.good();
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+
+// One file holding named blobs, written offline by tools/asset_packer.cpp. The
+// blobs are stored the way the GPU wants them (RGBA atlas pages, vertex and
+// index buffers), so loading is a memory map and nothing gets parsed or copied.
+//
+// Layout: header, 16 byte aligned blobs, then the index table of entries.
+class AssetArchive
+{
+public:
+	AssetArchive() = default;
+	~AssetArchive() { close(); }
+	AssetArchive(const AssetArchive&) = delete;
+	AssetArchive& operator=(const AssetArchive&) = delete;
+
+	// Maps the file read only. Fails if it is missing, damaged, or was packed
+	// with another layout (layout is a fingerprint of the structs inside) or
+	// from other source files (source_hash is a hash of their contents).
+	bool open(const std::string& path, uint32_t layout, uint64_t source_hash);
+	void close();
+	bool is_open() const { return data != nullptr; }
+
+	// Pointer into the mapping, valid until close(), or nullptr if there is no such entry
+	const void* find(const std::string& name, size_t& out_size) const;
+
+	// Same, for entries holding an array of T
+	template <class T>
+	const T* find_array(const std::string& name, size_t& out_count) const
+	{
+		size_t length = 0;
+		const void* entry = find(name, length);
+		if (entry == nullptr || length % sizeof(T) != 0)
+			return nullptr;
+		out_count = length / sizeof(T);
+		return (const T*)entry;
+	}
+
+private:
+	const unsigned char* data = nullptr;
+	size_t size = 0;
+	const unsigned char* index = nullptr; // the entry table at the end
+	uint32_t entry_count = 0;
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = nullptr;
+#endif
+};
+
+// Collects blobs in memory and writes them out as one archive
+class AssetArchiveWriter
+{
+public:
+	void add(const std::string& name, const void* blob, size_t length);
+
+	template <class T>
+	void add_array(const std::string& name, const std::vector<T>& items)
+	{
+		add(name, items.data(), items.size() * sizeof(T));
+	}
+
+	bool write(const std::string& path, uint32_t layout, uint64_t source_hash) const;
+
+private:
+	struct Blob
+	{
+		std::string name;
+		size_t offset;
+		size_t length;
+	};
+	std::vector<Blob> blobs;
+	std::vector<unsigned char> bytes; // all blobs, each starting 16 byte aligned
+};
@@ -0,0 +1,78 @@
+// internal
+#include "asset_loader.hpp"
+
+// stlib
+#include <cassert>
+#include <fstream>
+
+AssetLoader::AssetLoader(unsigned threads)
+	: pool(threads)
+{
+}
+
+AssetLoader::~AssetLoader()
+{
+	// jobs write into their owners, so never leave them running
+	if (runner.joinable())
+		runner.join();
+}
+
+void AssetLoader::add(const std::string& name, std::function<bool()> job)
+{
+	assert(!started && "jobs have to be added before start()");
+	jobs.push_back({ name, std::move(job) });
+}
+
+void AssetLoader::start()
+{
+	assert(!started);
+	started = true;
+	runner = std::thread([this] {
+		pool.parallel_for(jobs.size(), [this](size_t i) {
+			if (!jobs[i].run())
+			{
+				fprintf(stderr, "Failed to load %s\n", jobs[i].name.c_str());
+				failed = true;
+			}
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				done++;
+			}
+			finished.notify_one();
+		});
+	});
+}
+
+bool AssetLoader::wait(const std::function<void(size_t done, size_t total)>& progress)
+{
+	if (!started)
+		start();
+	size_t reported = (size_t)-1;
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		finished.wait(lock, [&] { return done != reported; });
+		reported = done;
+		if (progress)
+		{
+			lock.unlock();
+			progress(reported, jobs.size());
+			lock.lock();
+		}
+		if (reported == jobs.size())
+			break;
+	}
+	lock.unlock();
+	runner.join();
+	return !failed;
+}
+
+bool AssetLoader::read_file(const std::string& path, std::vector<unsigned char>& out_bytes)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file.good())
+		return false;
+	out_bytes.resize((size_t)file.tellg());
+	file.seekg(0);
+	return (bool)file.read((char*)out_bytes.data(), out_bytes.size());
+}
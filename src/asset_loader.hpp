@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "worker_pool.hpp"
+
+// Reads and decodes assets on worker threads while the main thread creates the
+// window and GL context. Jobs only produce CPU-side data (pixels, vertices, file
+// contents). Whatever needs the GL context or the audio device is done by the
+// owner of that data once wait() returns.
+class AssetLoader
+{
+public:
+	// threads = 0 uses one thread per core
+	AssetLoader(unsigned threads = 0);
+	~AssetLoader();
+
+	// Queues a job, name is shown on failure. Jobs may run in any order and
+	// concurrently, so each one must only write its own output.
+	void add(const std::string& name, std::function<bool()> job);
+
+	// Runs all queued jobs in the background and returns immediately
+	void start();
+
+	// Blocks until all jobs are done, calling progress(done, total) on this
+	// thread whenever more have finished. Returns false if any job failed.
+	bool wait(const std::function<void(size_t done, size_t total)>& progress = nullptr);
+
+	// Reads a whole file, a typical job
+	static bool read_file(const std::string& path, std::vector<unsigned char>& out_bytes);
+
+private:
+	struct Job
+	{
+		std::string name;
+		std::function<bool()> run;
+	};
+
+	WorkerPool pool;
+	std::vector<Job> jobs;
+	std::thread runner; // drives pool.parallel_for so start() does not block
+	bool started = false;
+
+	std::mutex mutex;
+	std::condition_variable finished;
+	size_t done = 0; // guarded by mutex
+	std::atomic<bool> failed{ false };
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "common.hpp"
+
+// Make sure these names remain in sync with the file names in mixer_audio_backend.cpp
+enum class SOUND_ASSET_ID {
+	CAR_CRASH = 0,
+	POINT_SCORED = CAR_CRASH + 1,
+	SOUND_COUNT = POINT_SCORED + 1
+};
+const int sound_count = (int)SOUND_ASSET_ID::SOUND_COUNT;
+
+// What WorldSystem plays its music and sounds with, SDL_mixer in the game
+class AudioBackend
+{
+public:
+	virtual ~AudioBackend() {}
+
+	// Background music, looped until paused
+	virtual void play_music() = 0;
+	virtual void pause_music() = 0;
+	virtual void resume_music() = 0;
+
+	virtual void play(SOUND_ASSET_ID sound) = 0;
+};
+
+// Plays nothing, for headless runs without an audio device
+class NullAudioBackend : public AudioBackend
+{
+public:
+	void play_music() override {}
+	void pause_music() override {}
+	void resume_music() override {}
+	void play(SOUND_ASSET_ID) override {}
+};
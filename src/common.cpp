@@ -1,4 +1,8 @@
 #include "common.hpp"
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
 #include <iostream>
 
 // Note, we could also use the functions from GLM but we write the transformations here to show the uderlying math
@@ -22,8 +26,95 @@ void Transform::translate(vec2 offset)
 	mat = mat * T;
 }
 
-bool gl_has_errors()
+bool parse_unsigned(const std::string& value, unsigned& out)
 {
+	char* end;
+	errno = 0;
+	unsigned long parsed = strtoul(value.c_str(), &end, 10);
+	// strtoul skips spaces and takes a minus sign, wrapping the number around
+	if (value.empty() || !isdigit((unsigned char)value[0]) || *end != '\0' || errno == ERANGE || parsed > UINT_MAX)
+		return false;
+	out = (unsigned)parsed;
+	return true;
+}
+
+bool parse_float(const std::string& value, float& out)
+{
+	char* end;
+	errno = 0;
+	float parsed = strtof(value.c_str(), &end);
+	if (value.empty() || *end != '\0' || errno == ERANGE || !std::isfinite(parsed))
+		return false;
+	out = parsed;
+	return true;
+}
+
+#ifdef GL_ERROR_CHECKS
+namespace {
+	// Set once the debug callback is installed, glGetError is not needed after that
+	bool debug_output_enabled = false;
+
+	// Messages from the driver, reported at the next check site so they come
+	// with a file and line
+	struct DebugMessage {
+		GLenum type;
+		GLenum severity;
+		std::string text;
+	};
+	std::vector<DebugMessage> pending_messages;
+
+	void APIENTRY gl_debug_callback(GLenum source, GLenum type, GLuint id, GLenum severity,
+		GLsizei length, const GLchar* message, const void* user_param)
+	{
+		(void)source; (void)id; (void)user_param;
+		pending_messages.push_back({ type, severity, std::string(message, length) });
+	}
+
+	const char* debug_type_str(GLenum type)
+	{
+		switch (type)
+		{
+		case GL_DEBUG_TYPE_ERROR: return "ERROR";
+		case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "DEPRECATED";
+		case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: return "UNDEFINED_BEHAVIOR";
+		case GL_DEBUG_TYPE_PORTABILITY: return "PORTABILITY";
+		case GL_DEBUG_TYPE_PERFORMANCE: return "PERFORMANCE";
+		default: return "OTHER";
+		}
+	}
+}
+
+bool gl_enable_debug_output()
+{
+	if (!gl3w_is_supported(4, 3) || glDebugMessageCallback == nullptr)
+		return false;
+
+	// Synchronous, so the callback runs inside the offending GL call and the
+	// message is waiting at the very next check
+	glEnable(GL_DEBUG_OUTPUT);
+	glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+	glDebugMessageCallback(gl_debug_callback, nullptr);
+	glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_FALSE);
+	debug_output_enabled = true;
+	return true;
+}
+
+bool gl_check_errors(const char* file, int line)
+{
+	if (debug_output_enabled)
+	{
+		bool has_error = false;
+		for (const DebugMessage& message : pending_messages)
+		{
+			std::cerr << file << ":" << line << ": OpenGL " << debug_type_str(message.type)
+				<< ": " << message.text << std::endl;
+			has_error |= message.type == GL_DEBUG_TYPE_ERROR;
+		}
+		pending_messages.clear();
+		assert(!has_error);
+		return has_error;
+	}
+
 	GLenum error = glGetError();
 
 	if (error == GL_NO_ERROR) return false;
@@ -50,10 +141,11 @@ bool gl_has_errors()
 			break;
 		}
 
-		std::cerr << "OpenGL: " << error_str << std::endl;
+		std::cerr << file << ":" << line << ": OpenGL: " << error_str << std::endl;
 		error = glGetError();
 		assert(false);
 	}
 
 	return true;
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
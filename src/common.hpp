@@ -4,9 +4,15 @@
 #include <string>
 #include <tuple>
 #include <vector>
-#include <mach-o/dyld.h>  // for _NSGetExecutablePath
 #include <limits.h>       // for PATH_MAX
 #include <stdexcept>
+#if defined(__APPLE__)
+#include <mach-o/dyld.h>  // for _NSGetExecutablePath
+#elif defined(_WIN32)
+#include <windows.h>      // for GetModuleFileNameA
+#else
+#include <unistd.h>       // for readlink
+#endif
 
 // glfw (OpenGL)
 #define NOMINMAX
@@ -28,24 +34,44 @@ using namespace glm;
 #include "../ext/project_path.hpp"
 
 inline std::string get_executable_path() {
+#if defined(__APPLE__)
 	char path[PATH_MAX];
 	uint32_t size = sizeof(path);
 	if (_NSGetExecutablePath(path, &size) != 0) {
 		throw std::runtime_error("Executable path is too long");
 	}
 	return {path};
+#elif defined(_WIN32)
+	char path[MAX_PATH];
+	DWORD length = GetModuleFileNameA(nullptr, path, sizeof(path));
+	if (length == 0 || length == sizeof(path)) {
+		throw std::runtime_error("Executable path is too long");
+	}
+	return std::string(path, length);
+#else
+	// Linux build agents run headless, so this has to work there too
+	char path[PATH_MAX];
+	ssize_t length = readlink("/proc/self/exe", path, sizeof(path));
+	if (length <= 0 || length == sizeof(path)) {
+		throw std::runtime_error("Executable path is too long");
+	}
+	return std::string(path, (size_t)length);
+#endif
 }
 
-inline std::string data_path() {
+// Where CMake copies data/ and shaders/ to, next to the executable
+inline std::string resources_path() {
 	std::string execPath = get_executable_path();
 	std::string bundlePath = execPath.substr(0, execPath.find_last_of("/"));
-	return bundlePath + "/../Resources/data";
+	return bundlePath + "/../Resources";
+}
+
+inline std::string data_path() {
+	return resources_path() + "/data";
 }
 
 inline std::string shader_path(const std::string& name) {
-	std::string execPath = get_executable_path();
-	std::string bundlePath = execPath.substr(0, execPath.find_last_of("/"));
-	return bundlePath + "/../Resources/shaders/" + name;
+	return resources_path() + "/shaders/" + name;
 }
 inline std::string textures_path(const std::string& name) {return data_path() + "/textures/" + std::string(name);};
 inline std::string audio_path(const std::string& name) {return data_path() + "/audio/" + std::string(name);};
@@ -68,4 +94,32 @@ struct Transform {
 	void translate(vec2 offset);
 };
 
-bool gl_has_errors();
+// A 2D model matrix without its constant (0, 0, 1) bottom row: the three
+// columns of Transform::mat, two floats each. See transform_batch.hpp.
+struct Affine2D {
+	vec2 columns[3];
+
+	mat3 to_mat3() const {
+		return mat3(vec3(columns[0], 0.f), vec3(columns[1], 0.f), vec3(columns[2], 1.f));
+	}
+};
+
+// Command line and config values. The whole string has to be the number and fit
+// the type, anything else (empty, trailing junk, out of range, a sign or spaces
+// for unsigned, inf or nan) returns false and leaves out untouched.
+bool parse_unsigned(const std::string& value, unsigned& out);
+bool parse_float(const std::string& value, float& out);
+
+// Checks for OpenGL errors and reports them with the file and line of the check.
+// Builds without GL_ERROR_CHECKS (release, see CMakeLists.txt) compile every check
+// out, so they cost nothing there.
+#ifdef GL_ERROR_CHECKS
+bool gl_check_errors(const char* file, int line);
+#define gl_has_errors() gl_check_errors(__FILE__, __LINE__)
+
+// Reports errors through a KHR_debug callback instead of polling glGetError.
+// Needs a 4.3 context, returns false if there is none.
+bool gl_enable_debug_output();
+#else
+inline bool gl_has_errors() { return false; }
+#endif
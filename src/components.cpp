@@ -1,4 +1,5 @@
 #include "components.hpp"
+#include "obj_loader.hpp"
 #include "render_system.hpp" // for gl_has_errors
 
 #define STB_IMAGE_IMPLEMENTATION
@@ -11,93 +12,22 @@
 Debug debugging;
 float death_timer_counter_ms = 3000;
 
-// Very, VERY simple OBJ loader from https://github.com/opengl-tutorials/ogl tutorial 7
-// (modified to also read vertex color and omit uv and normals)
-bool Mesh::loadFromOBJFile(std::string obj_path, std::vector<ColoredVertex>& out_vertices, std::vector<uint16_t>& out_vertex_indices, vec2& out_size)
+bool Mesh::loadFromOBJFile(const std::string& obj_path, Mesh& out_mesh)
 {
-	// disable warnings about fscanf and fopen on Windows
-#ifdef _MSC_VER
-#pragma warning(disable:4996)
-#endif
-
 	printf("Loading OBJ file %s...\n", obj_path.c_str());
-	// Note, normal and UV indices are not loaded/used, but code is commented to do so
-	std::vector<uint16_t> out_uv_indices, out_normal_indices;
-	std::vector<glm::vec2> out_uvs;
-	std::vector<glm::vec3> out_normals;
-
-	FILE* file = fopen(obj_path.c_str(), "r");
-	if (file == NULL) {
-		std::cerr << "Impossible to open the file ! Are you in the right path ? See Tutorial 1 for details" << std::endl;
-		getchar();
+	ObjMesh obj;
+	if (!load_obj_file(obj_path, obj))
 		return false;
-	}
-
-	while (1) {
-		char lineHeader[128];
-		// read the first word of the line
-		int res = fscanf(file, "%s", lineHeader);
-		if (res == EOF)
-			break; // EOF = End Of File. Quit the loop.
+	std::vector<ColoredVertex>& out_vertices = out_mesh.vertices;
+	out_vertices.swap(obj.vertices);
 
-		if (strcmp(lineHeader, "v") == 0) {
-			ColoredVertex vertex;
-			int matches = fscanf(file, "%f %f %f %f %f %f\n", &vertex.position.x, &vertex.position.y, &vertex.position.z,
-				&vertex.color.x, &vertex.color.y, &vertex.color.z);
-			if (matches == 3)
-				vertex.color = { 1,1,1 };
-			out_vertices.push_back(vertex);
-		}
-		else if (strcmp(lineHeader, "vt") == 0) {
-			glm::vec2 uv;
-			fscanf(file, "%f %f\n", &uv.x, &uv.y);
-			uv.y = -uv.y; // Invert V coordinate since we will only use DDS texture, which are inverted. Remove if you want to use TGA or BMP loaders.
-			out_uvs.push_back(uv);
-		}
-		else if (strcmp(lineHeader, "vn") == 0) {
-			glm::vec3 normal;
-			fscanf(file, "%f %f %f\n", &normal.x, &normal.y, &normal.z);
-			out_normals.push_back(normal);
-		}
-		else if (strcmp(lineHeader, "f") == 0) {
-			std::string vertex1, vertex2, vertex3;
-			unsigned int vertexIndex[3], normalIndex[3], uvIndex[3];
-
-			int matches = fscanf(file, "%d %d %d\n", &vertexIndex[0], &vertexIndex[1], &vertexIndex[2]);
-			if (matches == 1) // try again
-			{
-				// Note first vertex index is already consumed by the first fscanf call (match ==1) since it aborts on the first error
-				matches = fscanf(file, "//%d %d//%d %d//%d\n", &normalIndex[0], &vertexIndex[1], &normalIndex[1], &vertexIndex[2], &normalIndex[2]);
-				if (matches != 5) // try again
-				{
-					matches = fscanf(file, "%d/%d %d/%d/%d %d/%d/%d\n", &uvIndex[0], &normalIndex[0], &vertexIndex[1], &uvIndex[1], &normalIndex[1], &vertexIndex[2], &uvIndex[2], &normalIndex[2]);
-					if (matches != 8)
-					{
-						printf("File can't be read by our simple parser :-( Try exporting with other options\n");
-						fclose(file);
-						return false;
-					}
-				}
-			}
-
-			// -1 since .obj starts counting at 1 and OpenGL starts at 0
-			out_vertex_indices.push_back((uint16_t)vertexIndex[0] - 1);
-			out_vertex_indices.push_back((uint16_t)vertexIndex[1] - 1);
-			out_vertex_indices.push_back((uint16_t)vertexIndex[2] - 1);
-			//out_uv_indices.push_back(uvIndex[0] - 1);
-			//out_uv_indices.push_back(uvIndex[1] - 1);
-			//out_uv_indices.push_back(uvIndex[2] - 1);
-			out_normal_indices.push_back((uint16_t)normalIndex[0] - 1);
-			out_normal_indices.push_back((uint16_t)normalIndex[1] - 1);
-			out_normal_indices.push_back((uint16_t)normalIndex[2] - 1);
-		}
-		else {
-			// Probably a comment, eat up the rest of the line
-			char stupidBuffer[1000];
-			fgets(stupidBuffer, 1000, file);
-		}
-	}
-	fclose(file);
+	// Narrowed whenever the vertex count allows, that's every mesh the game has
+	out_mesh.vertex_indices.clear();
+	out_mesh.wide_indices.clear();
+	if (out_vertices.size() <= (size_t)UINT16_MAX + 1)
+		out_mesh.vertex_indices.assign(obj.indices.begin(), obj.indices.end());
+	else
+		out_mesh.wide_indices.swap(obj.indices);
 
 	// Compute bounds of the mesh
 	vec3 max_position = { -99999,-99999,-99999 };
@@ -111,7 +41,7 @@ bool Mesh::loadFromOBJFile(std::string obj_path, std::vector<ColoredVertex>& out
 		max_position.z = min_position.z+1; // don't scale z direction when everythin is on one plane
 
 	vec3 size3d = max_position - min_position;
-	out_size = size3d;
+	out_mesh.original_size = size3d;
 
 	// Normalize mesh to range -0.5 ... 0.5
 	for (ColoredVertex& pos : out_vertices)
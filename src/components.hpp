@@ -22,6 +22,17 @@ struct Eatable
 
 };
 
+// a car driven by the AISystem, it keeps to its lane and steers around what
+// blocks it. Speeds are along the road, relative to it scrolling by.
+struct TrafficCar
+{
+	int lane = 0; // the one it heads for
+	float cruise_speed = 200.f; // how fast it drives on a clear road, in pixels per second
+	// Decided every few steps by the AISystem, followed every step
+	float target_speed = 200.f; // slower when stuck behind something
+	float swerve = 0.f; // -1..1, pushes it away from what drives next to it
+};
+
 // All data relevant to the shape and motion of entities
 struct Motion {
 	vec2 position = { 0, 0 };
@@ -51,12 +62,6 @@ struct ScreenState
 	float darken_screen_factor = -1;
 };
 
-// A struct to refer to debugging graphics in the ECS
-struct DebugComponent
-{
-	// Note, an empty struct has size 1
-};
-
 // A timer that will be associated to crashed cars
 struct DeathTimer
 {
@@ -83,13 +88,39 @@ struct TexturedVertex
 	vec2 texcoord;
 };
 
+// Per instance data of a sprite drawn by the instanced path (textured_instanced.vs.glsl)
+struct SpriteInstance
+{
+	Affine2D transform;
+	vec3 color;
+	float texture_index;
+};
+
 // Mesh datastructure for storing vertex and index buffers
 struct Mesh
 {
-	static bool loadFromOBJFile(std::string obj_path, std::vector<ColoredVertex>& out_vertices, std::vector<uint16_t>& out_vertex_indices, vec2& out_size);
+	// Fills vertices, the indices and original_size, see obj_loader.hpp
+	static bool loadFromOBJFile(const std::string& obj_path, Mesh& out_mesh);
 	vec2 original_size = {1,1};
 	std::vector<ColoredVertex> vertices;
+	// 16 bit indices, unless there are more vertices than they can address. Then
+	// vertex_indices stays empty and wide_indices has them instead.
 	std::vector<uint16_t> vertex_indices;
+	std::vector<uint32_t> wide_indices;
+};
+
+// Convex outline of a mesh or sprite in its normalized -0.5 ... 0.5 local space,
+// computed once at load time. Normals are stored so collisions never rebuild them.
+struct ConvexHull
+{
+	std::vector<vec2> vertices; // counter-clockwise
+	std::vector<vec2> normals;  // outward normal of the edge (vertices[i], vertices[i+1])
+};
+
+// Tight collision shape, the hull is owned by the renderer's asset cache
+struct Collider
+{
+	const ConvexHull* hull = nullptr;
 };
 
 /**
@@ -132,7 +163,8 @@ enum class EFFECT_ASSET_ID {
 	WALL = CAR + 1,
 	TEXTURED = WALL + 1,
 	ROAD = TEXTURED + 1,
-	EFFECT_COUNT = ROAD + 1
+	TEXTURED_INSTANCED = ROAD + 1,
+	EFFECT_COUNT = TEXTURED_INSTANCED + 1
 };
 const int effect_count = (int)EFFECT_ASSET_ID::EFFECT_COUNT;
 
@@ -141,15 +173,22 @@ enum class GEOMETRY_BUFFER_ID {
 	SPRITE = CAR + 1,
 	WALL = SPRITE + 1,
 	EGG = WALL + 1,
-	DEBUG_LINE = EGG + 1,
-	SCREEN_TRIANGLE = DEBUG_LINE + 1,
+	SCREEN_TRIANGLE = EGG + 1,
 	GEOMETRY_COUNT = SCREEN_TRIANGLE + 1
 };
 const int geometry_count = (int)GEOMETRY_BUFFER_ID::GEOMETRY_COUNT;
 
+// Coarse draw order, lower layers are drawn first
+enum class RENDER_LAYER {
+	WORLD = 0,
+	UI = WORLD + 1,
+	LAYER_COUNT = UI + 1
+};
+
 struct RenderRequest {
 	TEXTURE_ASSET_ID used_texture = TEXTURE_ASSET_ID::TEXTURE_COUNT;
 	EFFECT_ASSET_ID used_effect = EFFECT_ASSET_ID::EFFECT_COUNT;
 	GEOMETRY_BUFFER_ID used_geometry = GEOMETRY_BUFFER_ID::GEOMETRY_COUNT;
+	RENDER_LAYER used_layer = RENDER_LAYER::WORLD;
 };
 
@@ -0,0 +1,101 @@
+// internal
+#include "convex_hull.hpp"
+
+// stlib
+#include <algorithm>
+
+namespace {
+	// z component of the cross product of (a - o) and (b - o)
+	float cross(vec2 o, vec2 a, vec2 b) {
+		return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+	}
+
+	// Drops the vertex contributing the least area until the hull is small enough.
+	// This shrinks the hull very slightly, which is fine for gameplay collisions.
+	void simplify(std::vector<vec2>& vertices) {
+		while (vertices.size() > MAX_HULL_VERTICES) {
+			size_t n = vertices.size();
+			size_t best = 0;
+			float best_area = INFINITY;
+			for (size_t i = 0; i < n; i++) {
+				float area = abs(cross(vertices[(i + n - 1) % n], vertices[i], vertices[(i + 1) % n]));
+				if (area < best_area) {
+					best_area = area;
+					best = i;
+				}
+			}
+			vertices.erase(vertices.begin() + best);
+		}
+	}
+}
+
+ConvexHull compute_convex_hull(std::vector<vec2> points) {
+	ConvexHull hull;
+	std::sort(points.begin(), points.end(), [](vec2 a, vec2 b) {
+		return a.x < b.x || (a.x == b.x && a.y < b.y);
+	});
+	points.erase(std::unique(points.begin(), points.end()), points.end());
+	if (points.size() < 3)
+		return unit_square_hull();
+
+	// lower then upper chain, both counter-clockwise
+	std::vector<vec2> chain(2 * points.size());
+	size_t k = 0;
+	for (size_t i = 0; i < points.size(); i++) {
+		while (k >= 2 && cross(chain[k - 2], chain[k - 1], points[i]) <= 0) k--;
+		chain[k++] = points[i];
+	}
+	for (size_t i = points.size() - 1, t = k + 1; i > 0; i--) {
+		while (k >= t && cross(chain[k - 2], chain[k - 1], points[i - 1]) <= 0) k--;
+		chain[k++] = points[i - 1];
+	}
+	chain.resize(k - 1); // last point is the same as the first one
+
+	simplify(chain);
+	hull.vertices = chain;
+
+	// outward normals of each edge (vertices[i], vertices[i+1])
+	size_t n = hull.vertices.size();
+	hull.normals.resize(n);
+	for (size_t i = 0; i < n; i++) {
+		vec2 edge = hull.vertices[(i + 1) % n] - hull.vertices[i];
+		hull.normals[i] = normalize(vec2(edge.y, -edge.x));
+	}
+	return hull;
+}
+
+ConvexHull hull_from_alpha(const unsigned char* rgba, ivec2 size, unsigned char alpha_threshold) {
+	// Only the outermost opaque pixels of each row can be on the hull, so we
+	// collect the corners of the leftmost and rightmost ones
+	std::vector<vec2> points;
+	vec2 pixel = { 1.f / size.x, 1.f / size.y };
+	for (int row = 0; row < size.y; row++) {
+		const unsigned char* line = rgba + (size_t)row * size.x * 4;
+		int first = -1, last = -1;
+		for (int col = 0; col < size.x; col++) {
+			if (line[col * 4 + 3] > alpha_threshold) {
+				if (first < 0) first = col;
+				last = col;
+			}
+		}
+		if (first < 0)
+			continue;
+		// image row 0 is texcoord v = 0, which maps to y = -0.5 on the sprite quad
+		float y0 = row * pixel.y - 0.5f;
+		float y1 = y0 + pixel.y;
+		float x0 = first * pixel.x - 0.5f;
+		float x1 = (last + 1) * pixel.x - 0.5f;
+		points.push_back({ x0, y0 });
+		points.push_back({ x0, y1 });
+		points.push_back({ x1, y0 });
+		points.push_back({ x1, y1 });
+	}
+	return compute_convex_hull(points);
+}
+
+ConvexHull unit_square_hull() {
+	ConvexHull hull;
+	hull.vertices = { { -0.5f, -0.5f }, { 0.5f, -0.5f }, { 0.5f, 0.5f }, { -0.5f, 0.5f } };
+	hull.normals = { { 0.f, -1.f }, { 1.f, 0.f }, { 0.f, 1.f }, { -1.f, 0.f } };
+	return hull;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "common.hpp"
+#include "components.hpp"
+
+// Upper bound on hull vertices so the narrowphase can work on fixed size arrays
+const int MAX_HULL_VERTICES = 16;
+
+// Builds the convex hull of a point cloud (Andrew's monotone chain) and fills in
+// the outward edge normals. The result is simplified to at most MAX_HULL_VERTICES.
+ConvexHull compute_convex_hull(std::vector<vec2> points);
+
+// Hull of the opaque pixels of an RGBA image, mapped onto the unit sprite quad
+// (see the textured vertices in RenderSystem::initializeGlGeometryBuffers)
+ConvexHull hull_from_alpha(const unsigned char* rgba, ivec2 size, unsigned char alpha_threshold = 16);
+
+// The unit square, used for anything that has no tighter outline
+ConvexHull unit_square_hull();
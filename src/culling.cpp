@@ -0,0 +1,58 @@
+// internal
+#include "culling.hpp"
+
+// stlib
+#include <algorithm>
+
+void CullList::clear() {
+	center_x.clear();
+	center_y.clear();
+	extent_x.clear();
+	extent_y.clear();
+	items.clear();
+}
+
+void CullList::push(vec2 position, vec2 scale, float angle, uint32_t item) {
+	float c = fabsf(cosf(angle));
+	float s = fabsf(sinf(angle));
+	float hx = fabsf(scale.x) / 2.f;
+	float hy = fabsf(scale.y) / 2.f;
+	center_x.push_back(position.x);
+	center_y.push_back(position.y);
+	extent_x.push_back(c * hx + s * hy);
+	extent_y.push_back(s * hx + c * hy);
+	items.push_back(item);
+}
+
+size_t CullList::cull(vec2 view_min, vec2 view_max) {
+	const size_t n = items.size();
+	visible.resize(n);
+	const float view_cx = (view_min.x + view_max.x) / 2.f;
+	const float view_cy = (view_min.y + view_max.y) / 2.f;
+	const float view_hx = (view_max.x - view_min.x) / 2.f;
+	const float view_hy = (view_max.y - view_min.y) / 2.f;
+
+	// Two boxes overlap when their centres are closer than the sum of their half sizes on both axes
+	const float* cx = center_x.data();
+	const float* cy = center_y.data();
+	const float* ex = extent_x.data();
+	const float* ey = extent_y.data();
+	uint8_t* out = visible.data();
+	size_t count = 0;
+	for (size_t i = 0; i < n; i++) {
+		uint8_t inside = (uint8_t)((fabsf(cx[i] - view_cx) <= ex[i] + view_hx) & (fabsf(cy[i] - view_cy) <= ey[i] + view_hy));
+		out[i] = inside;
+		count += inside;
+	}
+	return count;
+}
+
+void view_bounds(const mat3& projection, vec2& out_min, vec2& out_max) {
+	// Invert x_ndc = sx * x + tx at the edges of the -1 ... 1 clip range, sy is negative with y down
+	float sx = projection[0][0], sy = projection[1][1];
+	float tx = projection[2][0], ty = projection[2][1];
+	float x0 = (-1.f - tx) / sx, x1 = (1.f - tx) / sx;
+	float y0 = (-1.f - ty) / sy, y1 = (1.f - ty) / sy;
+	out_min = { std::min(x0, x1), std::min(y0, y1) };
+	out_max = { std::max(x0, x1), std::max(y0, y1) };
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "common.hpp"
+
+// Axis aligned bounds of a frame's renderables, kept as one array per coordinate
+// so cull() is a branch free loop over floats that the compiler can vectorize
+class CullList
+{
+public:
+	void clear();
+	// Bounds of the rotated unit quad scaled by scale, i.e. of any Motion based sprite or mesh
+	void push(vec2 position, vec2 scale, float angle, uint32_t item);
+
+	// Marks the entries whose bounds overlap [view_min, view_max], returns how many do
+	size_t cull(vec2 view_min, vec2 view_max);
+
+	size_t size() const { return items.size(); }
+	bool is_visible(size_t i) const { return visible[i] != 0; }
+	uint32_t item(size_t i) const { return items[i]; }
+
+private:
+	std::vector<float> center_x, center_y;
+	std::vector<float> extent_x, extent_y; // half sizes
+	std::vector<uint8_t> visible;
+	std::vector<uint32_t> items;
+};
+
+// World space rectangle that an orthographic projection (see
+// RenderSystem::createProjectionMatrix) maps onto the screen
+void view_bounds(const mat3& projection, vec2& out_min, vec2& out_max);
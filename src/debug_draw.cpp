@@ -0,0 +1,60 @@
+// internal
+#include "debug_draw.hpp"
+
+#ifdef DEBUG_DRAW
+
+namespace {
+	// Segments of the frame being built, reused between frames
+	std::vector<ColoredVertex> lines;
+
+	void push(vec2 a, vec2 b, vec3 color) {
+		lines.push_back({ vec3(a, 0.f), color });
+		lines.push_back({ vec3(b, 0.f), color });
+	}
+}
+
+void debug::line(vec2 a, vec2 b, vec3 color)
+{
+	push(a, b, color);
+}
+
+void debug::obb(vec2 center, vec2 size, float angle, vec3 color)
+{
+	const float c = cos(angle);
+	const float s = sin(angle);
+	const vec2 x_axis = vec2(c, s) * (size.x / 2.f);
+	const vec2 y_axis = vec2(-s, c) * (size.y / 2.f);
+	const vec2 corners[4] = {
+		center - x_axis - y_axis,
+		center + x_axis - y_axis,
+		center + x_axis + y_axis,
+		center - x_axis + y_axis };
+	for (int i = 0; i < 4; i++)
+		push(corners[i], corners[(i + 1) % 4], color);
+}
+
+void debug::circle(vec2 center, float radius, vec3 color, int segments)
+{
+	assert(segments >= 3);
+	const float step = 2.f * M_PI / segments;
+	vec2 previous = center + vec2(radius, 0.f);
+	for (int i = 1; i <= segments; i++)
+	{
+		const vec2 next = center + radius * vec2(cos(i * step), sin(i * step));
+		push(previous, next, color);
+		previous = next;
+	}
+}
+
+void debug::clear()
+{
+	lines.clear();
+}
+
+void debug::swap_lines(std::vector<ColoredVertex>& out)
+{
+	out.swap(lines);
+	lines.clear();
+}
+
+#endif
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+
+#include "common.hpp"
+#include "components.hpp"
+
+// Immediate mode debug drawing. Calls append line segments to a buffer for the
+// current frame, RenderSystem::submit_frame() hands it to the render thread,
+// which draws all of them with a single streamed draw on top of the finished
+// frame. PhysicsSystem::step() clears them first, so nothing is kept between
+// steps and whatever should stay visible is drawn again every step. Steps that
+// are never drawn (headless) don't pile up either.
+//
+//   if (debug::enabled && debugging.in_debug_mode)
+//       debug::obb(motion.position, motion.scale, motion.angle, { 0.f, 1.f, 0.f });
+//
+// Only call it from the simulation thread. Without the DEBUG_DRAW build option
+// (release, see CMakeLists.txt) every call compiles to nothing.
+namespace debug {
+#ifdef DEBUG_DRAW
+	const bool enabled = true;
+
+	void line(vec2 a, vec2 b, vec3 color);
+	// Outline of a box of the given size (as in Motion::scale) rotated by angle
+	void obb(vec2 center, vec2 size, float angle, vec3 color);
+	void circle(vec2 center, float radius, vec3 color, int segments = 24);
+
+	// Drops the segments drawn so far
+	void clear();
+
+	// Hands over this frame's segments, two vertices each, and starts the next
+	// frame with out's old storage
+	void swap_lines(std::vector<ColoredVertex>& out);
+#else
+	const bool enabled = false;
+
+	inline void line(vec2, vec2, vec3) {}
+	inline void obb(vec2, vec2, float, vec3) {}
+	inline void circle(vec2, float, vec3, int = 24) {}
+	inline void clear() {}
+	inline void swap_lines(std::vector<ColoredVertex>& out) { out.clear(); }
+#endif
+}
@@ -0,0 +1,189 @@
+// internal
+#include "file_watcher.hpp"
+
+// stlib
+#include <algorithm>
+#include <chrono>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	// How long the files have to be left alone before a change is reported, so
+	// an editor that writes a file in several steps causes one reload
+	const int quiet_ms = 100;
+	const int poll_interval_ms = 250;
+
+	std::string directory_of(const std::string& path) {
+		size_t slash = path.find_last_of('/');
+		return slash == std::string::npos ? "." : path.substr(0, slash);
+	}
+
+	std::string file_name_of(const std::string& path) {
+		size_t slash = path.find_last_of('/');
+		return slash == std::string::npos ? path : path.substr(slash + 1);
+	}
+
+	// Modification time and size, a change in either counts
+	struct FileStamp
+	{
+		long long mtime = -1;
+		long long size = -1;
+		bool operator!=(const FileStamp& other) const { return mtime != other.mtime || size != other.size; }
+	};
+
+	FileStamp stamp_of(const std::string& path) {
+		FileStamp result;
+		struct stat info;
+		if (stat(path.c_str(), &info) == 0) {
+			result.mtime = (long long)info.st_mtime;
+			result.size = (long long)info.st_size;
+		}
+		return result;
+	}
+}
+
+void FileWatcher::start(const std::vector<std::string>& watched_paths)
+{
+	stop();
+	paths = watched_paths;
+	running = true;
+#ifdef __linux__
+	inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotify_fd >= 0)
+	{
+		thread = std::thread(&FileWatcher::run_inotify, this);
+		return;
+	}
+	fprintf(stderr, "inotify is not available, polling for file changes instead\n");
+#endif
+	thread = std::thread(&FileWatcher::run_polling, this);
+}
+
+void FileWatcher::stop()
+{
+	if (!running)
+		return;
+	running = false;
+	thread.join();
+#ifdef __linux__
+	if (inotify_fd >= 0)
+		close(inotify_fd);
+#endif
+	inotify_fd = -1;
+}
+
+bool FileWatcher::take_changes(std::vector<size_t>& out)
+{
+	out.clear();
+	if (!has_changes.load(std::memory_order_acquire))
+		return false;
+	std::lock_guard<std::mutex> lock(changes_mutex);
+	out.swap(changes);
+	has_changes.store(false, std::memory_order_relaxed);
+	return !out.empty();
+}
+
+// Hands the flagged files over to take_changes() and clears the flags
+void FileWatcher::publish(std::vector<bool>& changed)
+{
+	std::lock_guard<std::mutex> lock(changes_mutex);
+	for (size_t i = 0; i < changed.size(); i++)
+	{
+		if (!changed[i])
+			continue;
+		changed[i] = false;
+		if (std::find(changes.begin(), changes.end(), i) == changes.end())
+			changes.push_back(i);
+	}
+	if (!changes.empty())
+		has_changes.store(true, std::memory_order_release);
+}
+
+void FileWatcher::run_inotify()
+{
+#ifdef __linux__
+	// One watch per directory, a file is matched by watch and name
+	std::vector<int> watch_of(paths.size(), -1);
+	std::vector<std::string> names(paths.size());
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		names[i] = file_name_of(paths[i]);
+		// Adding a directory twice returns the watch it already has
+		watch_of[i] = inotify_add_watch(inotify_fd, directory_of(paths[i]).c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+		if (watch_of[i] < 0)
+			fprintf(stderr, "Cannot watch %s for changes\n", paths[i].c_str());
+	}
+
+	std::vector<bool> changed(paths.size(), false);
+	bool pending = false;
+	alignas(struct inotify_event) char buffer[4096];
+	while (running)
+	{
+		pollfd request = { inotify_fd, POLLIN, 0 };
+		if (poll(&request, 1, quiet_ms) <= 0)
+		{
+			// Nothing for a while, the last burst of events is over
+			if (pending)
+				publish(changed);
+			pending = false;
+			continue;
+		}
+		ssize_t length = read(inotify_fd, buffer, sizeof(buffer));
+		for (ssize_t offset = 0; offset < length;)
+		{
+			const struct inotify_event* event = (const struct inotify_event*)(buffer + offset);
+			offset += sizeof(struct inotify_event) + event->len;
+			if (event->len == 0)
+				continue;
+			for (size_t i = 0; i < paths.size(); i++)
+				if (watch_of[i] == event->wd && names[i] == event->name)
+				{
+					changed[i] = true;
+					pending = true;
+				}
+		}
+	}
+#endif
+}
+
+// Fallback without inotify. A change is reported once the file looked the same
+// for two polls in a row, so a save in progress is not picked up half written.
+void FileWatcher::run_polling()
+{
+	std::vector<FileStamp> stamps(paths.size());
+	for (size_t i = 0; i < paths.size(); i++)
+		stamps[i] = stamp_of(paths[i]);
+	std::vector<bool> settling(paths.size(), false);
+	std::vector<bool> changed(paths.size(), false);
+
+	while (running)
+	{
+		// Short naps, so stop() does not have to wait for a whole interval
+		for (int slept = 0; slept < poll_interval_ms && running; slept += 50)
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+		bool any = false;
+		for (size_t i = 0; i < paths.size(); i++)
+		{
+			const FileStamp stamp = stamp_of(paths[i]);
+			if (stamp != stamps[i])
+			{
+				stamps[i] = stamp;
+				settling[i] = true;
+			}
+			else if (settling[i])
+			{
+				settling[i] = false;
+				changed[i] = true;
+				any = true;
+			}
+		}
+		if (any)
+			publish(changed);
+	}
+}
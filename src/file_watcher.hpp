@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common.hpp"
+
+// Reports changes to a fixed list of files. A background thread waits for them,
+// with inotify on Linux or by comparing modification times four times a second
+// elsewhere, so checking for changes costs the caller a single atomic load.
+//
+// Editors save in all sorts of ways (write in place, write a temporary and
+// rename it over the original, ...), so the directories are watched rather
+// than the files, and a burst of events is gathered into one change.
+class FileWatcher
+{
+public:
+	FileWatcher() = default;
+	~FileWatcher() { stop(); }
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	void start(const std::vector<std::string>& paths);
+	void stop();
+
+	// Indices into the paths given to start() of the files that changed since
+	// the last call, each at most once. False, without locking, if there are none.
+	bool take_changes(std::vector<size_t>& out);
+
+private:
+	void run_inotify();
+	void run_polling();
+	void publish(std::vector<bool>& changed);
+
+	std::vector<std::string> paths;
+	std::thread thread;
+	std::atomic<bool> running{ false };
+	int inotify_fd = -1;
+
+	std::atomic<bool> has_changes{ false };
+	std::mutex changes_mutex;
+	std::vector<size_t> changes; // guarded by changes_mutex
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <string>
+
+#include "common.hpp"
+#include "components.hpp"
+
+// Everything the renderer needs from the world for one frame. The simulation
+// thread copies it out of the registry, so the render thread never touches the
+// registry while the next step is running.
+struct FrameSnapshot
+{
+	// Note, no Entity in here, Entity() reserves a new id
+	struct Renderable
+	{
+		Motion motion;
+		vec3 color;
+		bool lit;
+		RenderRequest request;
+	};
+	std::vector<Renderable> renderables;
+	float darken_screen_factor = 0.f;
+	bool advanced = false;
+	float time = 0.f; // seconds of simulation, drives the water effect
+	// Line segments from debug::, two vertices each, drawn on top of everything
+	std::vector<ColoredVertex> debug_lines;
+	// The render thread saves this frame as a PNG here, if not empty
+	std::string capture_path;
+};
+
+// Lock free handoff of the latest value from one producer thread to one consumer
+// thread. Producer and consumer each own a buffer, the third one sits in the
+// middle. publish() and acquire() swap their buffer with the middle one, so
+// neither side ever waits for the other or sees a half written value. Buffers
+// are reused, so vectors inside T keep their capacity between frames.
+template <class T>
+class TripleBuffer
+{
+public:
+	// Producer side
+	T& write_buffer() { return buffers[write_index]; }
+	void publish() {
+		write_index = middle.exchange((uint8_t)(write_index | fresh_bit), std::memory_order_acq_rel) & index_mask;
+	}
+	// True until the consumer picked up the last published value
+	bool has_unread() const { return (middle.load(std::memory_order_acquire) & fresh_bit) != 0; }
+
+	// Consumer side, false if nothing new was published since the last call
+	bool acquire() {
+		if (!has_unread())
+			return false;
+		read_index = middle.exchange(read_index, std::memory_order_acq_rel) & index_mask;
+		return true;
+	}
+	const T& read_buffer() const { return buffers[read_index]; }
+
+private:
+	static const uint8_t index_mask = 0x3;
+	static const uint8_t fresh_bit = 0x4;
+
+	std::array<T, 3> buffers;
+	uint8_t write_index = 0;
+	std::atomic<uint8_t> middle{ 1 };
+	uint8_t read_index = 2;
+};
@@ -0,0 +1,357 @@
+// internal
+#include "gl_render_backend.hpp"
+#include "profiler.hpp"
+#include <cstddef> // offsetof
+
+GlRenderBackend::GlRenderBackend(GLFWwindow* window_arg, const RenderAssets& assets_arg)
+	: assets(assets_arg), window(window_arg)
+{
+	// For some high DPI displays (ex. Retina Display on Macbooks)
+	// https://stackoverflow.com/questions/36672935/why-retina-screen-coordinate-value-is-twice-the-value-of-pixel-value
+	int frame_buffer_width_px, frame_buffer_height_px;
+	glfwGetFramebufferSize(window, &frame_buffer_width_px, &frame_buffer_height_px);  // Note, this will be 2x the resolution given to glfwCreateWindow on retina displays
+	framebuffer_size = { frame_buffer_width_px, frame_buffer_height_px }; // the window is not resizable
+	if (frame_buffer_width_px != window_width_px)
+	{
+		printf("WARNING: retina display! https://stackoverflow.com/questions/36672935/why-retina-screen-coordinate-value-is-twice-the-value-of-pixel-value\n");
+		printf("glfwGetFramebufferSize = %d,%d\n", frame_buffer_width_px, frame_buffer_height_px);
+		printf("window width_height = %d,%d\n", window_width_px, window_height_px);
+	}
+}
+
+void GlRenderBackend::make_current()
+{
+	glfwMakeContextCurrent(window);
+	glfwSwapInterval(1); // vsync
+}
+
+void GlRenderBackend::release_current()
+{
+	glfwMakeContextCurrent(nullptr);
+}
+
+void GlRenderBackend::useProgram(GLuint program, RenderStats& stats)
+{
+	if (program == bound_program)
+		return;
+	glUseProgram(program);
+	bound_program = program;
+	stats.program_binds++;
+}
+
+void GlRenderBackend::bindVertexArray(GLuint vao, RenderStats& stats)
+{
+	if (vao == bound_vao)
+		return;
+	glBindVertexArray(vao);
+	bound_vao = vao;
+	stats.vao_binds++;
+}
+
+void GlRenderBackend::bindTexture(GLuint texture, RenderStats& stats)
+{
+	if (texture == bound_texture)
+		return;
+	glBindTexture(GL_TEXTURE_2D, texture);
+	bound_texture = texture;
+	stats.texture_binds++;
+}
+
+void GlRenderBackend::drawItem(const DrawItem &item,
+                               const mat3 &projection, RenderStats& stats)
+{
+	const RenderRequest &render_request = item.request;
+
+	const GLuint used_effect_enum = (GLuint)render_request.used_effect;
+	assert(used_effect_enum != (GLuint)EFFECT_ASSET_ID::EFFECT_COUNT);
+	const EffectPipeline &pipeline = pipelines[used_effect_enum];
+
+	// Setting shaders
+	useProgram(effects[used_effect_enum], stats);
+	gl_has_errors();
+
+	// The VAO holds the vertex and index buffers and their attribute layout
+	assert(render_request.used_geometry != GEOMETRY_BUFFER_ID::GEOMETRY_COUNT);
+	bindVertexArray(vertex_arrays[(GLuint)render_request.used_geometry], stats);
+	gl_has_errors();
+
+	if (render_request.used_effect == EFFECT_ASSET_ID::TEXTURED)
+	{
+		// Texture slot 0 is made active once per frame in draw()
+		bindTexture(texture_gl_handles[(GLuint)render_request.used_texture], stats);
+		glUniform4fv(pipeline.uv_rect_uloc, 1, (float *)&assets.texture_uv_rects[(GLuint)render_request.used_texture]);
+		gl_has_errors();
+	}
+	else if (render_request.used_effect == EFFECT_ASSET_ID::CAR ||
+		render_request.used_effect == EFFECT_ASSET_ID::WALL ||
+		render_request.used_effect == EFFECT_ASSET_ID::EGG)
+	{
+		if (render_request.used_effect == EFFECT_ASSET_ID::CAR)
+		{
+			// Light up?
+			assert(pipeline.light_up_uloc >= 0);
+
+			// similar to the glUniform1f call below. The 1f or 1i specified the type, here a single int.
+			glUniform1i(pipeline.light_up_uloc, item.lit);
+			gl_has_errors();
+		}
+	}
+	else
+	{
+		assert(false && "Type of render request not supported");
+	}
+
+	glUniform3fv(pipeline.fcolor_uloc, 1, (float *)&item.color);
+	gl_has_errors();
+
+	// Setting uniform values to the currently bound program
+	const mat3 transform = item.transform.to_mat3();
+	glUniformMatrix3fv(pipeline.transform_uloc, 1, GL_FALSE, (float *)&transform);
+	glUniformMatrix3fv(pipeline.projection_uloc, 1, GL_FALSE, (float *)&projection);
+	gl_has_errors();
+	// Drawing of num_indices/3 triangles specified in the index buffer
+	glDrawElements(GL_TRIANGLES, index_counts[(GLuint)render_request.used_geometry], index_types[(GLuint)render_request.used_geometry], nullptr);
+	gl_has_errors();
+	stats.draw_calls++;
+}
+
+// Draws count sprites sharing an atlas page with a single instanced draw call,
+// starting at instance first of this frame's sprite instances
+void GlRenderBackend::drawSpriteRun(GLuint texture, size_t first, size_t count, const mat3 &projection, RenderStats& stats)
+{
+	const EffectPipeline &pipeline = pipelines[(GLuint)EFFECT_ASSET_ID::TEXTURED_INSTANCED];
+	useProgram(effects[(GLuint)EFFECT_ASSET_ID::TEXTURED_INSTANCED], stats);
+	bindVertexArray(sprite_instanced_vao, stats);
+	bindTexture(texture, stats);
+	glUniformMatrix3fv(pipeline.projection_uloc, 1, GL_FALSE, (float *)&projection);
+	gl_has_errors();
+
+	// No base instance in GL 3.3, so the attributes are pointed at the run instead
+	setSpriteInstanceAttributes(sprite_instances_offset + first * sizeof(SpriteInstance));
+	const GLsizei num_indices = index_counts[(GLuint)GEOMETRY_BUFFER_ID::SPRITE];
+	glDrawElementsInstanced(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr, (GLsizei)count);
+	gl_has_errors();
+	stats.draw_calls++;
+	stats.instances += (uint)count;
+}
+
+// Points the per instance attributes of sprite_instanced_vao at the instances
+// starting offset bytes into the instance stream
+void GlRenderBackend::setSpriteInstanceAttributes(size_t offset)
+{
+	glBindBuffer(GL_ARRAY_BUFFER, instance_stream.get_buffer());
+	const size_t transform_offset = offset + offsetof(SpriteInstance, transform);
+	glVertexAttribPointer((GLuint)ATTRIBUTE_LOCATION::TRANSFORM_0, 2, GL_FLOAT, GL_FALSE,
+						  sizeof(SpriteInstance), (void *)transform_offset);
+	glVertexAttribPointer((GLuint)ATTRIBUTE_LOCATION::TRANSFORM_1, 2, GL_FLOAT, GL_FALSE,
+						  sizeof(SpriteInstance), (void *)(transform_offset + sizeof(vec2)));
+	glVertexAttribPointer((GLuint)ATTRIBUTE_LOCATION::TRANSFORM_2, 2, GL_FLOAT, GL_FALSE,
+						  sizeof(SpriteInstance), (void *)(transform_offset + 2 * sizeof(vec2)));
+	glVertexAttribPointer((GLuint)ATTRIBUTE_LOCATION::COLOR, 3, GL_FLOAT, GL_FALSE,
+						  sizeof(SpriteInstance), (void *)(offset + offsetof(SpriteInstance, color)));
+	glVertexAttribPointer((GLuint)ATTRIBUTE_LOCATION::TEXTURE_INDEX, 1, GL_FLOAT, GL_FALSE,
+						  sizeof(SpriteInstance), (void *)(offset + offsetof(SpriteInstance, texture_index)));
+}
+
+// Draws the snapshot's debug lines, vertex_count of them starting offset bytes
+// into the instance stream, in one draw with the EGG effect (vertex colors).
+// Goes straight to the screen after drawToScreen(), so the water doesn't bend them.
+void GlRenderBackend::drawDebugLines(size_t offset, size_t vertex_count, const mat3& projection, RenderStats& stats)
+{
+	const EffectPipeline &pipeline = pipelines[(GLuint)EFFECT_ASSET_ID::EGG];
+	useProgram(effects[(GLuint)EFFECT_ASSET_ID::EGG], stats);
+	bindVertexArray(debug_lines_vao, stats);
+	glBindBuffer(GL_ARRAY_BUFFER, instance_stream.get_buffer());
+	glVertexAttribPointer((GLuint)ATTRIBUTE_LOCATION::POSITION, 3, GL_FLOAT, GL_FALSE,
+						  sizeof(ColoredVertex), (void *)(offset + offsetof(ColoredVertex, position)));
+	glVertexAttribPointer((GLuint)ATTRIBUTE_LOCATION::COLOR, 3, GL_FLOAT, GL_FALSE,
+						  sizeof(ColoredVertex), (void *)(offset + offsetof(ColoredVertex, color)));
+
+	// Already in world space
+	const mat3 identity = mat3(1.f);
+	const vec3 white = vec3(1.f);
+	glUniform3fv(pipeline.fcolor_uloc, 1, (float *)&white);
+	glUniformMatrix3fv(pipeline.transform_uloc, 1, GL_FALSE, (float *)&identity);
+	glUniformMatrix3fv(pipeline.projection_uloc, 1, GL_FALSE, (float *)&projection);
+	glDrawArrays(GL_LINES, 0, (GLsizei)vertex_count);
+	gl_has_errors();
+	stats.draw_calls++;
+}
+
+// draw the intermediate texture to the screen, with some distortion to simulate
+// water
+void GlRenderBackend::drawToScreen(const FrameSnapshot& snapshot)
+{
+	PROFILE_SCOPE("drawToScreen");
+	// Setting shaders
+	// get the water texture, sprite mesh, and program
+	glUseProgram(effects[(GLuint)EFFECT_ASSET_ID::ROAD]);
+	gl_has_errors();
+	// Clearing backbuffer
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, framebuffer_size.x, framebuffer_size.y);
+	glDepthRange(0, 10);
+	glClearColor(1.f, 0, 0, 1.0);
+	glClearDepth(1.f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	gl_has_errors();
+	// Enabling alpha channel for textures
+	glDisable(GL_BLEND);
+	// glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDisable(GL_DEPTH_TEST);
+
+	// Draw the screen texture on the quad geometry, the VAO also carries the
+	// vertex position layout
+	glBindVertexArray(vertex_arrays[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]);
+	gl_has_errors();
+	const EffectPipeline &water_pipeline = pipelines[(GLuint)EFFECT_ASSET_ID::ROAD];
+	// Set clock
+	glUniform1f(water_pipeline.time_uloc, snapshot.time * 10.0f);
+	glUniform1i(water_pipeline.advanced_uloc, snapshot.advanced);
+	glUniform1f(water_pipeline.darken_screen_factor_uloc, snapshot.darken_screen_factor);
+	gl_has_errors();
+
+	// Bind our texture in Texture Unit 0
+	glActiveTexture(GL_TEXTURE0);
+
+	glBindTexture(GL_TEXTURE_2D, off_screen_render_buffer_color);
+	gl_has_errors();
+	// Draw
+	glDrawElements(
+		GL_TRIANGLES, 3, GL_UNSIGNED_SHORT,
+		nullptr); // one triangle = 3 vertices; nullptr indicates that there is
+				  // no offset from the bound index buffer
+	gl_has_errors();
+}
+
+// Render our game world
+// http://www.opengl-tutorial.org/intermediate-tutorials/tutorial-14-render-to-texture/
+void GlRenderBackend::draw(const RenderQueue& queue, const std::vector<DrawItem>& items,
+	const mat3& projection, const FrameSnapshot& snapshot, RenderStats& stats)
+{
+#ifdef HOT_RELOAD_DIR
+	reloadChangedAssets();
+#endif
+
+	// First render to the custom framebuffer
+	glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer);
+	gl_has_errors();
+	// Clearing backbuffer
+	glViewport(0, 0, framebuffer_size.x, framebuffer_size.y);
+	glDepthRange(0.00001, 10);
+	glClearColor(GLfloat(172 / 255), GLfloat(216 / 255), GLfloat(255 / 255), 1.0);
+	glClearDepth(10.f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDisable(GL_DEPTH_TEST); // native OpenGL does not work with a depth buffer
+							  // and alpha blending, one would have to sort
+							  // sprites back to front
+	gl_has_errors();
+
+	// TEXTURED sprites are drawn instanced. Their instances are laid out in
+	// queue order so each run of equal keys is a contiguous range. Sprites of
+	// all types on the same atlas page share a key and end up in one run.
+	size_t sprite_count = 0;
+	for (const DrawItem& item : items)
+		if (item.request.used_effect == EFFECT_ASSET_ID::TEXTURED &&
+			item.request.used_geometry == GEOMETRY_BUFFER_ID::SPRITE)
+			sprite_count++;
+	// Debug lines go behind the sprites, the slack covers their alignment
+	const size_t sprite_bytes = sizeof(SpriteInstance) * sprite_count;
+	const size_t debug_bytes = sizeof(ColoredVertex) * snapshot.debug_lines.size();
+	instance_stream.reserve(sprite_bytes + sizeof(float) + debug_bytes);
+	instance_stream.begin_frame();
+	StreamBuffer::Allocation sprite_allocation = instance_stream.allocate(sprite_bytes, sizeof(float));
+	assert(sprite_allocation.data != nullptr);
+	sprite_instances_offset = sprite_allocation.offset;
+	StreamBuffer::Allocation debug_allocation;
+	if (debug_bytes > 0)
+	{
+		debug_allocation = instance_stream.allocate(debug_bytes, sizeof(float));
+		assert(debug_allocation.data != nullptr);
+		memcpy(debug_allocation.data, snapshot.debug_lines.data(), debug_bytes);
+	}
+
+	// Written straight into the stream buffer
+	SpriteInstance* sprite_instances = (SpriteInstance*)sprite_allocation.data;
+	for (size_t i = 0; i < queue.size(); i++)
+	{
+		const DrawItem& item = items[RenderQueue::item_of(queue[i])];
+		if (item.request.used_effect != EFFECT_ASSET_ID::TEXTURED ||
+			item.request.used_geometry != GEOMETRY_BUFFER_ID::SPRITE)
+			continue;
+		SpriteInstance& instance = *sprite_instances++;
+		instance.transform = item.transform;
+		instance.color = item.color;
+		instance.texture_index = (float)item.request.used_texture;
+	}
+	instance_stream.flush();
+
+	// Submit in key order, state is only changed where the key says so
+	bound_program = 0;
+	bound_vao = 0;
+	bound_texture = 0;
+	glActiveTexture(GL_TEXTURE0);
+	size_t next_instance = 0;
+	for (size_t i = 0; i < queue.size();)
+	{
+		const uint64_t key = queue[i];
+		if (RenderQueue::effect_of(key) != EFFECT_ASSET_ID::TEXTURED ||
+			RenderQueue::geometry_of(key) != GEOMETRY_BUFFER_ID::SPRITE)
+		{
+			drawItem(items[RenderQueue::item_of(key)], projection, stats);
+			i++;
+			continue;
+		}
+		size_t end = i + 1;
+		while (end < queue.size() && RenderQueue::state_of(queue[end]) == RenderQueue::state_of(key))
+			end++;
+		drawSpriteRun(atlas_textures[RenderQueue::texture_of(key)], next_instance, end - i, projection, stats);
+		next_instance += end - i;
+		i = end;
+	}
+
+	// Truely render to the screen
+	drawToScreen(snapshot);
+	if (debug_bytes > 0)
+	{
+		// drawToScreen() binds its program and VAO past the cache
+		bound_program = 0;
+		bound_vao = 0;
+		drawDebugLines(debug_allocation.offset, snapshot.debug_lines.size(), projection, stats);
+	}
+	instance_stream.end_frame();
+}
+
+bool GlRenderBackend::read_pixels(std::vector<unsigned char>& out_rgba, ivec2& out_size)
+{
+	// The back buffer still holds the frame until it is swapped
+	out_size = framebuffer_size;
+	out_rgba.resize((size_t)out_size.x * out_size.y * 4);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, out_size.x, out_size.y, GL_RGBA, GL_UNSIGNED_BYTE, out_rgba.data());
+	if (gl_has_errors())
+		return false;
+
+	// GL starts at the bottom row
+	const size_t row_bytes = (size_t)out_size.x * 4;
+	std::vector<unsigned char> row(row_bytes);
+	for (int y = 0; y < out_size.y / 2; y++)
+	{
+		unsigned char* top = out_rgba.data() + y * row_bytes;
+		unsigned char* bottom = out_rgba.data() + (out_size.y - 1 - y) * row_bytes;
+		memcpy(row.data(), top, row_bytes);
+		memcpy(top, bottom, row_bytes);
+		memcpy(bottom, row.data(), row_bytes);
+	}
+	return true;
+}
+
+void GlRenderBackend::present()
+{
+	// flicker-free display with a double buffer
+	glfwSwapBuffers(window);
+	gl_has_errors();
+}
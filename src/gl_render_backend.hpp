@@ -0,0 +1,164 @@
+#pragma once
+
+#include <array>
+
+#include "common.hpp"
+#include "components.hpp"
+#include "file_watcher.hpp"
+#include "program_cache.hpp"
+#include "render_assets.hpp"
+#include "render_backend.hpp"
+#include "stream_buffer.hpp"
+
+// Attribute locations shared by all effects. They are bound before linking, so one
+// VAO per geometry works with every program that reads the same attributes.
+enum class ATTRIBUTE_LOCATION {
+	POSITION = 0,
+	TEXCOORD = POSITION + 1,
+	COLOR = TEXCOORD + 1,
+	TRANSFORM_0 = COLOR + 1,
+	TRANSFORM_1 = TRANSFORM_0 + 1,
+	TRANSFORM_2 = TRANSFORM_1 + 1,
+	TEXTURE_INDEX = TRANSFORM_2 + 1,
+	ATTRIBUTE_COUNT = TEXTURE_INDEX + 1
+};
+const int attribute_count = (int)ATTRIBUTE_LOCATION::ATTRIBUTE_COUNT;
+
+// Make sure these names remain in sync with the associated enumerators.
+const std::array<const char*, attribute_count> attribute_names = {
+	"in_position",
+	"in_texcoord",
+	"in_color",
+	"in_transform_0",
+	"in_transform_1",
+	"in_transform_2",
+	"in_texture_index" };
+
+// Uniform locations of an effect, resolved once after it is linked so the draw
+// loop never has to query the driver. -1 if the effect does not use the uniform.
+struct EffectPipeline
+{
+	GLint transform_uloc = -1;
+	GLint projection_uloc = -1;
+	GLint fcolor_uloc = -1;
+	GLint light_up_uloc = -1;
+	GLint time_uloc = -1;
+	GLint advanced_uloc = -1;
+	GLint darken_screen_factor_uloc = -1;
+	GLint uv_rect_uloc = -1;
+};
+
+// Length of the uv_rects table in textured_instanced.vs.glsl
+const int max_atlas_entries = 16;
+
+// Draws with OpenGL 3.3 into a GLFW window
+class GlRenderBackend : public RenderBackend
+{
+	/**
+	 * The following arrays store the GL objects the game will use. They are created
+	 * at initialization and are assumed to not be modified by the render loop.
+	 *
+	 * Whenever possible, add to these lists instead of creating dynamic state
+	 * it is easier to debug and faster to execute for the computer.
+	 */
+	// All textures are packed into atlas pages when loaded. texture_gl_handles
+	// refers to the page of each texture, which owns no GL object of its own.
+	std::array<GLuint, texture_count> texture_gl_handles;
+	std::vector<GLuint> atlas_textures;
+
+	std::array<GLuint, effect_count> effects;
+	std::array<EffectPipeline, effect_count> pipelines;
+	ProgramCache program_cache;
+
+	// Per frame instance data. This frame's TEXTURED sprites sit in queue order
+	// from sprite_instances_offset on, each run of equal keys is one instanced draw.
+	StreamBuffer instance_stream;
+	size_t sprite_instances_offset = 0;
+	const size_t initial_instance_stream_size = 1 << 20;
+	GLuint sprite_instanced_vao; // sprite quad plus the per instance attributes
+	GLuint debug_lines_vao; // reads the snapshot's debug lines out of the instance stream
+
+	std::array<GLuint, geometry_count> vertex_buffers;
+	std::array<GLuint, geometry_count> index_buffers;
+	std::array<GLuint, geometry_count> vertex_arrays;
+	std::array<GLsizei, geometry_count> index_counts; // size of each index buffer
+	std::array<GLenum, geometry_count> index_types; // GL_UNSIGNED_SHORT, or _INT for big meshes
+
+public:
+	GlRenderBackend(GLFWwindow* window, const RenderAssets& assets);
+
+	// Creates all GL objects, needs the window's context to be current
+	bool init();
+
+	// T is the vertex type, which picks the attribute layout
+	template <class T>
+	void bindVBOandIBO(GEOMETRY_BUFFER_ID gid, const RenderAssets::GeometryData& data);
+
+	void initializeGlTextures();
+
+	void initializeGlEffects();
+	void resolveEffectPipeline(EFFECT_ASSET_ID id);
+
+	void initializeGlGeometryBuffers();
+	// Initialize the screen texture used as intermediate render target
+	// The draw loop first renders to this texture, then it is used for the wind
+	// shader
+	bool initScreenTexture();
+
+	~GlRenderBackend();
+
+	void make_current() override;
+	void release_current() override;
+	void draw(const RenderQueue& queue, const std::vector<DrawItem>& items,
+		const mat3& projection, const FrameSnapshot& snapshot, RenderStats& stats) override;
+	bool read_pixels(std::vector<unsigned char>& out_rgba, ivec2& out_size) override;
+	void present() override;
+
+private:
+	// Internal drawing functions for each entity type
+	void drawItem(const DrawItem& item, const mat3& projection, RenderStats& stats);
+	void drawSpriteRun(GLuint texture, size_t first, size_t count, const mat3& projection, RenderStats& stats);
+	void setSpriteInstanceAttributes(size_t offset);
+	void drawDebugLines(size_t offset, size_t vertex_count, const mat3& projection, RenderStats& stats);
+	void drawToScreen(const FrameSnapshot& snapshot);
+
+#ifdef HOT_RELOAD_DIR
+	// Recompiles edited shaders and re-uploads edited textures between frames,
+	// anything that fails to load keeps what it had
+	void startWatching();
+	void reloadChangedAssets();
+	bool reloadEffect(uint i);
+	bool reloadTexture(uint i);
+
+	FileWatcher watcher;
+	std::vector<size_t> changed_files;
+#endif
+
+	// Bind only if different from what is bound already
+	void useProgram(GLuint program, RenderStats& stats);
+	void bindVertexArray(GLuint vao, RenderStats& stats);
+	void bindTexture(GLuint texture, RenderStats& stats);
+
+	// What the draw loop last bound, reset at the start of every frame
+	GLuint bound_program = 0;
+	GLuint bound_vao = 0;
+	GLuint bound_texture = 0;
+
+	const RenderAssets& assets;
+
+	// Window handle
+	GLFWwindow* window;
+	ivec2 framebuffer_size; // glfwGetFramebufferSize may only be called on the main thread
+
+	// Screen texture handles
+	GLuint frame_buffer;
+	GLuint off_screen_render_buffer_color;
+	GLuint off_screen_render_buffer_depth;
+};
+
+bool loadEffectFromFile(
+	const std::string& vs_path, const std::string& fs_path, GLuint& out_program);
+bool readEffectSources(const std::string& vs_path, const std::string& fs_path,
+	std::string& out_vs_source, std::string& out_fs_source);
+// retrievable: the program binary will be read back with glGetProgramBinary
+bool compileEffect(const std::string& vs_source, const std::string& fs_source, bool retrievable, GLuint& out_program);
@@ -0,0 +1,493 @@
+// internal
+#include "gl_render_backend.hpp"
+
+#include <array>
+#include <chrono>
+#include <fstream>
+
+// stlib
+#include <iostream>
+#include <sstream>
+
+bool GlRenderBackend::init()
+{
+	glfwMakeContextCurrent(window);
+
+	// Load OpenGL function pointers
+	const int is_fine = gl3w_init();
+	assert(is_fine == 0);
+#ifdef GL_ERROR_CHECKS
+	if (gl_enable_debug_output())
+		printf("OpenGL debug output enabled\n");
+#endif
+
+	// Create a frame buffer
+	frame_buffer = 0;
+	glGenFramebuffers(1, &frame_buffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer);
+	gl_has_errors();
+
+	// Hint: Ask your TA for how to setup pretty OpenGL error callbacks. 
+	// This can not be done in macOS, so do not enable
+	// it unless you are on Linux or Windows. You will need to change the window creation
+	// code to use OpenGL 4.3 (not suported in macOS) and add additional .h and .cpp
+	// glDebugMessageCallback((GLDEBUGPROC)errorCallback, nullptr);
+
+	// Each geometry gets its own VAO later on, but without at least one bound we
+	// will crash in some systems.
+	GLuint vao;
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+	gl_has_errors();
+
+	initScreenTexture();
+    initializeGlTextures();
+	initializeGlEffects();
+	initializeGlGeometryBuffers();
+#ifdef HOT_RELOAD_DIR
+	startWatching();
+#endif
+
+	return true;
+}
+
+void GlRenderBackend::initializeGlTextures()
+{
+	// The pages were packed when the assets were loaded, or by the packer, only
+	// the upload is left
+	const std::vector<const unsigned char*>& pages = assets.atlas_pages;
+	atlas_textures.resize(pages.size());
+	glGenTextures((GLsizei)pages.size(), atlas_textures.data());
+	for (uint page = 0; page < pages.size(); page++)
+	{
+		glBindTexture(GL_TEXTURE_2D, atlas_textures[page]);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, assets.page_size.x, assets.page_size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, pages[page]);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		gl_has_errors();
+	}
+
+	for (uint i = 0; i < texture_count; i++)
+		texture_gl_handles[i] = atlas_textures[assets.texture_pages[i]];
+	gl_has_errors();
+}
+
+void GlRenderBackend::initializeGlEffects()
+{
+	const auto start = std::chrono::steady_clock::now();
+	program_cache.init();
+	// The attribute locations are linked into the binaries too
+	std::string layout;
+	for (const char* name : attribute_names)
+		layout += std::string(name) + "\n";
+
+	uint cached = 0;
+	for(uint i = 0; i < assets.effect_names.size(); i++)
+	{
+		const std::string& name = assets.effect_names[i];
+		// Saved with the shaders next to the executable, even when they are read from the source tree
+		const std::string cache_name = assets.shaderPath(name + ".program", resources_path());
+
+		std::string vs_source, fs_source;
+		bool is_valid = assets.readShader(name + ".vs.glsl", vs_source) && assets.readShader(name + ".fs.glsl", fs_source);
+		assert(is_valid);
+		const uint64_t key = program_cache.key_of(vs_source, fs_source, layout);
+		effects[i] = program_cache.load(cache_name, key);
+		if (effects[i] != 0)
+		{
+			cached++;
+		}
+		else
+		{
+			is_valid = compileEffect(vs_source, fs_source, program_cache.is_supported(), effects[i]);
+			assert(is_valid && (GLuint)effects[i] != 0);
+			program_cache.save(cache_name, key, effects[i]);
+		}
+		resolveEffectPipeline((EFFECT_ASSET_ID)i);
+	}
+
+	const float elapsed_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	printf("Shader programs ready in %.1f ms, %u from the cache, %u compiled%s\n", elapsed_ms, cached,
+		(uint)assets.effect_names.size() - cached, program_cache.is_supported() ? "" : " (no program binary support)");
+}
+
+// Looks up the uniforms once, so drawing never needs glGetUniformLocation
+void GlRenderBackend::resolveEffectPipeline(EFFECT_ASSET_ID id)
+{
+	const GLuint program = effects[(GLuint)id];
+	EffectPipeline& pipeline = pipelines[(GLuint)id];
+	pipeline.transform_uloc = glGetUniformLocation(program, "transform");
+	pipeline.projection_uloc = glGetUniformLocation(program, "projection");
+	pipeline.fcolor_uloc = glGetUniformLocation(program, "fcolor");
+	pipeline.light_up_uloc = glGetUniformLocation(program, "light_up");
+	pipeline.time_uloc = glGetUniformLocation(program, "time");
+	pipeline.advanced_uloc = glGetUniformLocation(program, "advanced");
+	pipeline.darken_screen_factor_uloc = glGetUniformLocation(program, "darken_screen_factor");
+	pipeline.uv_rect_uloc = glGetUniformLocation(program, "uv_rect");
+
+	// The atlas layout never changes, so the table for instanced sprites is
+	// uploaded once here and stays with the program
+	static_assert(texture_count <= max_atlas_entries, "uv_rects in textured_instanced.vs.glsl is too short");
+	GLint uv_rects_uloc = glGetUniformLocation(program, "uv_rects");
+	if (uv_rects_uloc >= 0)
+	{
+		glUseProgram(program);
+		glUniform4fv(uv_rects_uloc, texture_count, (float*)assets.texture_uv_rects.data());
+	}
+	gl_has_errors();
+}
+
+#ifdef HOT_RELOAD_DIR
+// The loose files in the source tree, not the copies next to the executable, so
+// saving a shader or texture in the editor is enough. Watched file 2 * i is the
+// vertex shader of effect i, 2 * i + 1 its fragment shader, the textures follow.
+void GlRenderBackend::startWatching()
+{
+	std::vector<std::string> paths;
+	for (const std::string& name : assets.effect_names)
+	{
+		paths.push_back(assets.shaderPath(name + ".vs.glsl", HOT_RELOAD_DIR));
+		paths.push_back(assets.shaderPath(name + ".fs.glsl", HOT_RELOAD_DIR));
+	}
+	for (uint i = 0; i < texture_count; i++)
+		paths.push_back(assets.texturePath(i, HOT_RELOAD_DIR));
+	watcher.start(paths);
+	printf("Watching the shaders and textures in %s for changes\n", HOT_RELOAD_DIR);
+}
+
+// Called on the render thread before each frame, nothing to do unless the
+// watcher saw a file change
+void GlRenderBackend::reloadChangedAssets()
+{
+	if (!watcher.take_changes(changed_files))
+		return;
+	const auto start = std::chrono::steady_clock::now();
+	std::array<bool, effect_count> effect_changed = {};
+	for (size_t file : changed_files)
+	{
+		if (file < 2 * effect_count)
+			effect_changed[file / 2] = true;
+		else
+			reloadTexture((uint)(file - 2 * effect_count));
+	}
+	for (uint i = 0; i < effect_count; i++)
+		if (effect_changed[i])
+			reloadEffect(i);
+	const float elapsed_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	printf("Hot reload took %.1f ms\n", elapsed_ms);
+}
+
+bool GlRenderBackend::reloadEffect(uint i)
+{
+	const std::string& name = assets.effect_names[i];
+	std::string vs_source, fs_source;
+	GLuint program = 0;
+	if (!RenderAssets::readShaderFile(assets.shaderPath(name + ".vs.glsl", HOT_RELOAD_DIR), vs_source) ||
+		!RenderAssets::readShaderFile(assets.shaderPath(name + ".fs.glsl", HOT_RELOAD_DIR), fs_source) ||
+		!compileEffect(vs_source, fs_source, false, program))
+	{
+		fprintf(stderr, "Reloading the %s effect failed, keeping the old one\n", name.c_str());
+		return false;
+	}
+	glDeleteProgram(effects[i]);
+	effects[i] = program;
+	resolveEffectPipeline((EFFECT_ASSET_ID)i);
+	printf("Reloaded the %s effect\n", name.c_str());
+	return true;
+}
+
+// Textures share atlas pages, so only the texture's own rect is uploaded again
+bool GlRenderBackend::reloadTexture(uint i)
+{
+	const std::string path = assets.texturePath(i, HOT_RELOAD_DIR);
+	std::vector<unsigned char> block;
+	ivec2 position, size;
+	if (!assets.readTextureBlock(i, path, block, position, size))
+	{
+		fprintf(stderr, "Reloading %s failed, keeping the old texture\n", path.c_str());
+		return false;
+	}
+	glBindTexture(GL_TEXTURE_2D, texture_gl_handles[i]);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, position.x, position.y, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, block.data());
+	gl_has_errors();
+	printf("Reloaded %s\n", path.c_str());
+	return true;
+}
+#endif
+
+// Attribute layouts of the vertex types, recorded into the currently bound VAO
+static void setVertexAttributes(const ColoredVertex*)
+{
+	glEnableVertexAttribArray((GLuint)ATTRIBUTE_LOCATION::POSITION);
+	glVertexAttribPointer((GLuint)ATTRIBUTE_LOCATION::POSITION, 3, GL_FLOAT, GL_FALSE,
+						  sizeof(ColoredVertex), (void *)0);
+	glEnableVertexAttribArray((GLuint)ATTRIBUTE_LOCATION::COLOR);
+	glVertexAttribPointer((GLuint)ATTRIBUTE_LOCATION::COLOR, 3, GL_FLOAT, GL_FALSE,
+						  sizeof(ColoredVertex), (void *)sizeof(vec3));
+}
+
+static void setVertexAttributes(const TexturedVertex*)
+{
+	glEnableVertexAttribArray((GLuint)ATTRIBUTE_LOCATION::POSITION);
+	glVertexAttribPointer((GLuint)ATTRIBUTE_LOCATION::POSITION, 3, GL_FLOAT, GL_FALSE,
+						  sizeof(TexturedVertex), (void *)0);
+	glEnableVertexAttribArray((GLuint)ATTRIBUTE_LOCATION::TEXCOORD);
+	glVertexAttribPointer((GLuint)ATTRIBUTE_LOCATION::TEXCOORD, 2, GL_FLOAT, GL_FALSE,
+						  sizeof(TexturedVertex), (void *)sizeof(vec3)); // note the stride to skip the preceeding vertex position
+}
+
+static void setVertexAttributes(const vec3*)
+{
+	glEnableVertexAttribArray((GLuint)ATTRIBUTE_LOCATION::POSITION);
+	glVertexAttribPointer((GLuint)ATTRIBUTE_LOCATION::POSITION, 3, GL_FLOAT, GL_FALSE,
+						  sizeof(vec3), (void *)0);
+}
+
+// The data may point into the mapped asset archive, which glBufferData reads directly
+template <class T>
+void GlRenderBackend::bindVBOandIBO(GEOMETRY_BUFFER_ID gid, const RenderAssets::GeometryData& data)
+{
+	// The VAO remembers the index buffer and the attribute layout for drawing
+	glBindVertexArray(vertex_arrays[(uint)gid]);
+	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(uint)gid]);
+	glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)data.vertex_bytes, data.vertices, GL_STATIC_DRAW);
+	gl_has_errors();
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffers[(uint)gid]);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+		(GLsizeiptr)(data.index_size * data.index_count), data.indices, GL_STATIC_DRAW);
+	gl_has_errors();
+
+	setVertexAttributes((const T*)nullptr);
+	index_counts[(uint)gid] = (GLsizei)data.index_count;
+	index_types[(uint)gid] = data.index_size == sizeof(uint32_t) ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+	gl_has_errors();
+}
+
+void GlRenderBackend::initializeGlGeometryBuffers()
+{
+	// Vertex Buffer creation.
+	glGenBuffers((GLsizei)vertex_buffers.size(), vertex_buffers.data());
+	// Index Buffer creation.
+	glGenBuffers((GLsizei)index_buffers.size(), index_buffers.data());
+	// Vertex array objects, one per geometry
+	glGenVertexArrays((GLsizei)vertex_arrays.size(), vertex_arrays.data());
+	// Per instance data, refilled every frame
+	instance_stream.init(initial_instance_stream_size);
+	glGenVertexArrays(1, &sprite_instanced_vao);
+	glGenVertexArrays(1, &debug_lines_vao);
+	index_counts.fill(0);
+	index_types.fill(GL_UNSIGNED_SHORT);
+
+	// Index and Vertex buffer data initialization.
+	for (uint i = 0; i < geometry_count; i++)
+	{
+		const GEOMETRY_BUFFER_ID gid = (GEOMETRY_BUFFER_ID)i;
+		const RenderAssets::GeometryData& data = assets.geometry_data[i];
+		if (data.vertices == nullptr)
+			continue;
+		if (gid == GEOMETRY_BUFFER_ID::SPRITE)
+			bindVBOandIBO<TexturedVertex>(gid, data);
+		else if (gid == GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE)
+			bindVBOandIBO<vec3>(gid, data);
+		else
+			bindVBOandIBO<ColoredVertex>(gid, data);
+	}
+
+	// Same quad for the instanced path, plus the per instance attributes that
+	// advance once per sprite. The mat3 takes one attribute per column.
+	glBindVertexArray(sprite_instanced_vao);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffers[(uint)GEOMETRY_BUFFER_ID::SPRITE]);
+	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(uint)GEOMETRY_BUFFER_ID::SPRITE]);
+	setVertexAttributes((const TexturedVertex*)nullptr);
+	for (uint loc = (uint)ATTRIBUTE_LOCATION::COLOR; loc <= (uint)ATTRIBUTE_LOCATION::TEXTURE_INDEX; loc++)
+	{
+		glEnableVertexAttribArray(loc);
+		glVertexAttribDivisor(loc, 1);
+	}
+	setSpriteInstanceAttributes(0);
+	gl_has_errors();
+
+	// Debug lines have no buffer of their own, drawDebugLines() points the
+	// attributes into the instance stream every frame
+	glBindVertexArray(debug_lines_vao);
+	glEnableVertexAttribArray((GLuint)ATTRIBUTE_LOCATION::POSITION);
+	glEnableVertexAttribArray((GLuint)ATTRIBUTE_LOCATION::COLOR);
+	gl_has_errors();
+}
+
+GlRenderBackend::~GlRenderBackend()
+{
+	// Don't need to free gl resources since they last for as long as the program,
+	// but it's polite to clean after yourself.
+	glDeleteBuffers((GLsizei)vertex_buffers.size(), vertex_buffers.data());
+	glDeleteBuffers((GLsizei)index_buffers.size(), index_buffers.data());
+	instance_stream.destroy();
+	glDeleteVertexArrays((GLsizei)vertex_arrays.size(), vertex_arrays.data());
+	glDeleteVertexArrays(1, &sprite_instanced_vao);
+	glDeleteVertexArrays(1, &debug_lines_vao);
+	glDeleteTextures((GLsizei)atlas_textures.size(), atlas_textures.data());
+	glDeleteTextures(1, &off_screen_render_buffer_color);
+	glDeleteRenderbuffers(1, &off_screen_render_buffer_depth);
+	gl_has_errors();
+
+	for(uint i = 0; i < effect_count; i++) {
+		glDeleteProgram(effects[i]);
+	}
+	// delete allocated resources
+	glDeleteFramebuffers(1, &frame_buffer);
+	gl_has_errors();
+}
+
+// Initialize the screen texture from a standard sprite
+bool GlRenderBackend::initScreenTexture()
+{
+	const int framebuffer_width = framebuffer_size.x;
+	const int framebuffer_height = framebuffer_size.y;
+
+	glGenTextures(1, &off_screen_render_buffer_color);
+	glBindTexture(GL_TEXTURE_2D, off_screen_render_buffer_color);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, framebuffer_width, framebuffer_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	gl_has_errors();
+
+	glGenRenderbuffers(1, &off_screen_render_buffer_depth);
+	glBindRenderbuffer(GL_RENDERBUFFER, off_screen_render_buffer_depth);
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, off_screen_render_buffer_color, 0);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, framebuffer_width, framebuffer_height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, off_screen_render_buffer_depth);
+	gl_has_errors();
+
+	assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+
+	return true;
+}
+
+bool gl_compile_shader(GLuint shader)
+{
+	glCompileShader(shader);
+	gl_has_errors();
+	GLint success = 0;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+	if (success == GL_FALSE)
+	{
+		GLint log_len;
+		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &log_len);
+		std::vector<char> log(log_len);
+		glGetShaderInfoLog(shader, log_len, &log_len, log.data());
+		glDeleteShader(shader);
+
+		gl_has_errors();
+
+		fprintf(stderr, "GLSL: %s", log.data());
+		return false;
+	}
+
+	return true;
+}
+
+bool loadEffectFromFile(
+	const std::string& vs_path, const std::string& fs_path, GLuint& out_program)
+{
+	std::string vs_str, fs_str;
+	if (!readEffectSources(vs_path, fs_path, vs_str, fs_str))
+		return false;
+	return compileEffect(vs_str, fs_str, false, out_program);
+}
+
+bool readEffectSources(const std::string& vs_path, const std::string& fs_path,
+	std::string& out_vs_source, std::string& out_fs_source)
+{
+	// Opening files
+	std::ifstream vs_is(vs_path);
+	std::ifstream fs_is(fs_path);
+	if (!vs_is.good() || !fs_is.good())
+	{
+		fprintf(stderr, "Failed to load shader files %s, %s", vs_path.c_str(), fs_path.c_str());
+		assert(false);
+		return false;
+	}
+
+	// Reading sources
+	std::stringstream vs_ss, fs_ss;
+	vs_ss << vs_is.rdbuf();
+	fs_ss << fs_is.rdbuf();
+	out_vs_source = vs_ss.str();
+	out_fs_source = fs_ss.str();
+	return true;
+}
+
+bool compileEffect(const std::string& vs_str, const std::string& fs_str, bool retrievable, GLuint& out_program)
+{
+	const char* vs_src = vs_str.c_str();
+	const char* fs_src = fs_str.c_str();
+	GLsizei vs_len = (GLsizei)vs_str.size();
+	GLsizei fs_len = (GLsizei)fs_str.size();
+
+	GLuint vertex = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(vertex, 1, &vs_src, &vs_len);
+	GLuint fragment = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(fragment, 1, &fs_src, &fs_len);
+	gl_has_errors();
+
+	// Compiling. Failing is up to the caller, hot reloading keeps the old program
+	if (!gl_compile_shader(vertex))
+	{
+		fprintf(stderr, "Vertex compilation failed\n");
+		glDeleteShader(fragment);
+		return false;
+	}
+	if (!gl_compile_shader(fragment))
+	{
+		fprintf(stderr, "Fragment compilation failed\n");
+		glDeleteShader(vertex);
+		return false;
+	}
+
+	// Linking
+	out_program = glCreateProgram();
+	glAttachShader(out_program, vertex);
+	glAttachShader(out_program, fragment);
+	// Same attribute locations in every program, names a shader does not use are ignored
+	for (uint i = 0; i < attribute_count; i++)
+		glBindAttribLocation(out_program, i, attribute_names[i]);
+	// Lets ProgramCache read the linked binary back
+	if (retrievable)
+		glProgramParameteri(out_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(out_program);
+	gl_has_errors();
+
+	{
+		GLint is_linked = GL_FALSE;
+		glGetProgramiv(out_program, GL_LINK_STATUS, &is_linked);
+		if (is_linked == GL_FALSE)
+		{
+			GLint log_len;
+			glGetProgramiv(out_program, GL_INFO_LOG_LENGTH, &log_len);
+			std::vector<char> log(log_len);
+			glGetProgramInfoLog(out_program, log_len, &log_len, log.data());
+			gl_has_errors();
+
+			fprintf(stderr, "Link error: %s", log.data());
+			glDeleteProgram(out_program);
+			glDeleteShader(vertex);
+			glDeleteShader(fragment);
+			out_program = 0;
+			return false;
+		}
+	}
+
+	// No need to carry this around. Keeping these objects is only useful if we recycle
+	// the same shaders over and over, which we don't, so no need and this is simpler.
+	glDetachShader(out_program, vertex);
+	glDetachShader(out_program, fragment);
+	glDeleteShader(vertex);
+	glDeleteShader(fragment);
+	gl_has_errors();
+
+	return true;
+}
+
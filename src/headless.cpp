@@ -0,0 +1,149 @@
+// internal
+#include "headless.hpp"
+#include "ai_system.hpp"
+#include "audio_backend.hpp"
+#include "input_recording.hpp"
+#include "input_script.hpp"
+#include "physics_system.hpp"
+#include "profiler.hpp"
+#include "render_assets.hpp"
+#include "render_system.hpp"
+#include "state_system.h"
+#include "tiny_ecs_registry.hpp"
+#include "world_system.hpp"
+
+// stlib
+#include <chrono>
+#include <memory>
+#include <thread>
+
+using Clock = std::chrono::high_resolution_clock;
+
+namespace {
+	// FNV-1a over where everything is and how it moves, equal for two runs
+	// that played out the same
+	uint64_t world_checksum() {
+		uint64_t hash = 14695981039346656037ull;
+		auto add = [&hash](const void* data, size_t size) {
+			for (size_t i = 0; i < size; i++)
+				hash = (hash ^ ((const uint8_t*)data)[i]) * 1099511628211ull;
+		};
+		for (uint i = 0; i < registry.motions.size(); i++) {
+			const Motion& motion = registry.motions.components[i];
+			add(&motion.position, sizeof(motion.position));
+			add(&motion.velocity, sizeof(motion.velocity));
+			add(&motion.angle, sizeof(motion.angle));
+		}
+		unsigned points = StateSystem::get_points();
+		add(&points, sizeof(points));
+		return hash;
+	}
+}
+
+int run_headless(const HeadlessOptions& options)
+{
+	StateSystem state;
+	WorldSystem world;
+	PhysicsSystem physics;
+	AISystem ai;
+	// Only the meshes and hulls are needed, unless frames are captured with the
+	// software renderer, which brings its own
+	RenderAssets assets;
+	std::unique_ptr<RenderSystem> renderer;
+	bool capturing = !options.capture_dir.empty();
+	NullAudioBackend audio;
+
+	InputScript script;
+	InputReplay replay;
+	bool replaying = !options.replay_path.empty();
+	if (replaying) {
+		if (!replay.open(options.replay_path))
+			return EXIT_FAILURE;
+		world.set_seed(replay.get_seed());
+	}
+	else if (options.script_path.empty())
+		script.load_default();
+	else if (!script.load(options.script_path))
+		return EXIT_FAILURE;
+
+	if (!replaying && options.seed >= 0)
+		world.set_seed((uint32_t)options.seed);
+
+	InputRecorder recorder;
+	if (!options.record_path.empty()) {
+		if (!recorder.start(options.record_path, world.get_seed()))
+			return EXIT_FAILURE;
+		world.set_recorder(&recorder);
+	}
+
+	RenderAssets* world_assets = &assets;
+	if (capturing) {
+		renderer.reset(new RenderSystem());
+		if (!renderer->init_headless(options.capture_size))
+			return EXIT_FAILURE;
+		world_assets = &renderer->get_assets();
+		renderer->start();
+	}
+	else if (!assets.load())
+		return EXIT_FAILURE;
+	world.init(world_assets, &physics, &audio);
+	ai.init(&physics);
+	state.init();
+
+	unsigned steps = options.steps;
+	if (steps == 0)
+		steps = replaying ? UINT_MAX : 10000;
+
+	PROFILE_THREAD_NAME("simulation");
+	auto start = Clock::now();
+	unsigned step = 0;
+	unsigned captured = 0;
+	float undrawn_ms = 0.f; // simulated since the last drawn frame, for the water effect
+	for (; step < steps && !world.is_over(); step++) {
+		PROFILE_SCOPE("frame");
+		float elapsed_ms = options.step_ms;
+		if (replaying) {
+			if (!replay.next_step(world, elapsed_ms))
+				break;
+		}
+		else
+			script.apply(step, world);
+		world.step(elapsed_ms);
+		ai.step(elapsed_ms);
+		physics.step(elapsed_ms);
+		world.handle_collisions();
+
+		undrawn_ms += elapsed_ms;
+		if (capturing && step % options.capture_every == 0) {
+			char name[32];
+			snprintf(name, sizeof(name), "/frame_%05u.png", step);
+			renderer->capture_frame(options.capture_dir + name);
+			renderer->submit_frame(undrawn_ms);
+			undrawn_ms = 0.f;
+			captured++;
+			// A newer snapshot would replace this one if the render thread hasn't picked it up yet
+			while (renderer->is_frame_pending())
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+	}
+	// finishes drawing the last frame
+	if (capturing)
+		renderer->stop();
+	float run_ms =
+		(float)(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start)).count() / 1000;
+
+	printf("Headless: %u steps in %.1f ms, %.0f steps/s (%.1f us/step)\n",
+		step, run_ms,
+		run_ms > 0.f ? step * 1000.f / run_ms : 0.f,
+		step > 0 ? run_ms * 1000.f / step : 0.f);
+	if (capturing)
+		printf("Captured %u frames to %s\n", captured, options.capture_dir.c_str());
+	printf("Seed %u, %u points, checksum %016llx\n",
+		world.get_seed(), StateSystem::get_points(), (unsigned long long)world_checksum());
+	recorder.stop();
+#ifdef PROFILER
+	if (profiler::write_chrome_trace("trace.json"))
+		printf("Saved the profile to trace.json\n");
+#endif
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+
+#include "common.hpp"
+
+// Options of a run without window, audio or GL, see main.cpp for the flags
+struct HeadlessOptions
+{
+	unsigned steps = 0; // 0 runs 10000 steps, or the whole replay
+	float step_ms = 1000.f / 60.f; // fixed, so runs with the same script play out the same
+	std::string script_path; // the built-in InputScript if empty
+	std::string replay_path; // input and step times from a recording instead of the script
+	std::string record_path; // records the run if not empty
+	long long seed = -1; // of the world's rng, a random one if negative. Replays bring their own.
+	// Draws every capture_every-th step with the software renderer and saves it to
+	// capture_dir/frame_00042.png, for comparing against golden images with
+	// tools/golden_compare.cpp. The directory has to exist. Nothing is drawn if empty.
+	std::string capture_dir;
+	unsigned capture_every = 1;
+	ivec2 capture_size = { window_width_px, window_height_px };
+};
+
+// Steps the world, physics and collisions as fast as the CPU allows on
+// scripted or replayed input and reports the steps per second, along with a
+// checksum of the final state to compare runs by. Returns the exit code.
+int run_headless(const HeadlessOptions& options);
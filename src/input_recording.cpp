@@ -0,0 +1,312 @@
+// internal
+#include "input_recording.hpp"
+#include "world_system.hpp"
+
+// stlib
+#include <cmath>
+#include <cstring>
+
+using namespace input_recording;
+
+namespace {
+	const char magic[4] = { 'D', 'C', 'I', 'R' };
+	// Handed to the writer once this full, a few seconds of play
+	const size_t buffer_size = 4096;
+
+	const uint8_t raw_flag = 1 << 4;
+
+	uint64_t zigzag(int64_t value) {
+		return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+	}
+
+	int64_t unzigzag(uint64_t value) {
+		return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+	}
+
+	void put_varint(std::vector<uint8_t>& out, uint64_t value) {
+		while (value >= 0x80) {
+			out.push_back((uint8_t)(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back((uint8_t)value);
+	}
+
+	void put_float(std::vector<uint8_t>& out, float value) {
+		uint8_t bytes[sizeof(float)];
+		memcpy(bytes, &value, sizeof(float));
+		out.insert(out.end(), bytes, bytes + sizeof(float));
+	}
+
+	// Exactly representable as a small integer, mouse positions mostly are
+	bool is_whole(float value) {
+		return std::floor(value) == value && std::fabs(value) < 16777216.f;
+	}
+
+	// Reads off the recording, setting ok to false instead of reading past its end
+	struct Reader
+	{
+		const std::vector<uint8_t>& data;
+		size_t& offset;
+		bool ok = true;
+
+		uint64_t varint() {
+			uint64_t value = 0;
+			for (int shift = 0; shift < 64; shift += 7) {
+				if (offset >= data.size())
+					break;
+				uint8_t byte = data[offset++];
+				value |= (uint64_t)(byte & 0x7f) << shift;
+				if ((byte & 0x80) == 0)
+					return value;
+			}
+			ok = false;
+			return 0;
+		}
+
+		uint8_t byte() {
+			if (offset >= data.size()) {
+				ok = false;
+				return 0;
+			}
+			return data[offset++];
+		}
+
+		float raw_float() {
+			float value = 0.f;
+			if (offset + sizeof(float) > data.size())
+				ok = false;
+			else {
+				memcpy(&value, &data[offset], sizeof(float));
+				offset += sizeof(float);
+			}
+			return value;
+		}
+	};
+}
+
+bool InputRecorder::start(const std::string& path, uint32_t seed)
+{
+	stop();
+	file.open(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		fprintf(stderr, "Failed to open %s for recording\n", path.c_str());
+		return false;
+	}
+
+	buffer.clear();
+	buffer.reserve(buffer_size * 2);
+	step_events.clear();
+	step_event_count = 0;
+	last_elapsed_us = 0;
+	last_mouse = { 0.f, 0.f };
+	buffer.insert(buffer.end(), magic, magic + sizeof(magic));
+	put_varint(buffer, format_version);
+	put_varint(buffer, seed);
+
+	recording = true;
+	running = true;
+	writer = std::thread(&InputRecorder::write_loop, this);
+	return true;
+}
+
+void InputRecorder::stop()
+{
+	if (!recording)
+		return;
+	recording = false;
+	{
+		// input of a step that never ran is dropped
+		std::lock_guard<std::mutex> lock(mutex);
+		full_buffers.push_back(std::move(buffer));
+		running = false;
+	}
+	wake.notify_one();
+	writer.join();
+	file.close();
+	buffer = std::vector<uint8_t>();
+	full_buffers.clear();
+	spare_buffers.clear();
+}
+
+void InputRecorder::key(int key, int action, int mods)
+{
+	if (!recording)
+		return;
+	step_events.push_back((uint8_t)((int)EVENT_TYPE::KEY | action << 2));
+	put_varint(step_events, zigzag(key));
+	put_varint(step_events, (uint64_t)mods);
+	step_event_count++;
+}
+
+void InputRecorder::mouse_move(vec2 position)
+{
+	if (!recording)
+		return;
+	if (is_whole(position.x) && is_whole(position.y) && is_whole(last_mouse.x) && is_whole(last_mouse.y)) {
+		step_events.push_back((uint8_t)EVENT_TYPE::MOUSE_MOVE);
+		put_varint(step_events, zigzag((int64_t)position.x - (int64_t)last_mouse.x));
+		put_varint(step_events, zigzag((int64_t)position.y - (int64_t)last_mouse.y));
+	}
+	else {
+		step_events.push_back((uint8_t)EVENT_TYPE::MOUSE_MOVE | raw_flag);
+		put_float(step_events, position.x);
+		put_float(step_events, position.y);
+	}
+	last_mouse = position;
+	step_event_count++;
+}
+
+void InputRecorder::mouse_button(int button, int action)
+{
+	if (!recording)
+		return;
+	step_events.push_back((uint8_t)((int)EVENT_TYPE::BUTTON | action << 2));
+	put_varint(step_events, (uint64_t)button);
+	step_event_count++;
+}
+
+void InputRecorder::end_step(float elapsed_ms)
+{
+	if (!recording)
+		return;
+	// main.cpp measures whole microseconds, those are stored as small deltas
+	int64_t elapsed_us = (int64_t)llroundf(elapsed_ms * 1000.f);
+	if ((float)elapsed_us / 1000 == elapsed_ms) {
+		put_varint(buffer, zigzag(elapsed_us - last_elapsed_us) << 1);
+		last_elapsed_us = elapsed_us;
+	}
+	else {
+		put_varint(buffer, 1);
+		put_float(buffer, elapsed_ms);
+	}
+	put_varint(buffer, step_event_count);
+	buffer.insert(buffer.end(), step_events.begin(), step_events.end());
+	step_events.clear();
+	step_event_count = 0;
+
+	flush_if_full();
+}
+
+void InputRecorder::flush_if_full()
+{
+	if (buffer.size() < buffer_size)
+		return;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		full_buffers.push_back(std::move(buffer));
+		// the writer gives the buffers back, so after the first few this allocates nothing
+		if (!spare_buffers.empty()) {
+			buffer = std::move(spare_buffers.back());
+			spare_buffers.pop_back();
+		}
+		else
+			buffer = std::vector<uint8_t>();
+	}
+	wake.notify_one();
+	buffer.clear();
+	buffer.reserve(buffer_size * 2);
+}
+
+void InputRecorder::write_loop()
+{
+	std::vector<std::vector<uint8_t>> writing;
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		wake.wait(lock, [this] { return !full_buffers.empty() || !running; });
+		writing.swap(full_buffers);
+		bool last = !running;
+		lock.unlock();
+
+		for (std::vector<uint8_t>& written : writing)
+			file.write((const char*)written.data(), (std::streamsize)written.size());
+		file.flush();
+
+		lock.lock();
+		for (std::vector<uint8_t>& written : writing)
+			spare_buffers.push_back(std::move(written));
+		writing.clear();
+		if (last && full_buffers.empty())
+			return;
+	}
+}
+
+bool InputReplay::open(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open()) {
+		fprintf(stderr, "Failed to open recording %s\n", path.c_str());
+		return false;
+	}
+	data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	offset = 0;
+	last_elapsed_us = 0;
+	last_mouse = { 0.f, 0.f };
+
+	if (data.size() < sizeof(magic) || memcmp(data.data(), magic, sizeof(magic)) != 0) {
+		fprintf(stderr, "%s is not an input recording\n", path.c_str());
+		return false;
+	}
+	offset = sizeof(magic);
+	Reader reader = { data, offset };
+	uint64_t version = reader.varint();
+	seed = (uint32_t)reader.varint();
+	if (!reader.ok || version != format_version) {
+		fprintf(stderr, "%s was recorded with another format version\n", path.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool InputReplay::next_step(WorldSystem& world, float& out_elapsed_ms)
+{
+	if (offset >= data.size())
+		return false;
+	Reader reader = { data, offset };
+
+	uint64_t time = reader.varint();
+	if (time == 1)
+		out_elapsed_ms = reader.raw_float();
+	else {
+		last_elapsed_us += unzigzag(time >> 1);
+		out_elapsed_ms = (float)last_elapsed_us / 1000;
+	}
+
+	uint64_t count = reader.varint();
+	for (uint64_t i = 0; i < count && reader.ok; i++)
+	{
+		uint8_t header = reader.byte();
+		int action = (header >> 2) & 3;
+		switch ((EVENT_TYPE)(header & 3))
+		{
+		case EVENT_TYPE::KEY: {
+			int key = (int)unzigzag(reader.varint());
+			int mods = (int)reader.varint();
+			world.inject_key(key, action, mods);
+			break;
+		}
+		case EVENT_TYPE::MOUSE_MOVE:
+			if (header & raw_flag) {
+				last_mouse.x = reader.raw_float();
+				last_mouse.y = reader.raw_float();
+			}
+			else {
+				last_mouse.x = (float)((int64_t)last_mouse.x + unzigzag(reader.varint()));
+				last_mouse.y = (float)((int64_t)last_mouse.y + unzigzag(reader.varint()));
+			}
+			world.inject_mouse_move(last_mouse);
+			break;
+		case EVENT_TYPE::BUTTON:
+			world.inject_mouse_button((int)reader.varint(), action);
+			break;
+		default:
+			reader.ok = false;
+		}
+	}
+	if (!reader.ok) {
+		fprintf(stderr, "The recording ends in the middle of a step\n");
+		offset = data.size();
+		return false;
+	}
+	return true;
+}
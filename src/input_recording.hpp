@@ -0,0 +1,101 @@
+#pragma once
+
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common.hpp"
+
+class WorldSystem;
+
+// Input recordings, so a crash or a slow frame someone ran into can be played
+// back exactly. A recording holds the RNG seed of the world and, for every
+// step, the input WorldSystem got before it and the elapsed time it was given.
+//
+// Layout: "DCIR", format version and seed as varints, then one record per
+// step until the end of the file:
+//   time    varint, zigzag delta in microseconds from the previous step shifted
+//           left by one, or 1 followed by the raw float if the elapsed time is
+//           not a whole number of microseconds
+//   count   varint, number of events
+//   events  header byte (type | action << 2), then
+//             key:    key, mods as varints
+//             mouse:  zigzag deltas from the previous position as varints, or
+//                     with the raw flag in the header the two raw floats
+//             button: button as a varint
+// A step without input and with the same elapsed time as the last one is two bytes.
+namespace input_recording {
+	const uint32_t format_version = 1;
+
+	enum class EVENT_TYPE {
+		KEY = 0,
+		MOUSE_MOVE = KEY + 1,
+		BUTTON = MOUSE_MOVE + 1
+	};
+}
+
+// Encodes on the simulation thread into a buffer, a background thread writes
+// full buffers to the file, so recording costs a few byte stores per event.
+class InputRecorder
+{
+public:
+	InputRecorder() = default;
+	~InputRecorder() { stop(); }
+	InputRecorder(const InputRecorder&) = delete;
+	InputRecorder& operator=(const InputRecorder&) = delete;
+
+	bool start(const std::string& path, uint32_t seed);
+	// Writes out everything recorded so far and closes the file
+	void stop();
+	bool is_recording() const { return recording; }
+
+	// Input of the step that comes next, in the order WorldSystem gets it
+	void key(int key, int action, int mods);
+	void mouse_move(vec2 position);
+	void mouse_button(int button, int action);
+
+	// Closes the record of a step with its elapsed time
+	void end_step(float elapsed_ms);
+
+private:
+	void write_loop();
+	void flush_if_full();
+
+	bool recording = false;
+	std::ofstream file; // only touched by the writer while recording
+	std::vector<uint8_t> buffer; // being filled by the simulation thread
+	std::vector<uint8_t> step_events; // encoded events of the current step
+	uint32_t step_event_count = 0;
+	int64_t last_elapsed_us = 0;
+	vec2 last_mouse = { 0.f, 0.f };
+
+	std::thread writer;
+	std::mutex mutex;
+	std::condition_variable wake;
+	// guarded by mutex
+	std::vector<std::vector<uint8_t>> full_buffers;
+	std::vector<std::vector<uint8_t>> spare_buffers;
+	bool running = false;
+};
+
+// Plays a recording back, in place of the GLFW callbacks or an InputScript
+class InputReplay
+{
+public:
+	bool open(const std::string& path);
+	uint32_t get_seed() const { return seed; }
+
+	// Injects the input of the next step into world and gives its elapsed time.
+	// False once the recording is over.
+	bool next_step(WorldSystem& world, float& out_elapsed_ms);
+
+private:
+	std::vector<uint8_t> data;
+	size_t offset = 0;
+	uint32_t seed = 0;
+	int64_t last_elapsed_us = 0;
+	vec2 last_mouse = { 0.f, 0.f };
+};
@@ -0,0 +1,145 @@
+// internal
+#include "input_script.hpp"
+#include "world_system.hpp"
+
+// stlib
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace {
+	int parse_key(const std::string& name) {
+		if (name.size() == 1 && isalpha(name[0]))
+			return GLFW_KEY_A + (toupper(name[0]) - 'A');
+		if (name.size() == 1 && isdigit(name[0]))
+			return GLFW_KEY_0 + (name[0] - '0');
+		if (name == "left") return GLFW_KEY_LEFT;
+		if (name == "right") return GLFW_KEY_RIGHT;
+		if (name == "up") return GLFW_KEY_UP;
+		if (name == "down") return GLFW_KEY_DOWN;
+		if (name == "space") return GLFW_KEY_SPACE;
+		if (name == "escape") return GLFW_KEY_ESCAPE;
+		// anything else has to be a GLFW key code
+		char* end;
+		long code = strtol(name.c_str(), &end, 10);
+		return (*end == '\0' && !name.empty()) ? (int)code : GLFW_KEY_UNKNOWN;
+	}
+
+	int parse_button(const std::string& name) {
+		if (name == "left") return GLFW_MOUSE_BUTTON_LEFT;
+		if (name == "right") return GLFW_MOUSE_BUTTON_RIGHT;
+		if (name == "middle") return GLFW_MOUSE_BUTTON_MIDDLE;
+		return -1;
+	}
+
+	int parse_action(const std::string& name) {
+		if (name == "press") return GLFW_PRESS;
+		if (name == "release") return GLFW_RELEASE;
+		return -1;
+	}
+}
+
+bool InputScript::load(const std::string& path)
+{
+	std::ifstream file(path);
+	if (!file.is_open()) {
+		fprintf(stderr, "Failed to open input script %s\n", path.c_str());
+		return false;
+	}
+
+	events.clear();
+	std::string line;
+	for (int line_number = 1; std::getline(file, line); line_number++)
+	{
+		line = line.substr(0, line.find('#'));
+		std::istringstream words(line);
+		Event event = {};
+		std::string type;
+		if (!(words >> event.step))
+			continue; // blank or comment
+		words >> type;
+
+		bool valid = false;
+		if (type == "key") {
+			std::string key, action;
+			valid = bool(words >> key >> action);
+			event.type = EVENT_TYPE::KEY;
+			event.code = parse_key(key);
+			event.action = parse_action(action);
+			valid &= event.code != GLFW_KEY_UNKNOWN && event.action >= 0;
+		}
+		else if (type == "mouse") {
+			event.type = EVENT_TYPE::MOUSE_MOVE;
+			valid = bool(words >> event.position.x >> event.position.y);
+		}
+		else if (type == "button") {
+			std::string button, action;
+			valid = bool(words >> button >> action);
+			event.type = EVENT_TYPE::BUTTON;
+			event.code = parse_button(button);
+			event.action = parse_action(action);
+			valid &= event.code >= 0 && event.action >= 0;
+		}
+		if (!valid) {
+			fprintf(stderr, "%s:%d: can't read input event '%s'\n", path.c_str(), line_number, line.c_str());
+			return false;
+		}
+		events.push_back(event);
+	}
+
+	// stable, so events of the same step keep the order of the file
+	std::stable_sort(events.begin(), events.end(), [](const Event& a, const Event& b) { return a.step < b.step; });
+	length = events.empty() ? 0 : events.back().step + 1;
+	next = 0;
+	return true;
+}
+
+void InputScript::load_default()
+{
+	events.clear();
+	Event hold = {};
+	hold.type = EVENT_TYPE::BUTTON;
+	hold.code = GLFW_MOUSE_BUTTON_LEFT;
+	hold.action = GLFW_PRESS;
+	events.push_back(hold);
+
+	// about 1.5 s up, 1.5 s down at 60 steps a second
+	for (unsigned i = 0; i < 4; i++)
+	{
+		Event move = {};
+		move.step = i * 90;
+		move.type = EVENT_TYPE::MOUSE_MOVE;
+		move.position = vec2(window_width_px * 0.6f, window_height_px * ((i % 2 == 0) ? 0.2f : 0.8f));
+		events.push_back(move);
+	}
+	length = 4 * 90;
+	next = 0;
+}
+
+void InputScript::apply(unsigned step, WorldSystem& world)
+{
+	if (length == 0)
+		return;
+	unsigned script_step = step % length;
+	if (script_step == 0)
+		next = 0;
+
+	for (; next < events.size() && events[next].step <= script_step; next++)
+	{
+		const Event& event = events[next];
+		switch (event.type)
+		{
+		case EVENT_TYPE::KEY:
+			world.inject_key(event.code, event.action, 0);
+			break;
+		case EVENT_TYPE::MOUSE_MOVE:
+			world.inject_mouse_move(event.position);
+			break;
+		case EVENT_TYPE::BUTTON:
+			world.inject_mouse_button(event.code, event.action);
+			break;
+		}
+	}
+}
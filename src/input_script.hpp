@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+
+class WorldSystem;
+
+// Input for runs without a window, given by step number. Script files have one
+// event per line, '#' starts a comment:
+//   <step> key <name or GLFW key code> <press|release>
+//   <step> mouse <x> <y>
+//   <step> button <left|right|middle> <press|release>
+// Key names are the letters, digits and left, right, up, down, space, escape.
+// The script repeats once the step of its last event has passed.
+class InputScript
+{
+public:
+	bool load(const std::string& path);
+
+	// Holds the left mouse button and weaves the mouse up and down in front of
+	// the car, so advanced mode drives through barriers and bonuses
+	void load_default();
+
+	// Injects the events of this step into world
+	void apply(unsigned step, WorldSystem& world);
+
+private:
+	enum class EVENT_TYPE {
+		KEY = 0,
+		MOUSE_MOVE = KEY + 1,
+		BUTTON = MOUSE_MOVE + 1
+	};
+	struct Event
+	{
+		unsigned step;
+		EVENT_TYPE type;
+		int code; // key or mouse button
+		int action; // GLFW_PRESS or GLFW_RELEASE
+		vec2 position;
+	};
+
+	std::vector<Event> events; // sorted by step
+	unsigned length = 0;
+	size_t next = 0;
+};
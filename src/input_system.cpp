@@ -0,0 +1,108 @@
+// internal
+#include "input_system.hpp"
+
+void InputSystem::flush()
+{
+	while (!backlog.empty() && queue.push(backlog.front()))
+		backlog.pop_front();
+	if (move_pending && backlog.empty() && queue.push(pending_move, MOUSE_MOVE_HEADROOM))
+		move_pending = false;
+}
+
+void InputSystem::push_edge(const Event& event)
+{
+	// after the move that came before it, the button may depend on where the mouse is
+	if (move_pending) {
+		backlog.push_back(pending_move);
+		move_pending = false;
+	}
+	backlog.push_back(event);
+	flush();
+}
+
+void InputSystem::push_key(int key, int action, int mods)
+{
+	Event event = {};
+	event.type = EVENT_TYPE::KEY;
+	event.code = key;
+	event.action = action;
+	event.mods = mods;
+	event.time = Clock::now();
+	push_edge(event);
+}
+
+void InputSystem::push_mouse_move(vec2 position)
+{
+	Event event = {};
+	event.type = EVENT_TYPE::MOUSE_MOVE;
+	event.position = position;
+	event.time = Clock::now();
+	flush();
+	if (!backlog.empty() || !queue.push(event, MOUSE_MOVE_HEADROOM)) {
+		if (move_pending)
+			coalesced.fetch_add(1, std::memory_order_relaxed);
+		pending_move = event;
+		move_pending = true;
+	}
+}
+
+void InputSystem::push_mouse_button(int button, int action, int mods)
+{
+	Event event = {};
+	event.type = EVENT_TYPE::BUTTON;
+	event.code = button;
+	event.action = action;
+	event.mods = mods;
+	event.time = Clock::now();
+	push_edge(event);
+}
+
+void InputSystem::begin_frame()
+{
+	keys_pressed.reset();
+	keys_released.reset();
+	buttons_pressed.reset();
+	buttons_released.reset();
+	first_event = true;
+	latency_ms = 0.f;
+}
+
+bool InputSystem::poll(Event& out)
+{
+	if (!queue.pop(out))
+		return false;
+
+	if (first_event) {
+		latency_ms = (float)std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - out.time).count() / 1000;
+		first_event = false;
+	}
+
+	// repeats change nothing, the key is held already
+	switch (out.type)
+	{
+	case EVENT_TYPE::KEY:
+		if (is_key(out.code) && out.action == GLFW_PRESS) {
+			keys_held[out.code] = true;
+			keys_pressed[out.code] = true;
+		}
+		else if (is_key(out.code) && out.action == GLFW_RELEASE) {
+			keys_held[out.code] = false;
+			keys_released[out.code] = true;
+		}
+		break;
+	case EVENT_TYPE::MOUSE_MOVE:
+		mouse = out.position;
+		break;
+	case EVENT_TYPE::BUTTON:
+		if (is_button(out.code) && out.action == GLFW_PRESS) {
+			buttons_held[out.code] = true;
+			buttons_pressed[out.code] = true;
+		}
+		else if (is_button(out.code) && out.action == GLFW_RELEASE) {
+			buttons_held[out.code] = false;
+			buttons_released[out.code] = true;
+		}
+		break;
+	}
+	return true;
+}
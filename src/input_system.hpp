@@ -0,0 +1,132 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <chrono>
+#include <deque>
+
+#include "common.hpp"
+
+// Lock free queue from one producer thread to one consumer thread, with room
+// for Capacity - 1 values. push() fails instead of waiting when it is full.
+template <class T, size_t Capacity>
+class SpscQueue
+{
+	static_assert((Capacity & (Capacity - 1)) == 0, "Capacity has to be a power of two");
+public:
+	// Producer side. Fails unless more than keep_free slots are free, so less
+	// important values can leave room for the others.
+	bool push(const T& value, size_t keep_free = 0) {
+		size_t tail = write.load(std::memory_order_relaxed);
+		size_t free = (read.load(std::memory_order_acquire) - tail - 1) & (Capacity - 1);
+		if (free <= keep_free)
+			return false;
+		size_t next = (tail + 1) & (Capacity - 1);
+		slots[tail] = value;
+		write.store(next, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer side
+	bool pop(T& out) {
+		size_t head = read.load(std::memory_order_relaxed);
+		if (head == write.load(std::memory_order_acquire))
+			return false;
+		out = slots[head];
+		read.store((head + 1) & (Capacity - 1), std::memory_order_release);
+		return true;
+	}
+
+private:
+	std::array<T, Capacity> slots;
+	// on their own cache lines, each side only writes its own
+	alignas(64) std::atomic<size_t> write{ 0 };
+	alignas(64) std::atomic<size_t> read{ 0 };
+};
+
+// Keyboard and mouse state. The GLFW callbacks (or an InputScript or replay)
+// queue events as they come in, begin_frame() and poll() apply them all just
+// before the simulation step, so a step sees one consistent state with the
+// freshest input. Keys and buttons are bits indexed by their GLFW code.
+//
+// Key and button events are never lost, a lost release would leave the key
+// held. Mouse moves leave the last MOUSE_MOVE_HEADROOM slots of the queue to
+// them, once the queue is that full only the latest move is kept back. What
+// doesn't fit waits on the producer side, in order, for flush() or the next push.
+class InputSystem
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	enum class EVENT_TYPE {
+		KEY = 0,
+		MOUSE_MOVE = KEY + 1,
+		BUTTON = MOUSE_MOVE + 1
+	};
+	struct Event
+	{
+		EVENT_TYPE type;
+		int code; // key or mouse button
+		int action; // GLFW_PRESS, GLFW_RELEASE or GLFW_REPEAT
+		int mods;
+		vec2 position;
+		Clock::time_point time; // when it was queued
+	};
+
+	// Producer side
+	void push_key(int key, int action, int mods);
+	void push_mouse_move(vec2 position);
+	void push_mouse_button(int button, int action, int mods);
+	// Queues what was held back for lack of room, as far as it fits now
+	void flush();
+
+	// Consumer side. Forgets the edges of the last frame.
+	void begin_frame();
+	// Takes the next queued event and applies it to the state, false once
+	// the queue is empty
+	bool poll(Event& out);
+
+	// Down now, went down this frame, went up this frame
+	bool held(int key) const { return is_key(key) && keys_held[key]; }
+	bool pressed(int key) const { return is_key(key) && keys_pressed[key]; }
+	bool released(int key) const { return is_key(key) && keys_released[key]; }
+	bool button_held(int button) const { return is_button(button) && buttons_held[button]; }
+	bool button_pressed(int button) const { return is_button(button) && buttons_pressed[button]; }
+	bool button_released(int button) const { return is_button(button) && buttons_released[button]; }
+	vec2 mouse_position() const { return mouse; }
+
+	// How long the oldest event of this frame waited in the queue
+	float get_latency_ms() const { return latency_ms; }
+	// Mouse moves merged into a later one for lack of room since the start
+	size_t get_coalesced() const { return coalesced.load(std::memory_order_relaxed); }
+
+	static const size_t QUEUE_CAPACITY = 256;
+	static const size_t MOUSE_MOVE_HEADROOM = 64;
+
+private:
+	static bool is_key(int key) { return key >= 0 && key <= GLFW_KEY_LAST; }
+	static bool is_button(int button) { return button >= 0 && button <= GLFW_MOUSE_BUTTON_LAST; }
+	// Keys and buttons
+	void push_edge(const Event& event);
+
+	// A few seconds of frantic typing, the queue is emptied every frame
+	SpscQueue<Event, QUEUE_CAPACITY> queue;
+	std::atomic<size_t> coalesced{ 0 };
+
+	// Producer side only: events that didn't fit yet, oldest first, and the
+	// latest mouse move if it didn't
+	std::deque<Event> backlog;
+	bool move_pending = false;
+	Event pending_move;
+
+	std::bitset<GLFW_KEY_LAST + 1> keys_held;
+	std::bitset<GLFW_KEY_LAST + 1> keys_pressed;
+	std::bitset<GLFW_KEY_LAST + 1> keys_released;
+	std::bitset<GLFW_MOUSE_BUTTON_LAST + 1> buttons_held;
+	std::bitset<GLFW_MOUSE_BUTTON_LAST + 1> buttons_pressed;
+	std::bitset<GLFW_MOUSE_BUTTON_LAST + 1> buttons_released;
+	vec2 mouse = { 0.f, 0.f };
+	bool first_event = true; // of this frame, for latency_ms
+	float latency_ms = 0.f;
+};
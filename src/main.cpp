@@ -4,27 +4,151 @@
 
 // stlib
 #include <chrono>
+#include <cstring>
+#include <thread>
 
 // internal
+#include "ai_system.hpp"
+#include "asset_loader.hpp"
+#include "headless.hpp"
+#include "input_recording.hpp"
+#include "mixer_audio_backend.hpp"
 #include "physics_system.hpp"
+#include "profiler.hpp"
+#include "render_benchmark.hpp"
 #include "render_system.hpp"
 #include "state_system.h"
+#include "stress_test.hpp"
 #include "world_system.hpp"
 
 using Clock = std::chrono::high_resolution_clock;
 
+namespace {
+	int invalid_value(const char* option, const char* value) {
+		fprintf(stderr, "Invalid value for %s: %s\n", option, value);
+		return EXIT_FAILURE;
+	}
+}
+
 // Entry point
-int main()
+// --headless [--steps N] [--step-ms MS] [--script FILE] [--seed N] runs the simulation
+// without window, audio or GL, see headless.hpp. With --capture DIR
+// [--capture-every N] it also draws frames with the software renderer into DIR
+// --record FILE saves the input to replay it with --replay FILE, in either mode
+// --stress [--config FILE] [--setting VALUE ...] measures how the systems
+// scale with the entity count, see stress_test.hpp
+// --render-benchmark [--sprites N] [--frames N] times drawing a screen full of
+// sprites with OpenGL, see render_benchmark.hpp
+int main(int argc, char* argv[])
 {
+	if (argc > 1 && strcmp(argv[1], "--stress") == 0) {
+		StressConfig config;
+		if (!config.parse_args(argc - 2, argv + 2))
+			return EXIT_FAILURE;
+		return run_stress(config);
+	}
+
+	if (argc > 1 && strcmp(argv[1], "--render-benchmark") == 0) {
+		RenderBenchmarkOptions benchmark;
+		for (int i = 2; i < argc; i++) {
+			if (strcmp(argv[i], "--sprites") == 0 && i + 1 < argc) {
+				if (!parse_unsigned(argv[++i], benchmark.sprites))
+					return invalid_value("--sprites", argv[i]);
+			}
+			else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+				if (!parse_unsigned(argv[++i], benchmark.frames) || benchmark.frames == 0)
+					return invalid_value("--frames", argv[i]);
+			}
+			else {
+				fprintf(stderr, "Unknown argument %s\n", argv[i]);
+				return EXIT_FAILURE;
+			}
+		}
+		return run_render_benchmark(benchmark);
+	}
+
+	bool headless = false;
+	HeadlessOptions options;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--headless") == 0)
+			headless = true;
+		else if (strcmp(argv[i], "--steps") == 0 && i + 1 < argc) {
+			if (!parse_unsigned(argv[++i], options.steps))
+				return invalid_value("--steps", argv[i]);
+		}
+		else if (strcmp(argv[i], "--step-ms") == 0 && i + 1 < argc) {
+			if (!parse_float(argv[++i], options.step_ms) || options.step_ms <= 0.f)
+				return invalid_value("--step-ms", argv[i]);
+		}
+		else if (strcmp(argv[i], "--script") == 0 && i + 1 < argc)
+			options.script_path = argv[++i];
+		else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+			options.record_path = argv[++i];
+		else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+			options.replay_path = argv[++i];
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			unsigned seed;
+			if (!parse_unsigned(argv[++i], seed))
+				return invalid_value("--seed", argv[i]);
+			options.seed = seed;
+		}
+		else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc)
+			options.capture_dir = argv[++i];
+		else if (strcmp(argv[i], "--capture-every") == 0 && i + 1 < argc) {
+			if (!parse_unsigned(argv[++i], options.capture_every) || options.capture_every == 0)
+				return invalid_value("--capture-every", argv[i]);
+		}
+		else {
+			fprintf(stderr, "Unknown argument %s\n", argv[i]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (!options.capture_dir.empty() && !headless) {
+		fprintf(stderr, "--capture needs --headless\n");
+		return EXIT_FAILURE;
+	}
+	if (headless)
+		return run_headless(options);
+
 	// Global systems
 	StateSystem state;
 	WorldSystem world;
 	RenderSystem renderer;
 	PhysicsSystem physics;
+	AISystem ai;
+	MixerAudioBackend audio;
+
+	// A replay brings its own input, the window only listens for escape
+	InputReplay replay;
+	bool replaying = !options.replay_path.empty();
+	if (replaying) {
+		if (!replay.open(options.replay_path))
+			return EXIT_FAILURE;
+		world.set_seed(replay.get_seed());
+		world.set_live_input(false);
+	}
+	InputRecorder recorder;
+	if (!options.record_path.empty()) {
+		if (!recorder.start(options.record_path, world.get_seed()))
+			return EXIT_FAILURE;
+		world.set_recorder(&recorder);
+	}
+
+	// Read the assets in the background while the window and context are created
+	auto load_start = Clock::now();
+	AssetLoader loader;
+	renderer.load_assets(loader);
+	audio.load(loader);
+	loader.start();
 
 	// Initializing window
 	GLFWwindow* window = world.create_window();
-	if (!window) {
+	bool assets_loaded = loader.wait([](size_t done, size_t total) {
+		printf("\rLoading assets %zu/%zu", done, total);
+		if (done == total)
+			printf("\n");
+	});
+	if (!window || !assets_loaded || !audio.init()) {
 		// Time to read the error message
 		printf("Press any key to exit");
 		getchar();
@@ -33,12 +157,18 @@ int main()
 
 	// initialize the main systems
 	renderer.init(window);
-	world.init(&renderer);
+	printf("Startup took %.1f ms\n",
+		(float)(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - load_start)).count() / 1000);
+	world.init(&renderer.get_assets(), &physics, &audio, &renderer);
+	ai.init(&physics);
 	state.init();
+	renderer.start();
 
 	// variable timestep loop
+	PROFILE_THREAD_NAME("simulation");
 	auto t = Clock::now();
 	while (!world.is_over()) {
+		PROFILE_SCOPE("frame");
 		// Processes system messages, if this wasn't present the window would become unresponsive
 		glfwPollEvents();
 
@@ -47,13 +177,23 @@ int main()
 		float elapsed_ms =
 			(float)(std::chrono::duration_cast<std::chrono::microseconds>(now - t)).count() / 1000;
 		t = now;
+		// and its own step times, so it plays out like the recorded game
+		if (replaying && !replay.next_step(world, elapsed_ms))
+			break;
 
 		world.step(elapsed_ms);
+		ai.step(elapsed_ms);
 		physics.step(elapsed_ms);
 		world.handle_collisions();
 
-		renderer.draw();
+		// The render thread draws this frame while we go on with the next step.
+		// Don't run more than a frame ahead of it, vsync sets the pace.
+		renderer.submit_frame(elapsed_ms);
+		PROFILE_SCOPE("wait for render thread");
+		while (renderer.is_frame_pending() && !world.is_over())
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
 	}
+	renderer.stop();
 
 	return EXIT_SUCCESS;
 }
@@ -0,0 +1,88 @@
+// internal
+#include "mixer_audio_backend.hpp"
+
+namespace {
+	const char* music_name = "background_chiptune.wav";
+	// Make sure these names remain in sync with the associated enumerators.
+	const std::array<const char*, sound_count> sound_names = {
+		"car_crash.mp3",
+		"honk.wav" };
+}
+
+MixerAudioBackend::~MixerAudioBackend()
+{
+	// destroy music components
+	if (music != nullptr)
+		Mix_FreeMusic(music);
+	for (Mix_Chunk* sound : sounds)
+		if (sound != nullptr)
+			Mix_FreeChunk(sound);
+	if (device_open)
+		Mix_CloseAudio();
+}
+
+void MixerAudioBackend::load(AssetLoader& loader)
+{
+	// Only the file reads happen on the loader, SDL_mixer decodes on this thread
+	loader.add(audio_path(music_name), [this] {
+		return AssetLoader::read_file(audio_path(music_name), music_file);
+	});
+	for (uint i = 0; i < sound_count; i++)
+		loader.add(audio_path(sound_names[i]), [this, i] {
+			return AssetLoader::read_file(audio_path(sound_names[i]), sound_files[i]);
+		});
+}
+
+bool MixerAudioBackend::init()
+{
+	if (SDL_Init(SDL_INIT_AUDIO) < 0) {
+		fprintf(stderr, "Failed to initialize SDL Audio");
+		return false;
+	}
+	if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) == -1) {
+		fprintf(stderr, "Failed to open audio device");
+		return false;
+	}
+	device_open = true;
+
+	// freesrc = 1, the RWops are closed along with the music and chunks
+	music = Mix_LoadMUS_RW(SDL_RWFromConstMem(music_file.data(), (int)music_file.size()), 1);
+	bool all_loaded = music != nullptr;
+	for (uint i = 0; i < sound_count; i++)
+	{
+		sounds[i] = Mix_LoadWAV_RW(SDL_RWFromConstMem(sound_files[i].data(), (int)sound_files[i].size()), 1);
+		// chunks are fully decoded, only the music still reads its file
+		sound_files[i] = std::vector<unsigned char>();
+		all_loaded &= sounds[i] != nullptr;
+	}
+
+	if (!all_loaded) {
+		fprintf(stderr, "Failed to load sounds\n %s\n %s\n %s\n make sure the data directory is present",
+			audio_path(music_name).c_str(),
+			audio_path(sound_names[0]).c_str(),
+			audio_path(sound_names[1]).c_str());
+		return false;
+	}
+	return true;
+}
+
+void MixerAudioBackend::play_music()
+{
+	// Playing background music indefinitely
+	Mix_PlayMusic(music, -1);
+}
+
+void MixerAudioBackend::pause_music()
+{
+	Mix_PauseMusic();
+}
+
+void MixerAudioBackend::resume_music()
+{
+	Mix_ResumeMusic();
+}
+
+void MixerAudioBackend::play(SOUND_ASSET_ID sound)
+{
+	Mix_PlayChannel(-1, sounds[(int)sound], 0);
+}
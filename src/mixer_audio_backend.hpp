@@ -0,0 +1,40 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#define SDL_MAIN_HANDLED
+#include <SDL.h>
+#include <SDL_mixer.h>
+
+#include "asset_loader.hpp"
+#include "audio_backend.hpp"
+
+// Plays through SDL_mixer on the default audio device
+class MixerAudioBackend : public AudioBackend
+{
+public:
+	~MixerAudioBackend();
+
+	// Queues reading the audio files on the loader, they are decoded by
+	// init() once it is done
+	void load(AssetLoader& loader);
+
+	// Opens the audio device and decodes the music and sounds
+	bool init();
+
+	void play_music() override;
+	void pause_music() override;
+	void resume_music() override;
+	void play(SOUND_ASSET_ID sound) override;
+
+private:
+	bool device_open = false;
+	Mix_Music* music = nullptr;
+	std::array<Mix_Chunk*, sound_count> sounds = {};
+
+	// Contents of the audio files, read by the asset loader. SDL_mixer streams
+	// music from memory while it plays, so that one is kept.
+	std::vector<unsigned char> music_file;
+	std::array<std::vector<unsigned char>, sound_count> sound_files;
+};
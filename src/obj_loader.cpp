@@ -0,0 +1,330 @@
+// internal
+#include "obj_loader.hpp"
+#include "asset_loader.hpp"
+
+// stlib
+#include <algorithm>
+#include <cstring>
+
+namespace {
+	static_assert(sizeof(ColoredVertex) == 6 * sizeof(float), "vertices are hashed and compared as 6 floats");
+	const uint32_t empty_slot = UINT32_MAX;
+
+	// Open addressing set of the vertices seen so far, keyed on position and
+	// color bit for bit. Slots hold indices into the vertex array, so there is
+	// no per entry allocation like in a std::unordered_map.
+	class VertexSet
+	{
+	public:
+		VertexSet(const std::vector<ColoredVertex>& vertices, size_t expected)
+			: vertices(vertices)
+		{
+			size_t capacity = 1024;
+			while (capacity < expected * 2)
+				capacity *= 2;
+			slots.assign(capacity, empty_slot);
+		}
+
+		// Index of an equal vertex already in the array, or of the one just added
+		uint32_t insert(std::vector<ColoredVertex>& out_vertices, const ColoredVertex& vertex) {
+			if ((out_vertices.size() + 1) * 2 > slots.size())
+				grow();
+			const size_t mask = slots.size() - 1;
+			for (size_t slot = hash(vertex) & mask;; slot = (slot + 1) & mask) {
+				if (slots[slot] == empty_slot) {
+					slots[slot] = (uint32_t)out_vertices.size();
+					out_vertices.push_back(vertex);
+					return slots[slot];
+				}
+				if (memcmp(&vertices[slots[slot]], &vertex, sizeof(vertex)) == 0)
+					return slots[slot];
+			}
+		}
+
+	private:
+		static size_t hash(const ColoredVertex& vertex) {
+			// FNV-1a over the 32 bit words
+			uint32_t words[6];
+			memcpy(words, &vertex, sizeof(words));
+			uint64_t hash = 0xcbf29ce484222325ull;
+			for (uint32_t word : words) {
+				hash ^= word;
+				hash *= 0x100000001b3ull;
+			}
+			return (size_t)(hash ^ (hash >> 32));
+		}
+
+		void grow() {
+			std::vector<uint32_t> old;
+			old.swap(slots);
+			slots.assign(old.size() * 2, empty_slot);
+			const size_t mask = slots.size() - 1;
+			for (uint32_t index : old) {
+				if (index == empty_slot)
+					continue;
+				size_t slot = hash(vertices[index]) & mask;
+				while (slots[slot] != empty_slot)
+					slot = (slot + 1) & mask;
+				slots[slot] = index;
+			}
+		}
+
+		const std::vector<ColoredVertex>& vertices;
+		std::vector<uint32_t> slots;
+	};
+
+	// Exact powers of ten, so one multiply or divide rounds correctly for
+	// anything with up to 15 significant digits, which is all an exporter writes
+	const double powers_of_ten[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+	class Scanner
+	{
+	public:
+		Scanner(const char* begin, const char* end) : p(begin), end(end) {}
+
+		bool at_end() const { return p == end; }
+		int line() const { return line_number; }
+
+		void skip_blanks() {
+			while (p != end && (*p == ' ' || *p == '\t' || *p == '\r'))
+				p++;
+		}
+
+		bool at_line_end() {
+			skip_blanks();
+			return p == end || *p == '\n' || *p == '#';
+		}
+
+		void next_line() {
+			while (p != end && *p != '\n')
+				p++;
+			if (p != end)
+				p++;
+			line_number++;
+		}
+
+		// The keyword at the start of a line, "v", "f", ... Empty for a blank line.
+		void keyword(char* out, size_t capacity) {
+			skip_blanks();
+			size_t n = 0;
+			while (p != end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') {
+				if (n + 1 < capacity)
+					out[n++] = *p;
+				p++;
+			}
+			out[n] = '\0';
+		}
+
+		bool read_float(float& out) {
+			skip_blanks();
+			const char* start = p;
+			bool negative = false;
+			if (p != end && (*p == '-' || *p == '+'))
+				negative = *p++ == '-';
+
+			// Up to 19 significant digits fit the mantissa, the rest only count for
+			// the magnitude
+			uint64_t mantissa = 0;
+			int digits = 0, exponent = 0;
+			const char* first_digit = p;
+			for (; p != end && *p >= '0' && *p <= '9'; p++) {
+				if (digits < 19) {
+					mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+					digits += mantissa != 0;
+				}
+				else {
+					exponent++;
+				}
+			}
+			bool any_digit = p != first_digit;
+			if (p != end && *p == '.') {
+				p++;
+				const char* first_fraction_digit = p;
+				for (; p != end && *p >= '0' && *p <= '9'; p++) {
+					if (digits < 19) {
+						mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+						digits += mantissa != 0;
+						exponent--;
+					}
+				}
+				any_digit = any_digit || p != first_fraction_digit;
+			}
+			if (!any_digit) {
+				p = start;
+				return false;
+			}
+			if (p != end && (*p == 'e' || *p == 'E')) {
+				const char* exponent_start = p++;
+				bool negative_exponent = false;
+				if (p != end && (*p == '-' || *p == '+'))
+					negative_exponent = *p++ == '-';
+				if (p == end || *p < '0' || *p > '9') {
+					p = exponent_start; // not an exponent after all
+				}
+				else {
+					int value = 0;
+					for (; p != end && *p >= '0' && *p <= '9'; p++)
+						value = std::min(value * 10 + (*p - '0'), 10000);
+					exponent += negative_exponent ? -value : value;
+				}
+			}
+
+			double value = (double)mantissa;
+			if (exponent < 0) {
+				for (; exponent < -22; exponent += 22)
+					value /= 1e22;
+				value /= powers_of_ten[-exponent];
+			}
+			else {
+				for (; exponent > 22; exponent -= 22)
+					value *= 1e22;
+				value *= powers_of_ten[exponent];
+			}
+			out = (float)(negative ? -value : value);
+			return true;
+		}
+
+		bool read_int(long long& out) {
+			const char* start = p;
+			bool negative = false;
+			if (p != end && (*p == '-' || *p == '+'))
+				negative = *p++ == '-';
+			if (p == end || *p < '0' || *p > '9') {
+				p = start;
+				return false;
+			}
+			const char* digits = p;
+			long long value = 0;
+			for (; p != end && *p >= '0' && *p <= '9'; p++)
+				value = value * 10 + (*p - '0');
+			// Far past any real vertex count, but must not overflow
+			if (p - digits > 12)
+				value = (long long)1 << 40;
+			out = negative ? -value : value;
+			return true;
+		}
+
+		// One v, v/vt, v//vn or v/vt/vn corner of a face, only v is kept
+		bool read_corner(long long& out_vertex) {
+			skip_blanks();
+			if (!read_int(out_vertex))
+				return false;
+			long long ignored;
+			if (p != end && *p == '/') {
+				p++;
+				read_int(ignored); // texcoord, may be missing as in v//vn
+				if (p != end && *p == '/') {
+					p++;
+					if (!read_int(ignored))
+						return false;
+				}
+			}
+			return true;
+		}
+
+	private:
+		const char* p;
+		const char* end;
+		int line_number = 1;
+	};
+}
+
+bool parse_obj(const char* text, size_t length, ObjMesh& out_mesh, std::string& out_error)
+{
+	out_mesh.vertices.clear();
+	out_mesh.indices.clear();
+	// A typical line is 30 to 40 bytes
+	out_mesh.vertices.reserve(length / 64);
+	out_mesh.indices.reserve(length / 16);
+
+	// Index of every v line in out_mesh.vertices, after merging duplicates
+	std::vector<uint32_t> remap;
+	remap.reserve(length / 64);
+	VertexSet unique_vertices(out_mesh.vertices, length / 64);
+	std::vector<long long> polygon;
+
+	Scanner scanner(text, text + length);
+	auto fail = [&](const char* message) {
+		out_error = "line " + std::to_string(scanner.line()) + ": " + message;
+		return false;
+	};
+
+	char keyword[8];
+	while (!scanner.at_end())
+	{
+		scanner.keyword(keyword, sizeof(keyword));
+		if (strcmp(keyword, "v") == 0)
+		{
+			float values[6];
+			int count = 0;
+			while (count < 6 && scanner.read_float(values[count]))
+				count++;
+			if (count < 3)
+				return fail("vertex with fewer than 3 coordinates");
+			// A vertex without color (or with a w) is white
+			if (count < 6)
+				values[3] = values[4] = values[5] = 1.f;
+
+			ColoredVertex vertex;
+			vertex.position = { values[0], values[1], values[2] };
+			vertex.color = { values[3], values[4], values[5] };
+			remap.push_back(unique_vertices.insert(out_mesh.vertices, vertex));
+		}
+		else if (strcmp(keyword, "f") == 0)
+		{
+			polygon.clear();
+			long long corner;
+			while (!scanner.at_line_end())
+			{
+				if (!scanner.read_corner(corner))
+					return fail("face corner is not a vertex index");
+				// 1 based, or counting back from the last vertex if negative
+				const long long index = corner > 0 ? corner - 1 : (long long)remap.size() + corner;
+				if (corner == 0 || index < 0)
+					return fail("face refers to a vertex that does not exist");
+				polygon.push_back(index);
+			}
+			if (polygon.size() < 3)
+				return fail("face with fewer than 3 corners");
+			// Vertices may follow the faces using them, so the range check waits
+			// until the end, the raw index goes in for now
+			for (size_t i = 1; i + 1 < polygon.size(); i++)
+			{
+				out_mesh.indices.push_back((uint32_t)std::min(polygon[0], (long long)UINT32_MAX));
+				out_mesh.indices.push_back((uint32_t)std::min(polygon[i], (long long)UINT32_MAX));
+				out_mesh.indices.push_back((uint32_t)std::min(polygon[i + 1], (long long)UINT32_MAX));
+			}
+		}
+		scanner.next_line();
+	}
+
+	for (uint32_t& index : out_mesh.indices)
+	{
+		if (index >= remap.size())
+		{
+			out_error = "face refers to a vertex that does not exist";
+			return false;
+		}
+		index = remap[index];
+	}
+	return true;
+}
+
+bool load_obj_file(const std::string& path, ObjMesh& out_mesh)
+{
+	std::vector<unsigned char> bytes;
+	if (!AssetLoader::read_file(path, bytes))
+	{
+		fprintf(stderr, "Could not open the mesh %s\n", path.c_str());
+		return false;
+	}
+	std::string error;
+	if (!parse_obj((const char*)bytes.data(), bytes.size(), out_mesh, error))
+	{
+		fprintf(stderr, "Could not parse the mesh %s, %s\n", path.c_str(), error.c_str());
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+#include "components.hpp"
+
+// What parse_obj() found in a file, before any normalization
+struct ObjMesh
+{
+	std::vector<ColoredVertex> vertices;
+	std::vector<uint32_t> indices; // three per triangle
+};
+
+// Single pass OBJ parser for the coloured meshes. Reads "v x y z [r g b]" and "f"
+// lines with any of the v, v/vt, v//vn and v/vt/vn forms, negative indices
+// included, and fans polygons into triangles. Everything else is skipped.
+// Vertices with the same position and color are merged into one.
+bool parse_obj(const char* text, size_t length, ObjMesh& out_mesh, std::string& out_error);
+
+// Reads the whole file in one go and parses it
+bool load_obj_file(const std::string& path, ObjMesh& out_mesh);
@@ -3,10 +3,12 @@
 
 #include <iostream>
 
+#include "convex_hull.hpp"
+#include "debug_draw.hpp"
+#include "profiler.hpp"
 #include "state_system.h"
 #include "world_init.hpp"
 #include "world_system.hpp"
-#include "../../../../../../../../../Library/Developer/CommandLineTools/SDKs/MacOSX15.0.sdk/System/Library/Frameworks/CoreServices.framework/Frameworks/CarbonCore.framework/Headers/FixMath.h"
 
 // Returns the local bounding coordinates (bottom left and top right)
 // scaled by the current size of the entity
@@ -37,7 +39,7 @@ std::array<vec2, 4> get_bounding_points(const Motion& motion) {
 // projected onto an axis as a vec2
 vec2 get_projected_min_max(const std::array<vec2, 4>& bounding_points,
 						   const vec2 axis) {
-	vec2 min_max = {positiveInfinity, negativeInfinity};
+	vec2 min_max = {INFINITY, -INFINITY};
 	for (const vec2& point : bounding_points) {
 		float projected = dot(point, axis);
 		min_max = {min(projected, min_max.x), max(projected, min_max.y)};
@@ -59,9 +61,67 @@ bool no_overlap(std::array<vec2, 4> m1_bounding_points,
 	return m1_min_max.x > m2_min_max.y || m1_min_max.y < m2_min_max.x;
 }
 
+// Hull vertices and edge normals moved into world space for one test
+struct WorldHull {
+	std::array<vec2, MAX_HULL_VERTICES> vertices;
+	std::array<vec2, MAX_HULL_VERTICES> normals;
+	int size = 0;
+};
+
+// Places the (precomputed) hull of an entity at its current position, rotation and scale.
+// Normals are scaled by the swapped scale, which is the inverse transpose times the
+// determinant: they stay perpendicular under non-uniform scaling without dividing by
+// the scale, so a zero scale gives a zero axis instead of inf/NaN. They are not
+// renormalized and may flip, SAT only needs the axis.
+void transform_hull(const ConvexHull& hull, const Motion& motion, WorldHull& out) {
+	float c = ::cos(motion.angle);
+	float s = ::sin(motion.angle);
+	out.size = (int)hull.vertices.size();
+	for (int i = 0; i < out.size; i++) {
+		vec2 v = hull.vertices[i] * motion.scale;
+		out.vertices[i] = motion.position + vec2(c * v.x - s * v.y, s * v.x + c * v.y);
+		vec2 n = hull.normals[i] * vec2(motion.scale.y, motion.scale.x);
+		out.normals[i] = vec2(c * n.x - s * n.y, s * n.x + c * n.y);
+	}
+}
+
+// Returns true if some edge normal of hull a separates the two hulls
+bool has_separating_axis(const WorldHull& a, const WorldHull& b) {
+	for (int i = 0; i < a.size; i++) {
+		const vec2& axis = a.normals[i];
+		float a_min = INFINITY, a_max = -INFINITY;
+		float b_min = INFINITY, b_max = -INFINITY;
+		for (int j = 0; j < a.size; j++) {
+			float p = dot(a.vertices[j], axis);
+			a_min = min(a_min, p);
+			a_max = max(a_max, p);
+		}
+		for (int j = 0; j < b.size; j++) {
+			float p = dot(b.vertices[j], axis);
+			b_min = min(b_min, p);
+			b_max = max(b_max, p);
+		}
+		if (a_min > b_max || a_max < b_min)
+			return true;
+	}
+	return false;
+}
+
+// Polygon SAT between the convex hulls of two entities
+bool hulls_overlap(const Motion& motion1, const ConvexHull& hull1,
+				   const Motion& motion2, const ConvexHull& hull2) {
+	WorldHull world1, world2;
+	transform_hull(hull1, motion1, world1);
+	transform_hull(hull2, motion2, world2);
+	return !has_separating_axis(world1, world2) && !has_separating_axis(world2, world1);
+}
+
 // Returns true if motion1 and motion2 are overlapping using a coarse
-// step with radial boundaries and a fine step with the separating axis theorem
-bool collides(const Motion& motion1, const Motion& motion2) {
+// step with radial boundaries and a fine step with the separating axis theorem.
+// If either entity has a Collider, the oriented boxes only serve as an early out
+// and the final answer comes from the convex hulls.
+bool collides(const Motion& motion1, const Collider* collider1,
+			  const Motion& motion2, const Collider* collider2) {
 	// see if the distance between centre points of motion1 and motion2
 	// are within the maximum possible distance for them to be touching
 	vec2 dp = motion1.position - motion2.position;
@@ -93,6 +153,12 @@ bool collides(const Motion& motion1, const Motion& motion2) {
 				return false;
 			}
 		}
+		if (collider1 != nullptr || collider2 != nullptr) {
+			static const ConvexHull square = unit_square_hull();
+			const ConvexHull& hull1 = collider1 != nullptr ? *collider1->hull : square;
+			const ConvexHull& hull2 = collider2 != nullptr ? *collider2->hull : square;
+			return hulls_overlap(motion1, hull1, motion2, hull2);
+		}
 		// std::cout << "Collision detected between motion with position (";
 		// std::cout << motion1.position.x << ", " << motion1.position.y << ") ";
 		// std::cout << "and motion with position ";
@@ -141,45 +207,107 @@ void PhysicsSystem::car_drift(float elapsed_ms) {
 
 void PhysicsSystem::step(float elapsed_ms)
 {
+	PROFILE_SCOPE("PhysicsSystem::step");
+	debug::clear();
 	// std::cout << "Current salmon angle:" << player_motion.angle << std::endl;
 	// Move car based on how much time has passed, this is to (partially) avoid
 	// having entities move at different speed based on the machine.
-	auto& motion_registry = registry.motions;
-	unsigned int points = StateSystem::get_points();
-	float point_multiplier = pow(SPEED_FACTOR, points);
-	for(uint i = 0; i< motion_registry.size(); i++)
 	{
-		Motion& motion = motion_registry.components[i];
-		// Entity entity = motion_registry.entities[i];
-		float step_seconds = elapsed_ms / 1000.f;
-		motion.position += step_seconds * motion.velocity * vec2(point_multiplier, point_multiplier);
-		// (void)elapsed_ms; // placeholder to silence unused warning until implemented
+		PROFILE_SCOPE_TIMED("integration", stats.integration_ms);
+		auto& motion_registry = registry.motions;
+		unsigned int points = StateSystem::get_points();
+		float point_multiplier = pow(SPEED_FACTOR, points);
+		for(uint i = 0; i< motion_registry.size(); i++)
+		{
+			Motion& motion = motion_registry.components[i];
+			// Entity entity = motion_registry.entities[i];
+			float step_seconds = elapsed_ms / 1000.f;
+			motion.position += step_seconds * motion.velocity * vec2(point_multiplier, point_multiplier);
+			// (void)elapsed_ms; // placeholder to silence unused warning until implemented
+		}
+
+		// Handle drift if in advanced mode
+		if (StateSystem::is_advanced() && !registry.deathTimers.has(registry.players.entities[0])) {
+			car_drift(elapsed_ms);
+		}
 	}
 
-	// Handle drift if in advanced mode
-	if (StateSystem::is_advanced() && !registry.deathTimers.has(registry.players.entities[0])) {
-		car_drift(elapsed_ms);
+	// Re-bin all moving entities, this also serves the spatial queries until the next step,
+	// and collect the pairs that share a grid cell and whose bounding boxes overlap
+	{
+		PROFILE_SCOPE_TIMED("broadphase", stats.broadphase_ms);
+		spatial_index.rebuild();
+		candidate_pairs.clear();
+		spatial_index.for_each_candidate_pair([this](const SpatialIndex::Body& body_i, const SpatialIndex::Body& body_j) {
+			candidate_pairs.emplace_back(&body_i, &body_j);
+		});
 	}
 
-	// Check for collisions between all moving entities
-    ComponentContainer<Motion> &motion_container = registry.motions;
-	for(uint i = 0; i<motion_container.components.size(); i++)
+	// Exact test of each candidate pair
+	uint colliding_pairs = 0;
 	{
-		Motion& motion_i = motion_container.components[i];
-		Entity entity_i = motion_container.entities[i];
-		
-		// note starting j at i+1 to compare all (i,j) pairs only once (and to not compare with itself)
-		for(uint j = i+1; j<motion_container.components.size(); j++)
+		PROFILE_SCOPE_TIMED("narrowphase", stats.narrowphase_ms);
+		for (const auto& pair : candidate_pairs)
 		{
-			Motion& motion_j = motion_container.components[j];
-			if (collides(motion_i, motion_j))
+			const SpatialIndex::Body& body_i = *pair.first;
+			const SpatialIndex::Body& body_j = *pair.second;
+			const Collider* collider_i = body_i.collider.hull != nullptr ? &body_i.collider : nullptr;
+			const Collider* collider_j = body_j.collider.hull != nullptr ? &body_j.collider : nullptr;
+			if (collides(body_i.motion, collider_i, body_j.motion, collider_j))
 			{
-				Entity entity_j = motion_container.entities[j];
+				Entity entity_i = body_i.entity;
+				Entity entity_j = body_j.entity;
 				// Create a collisions event
 				// We are abusing the ECS system a bit in that we potentially insert muliple collisions for the same entity
 				registry.collisions.emplace_with_duplicates(entity_i, entity_j);
 				registry.collisions.emplace_with_duplicates(entity_j, entity_i);
+				colliding_pairs++;
 			}
 		}
 	}
+
+	stats.bodies = (uint)spatial_index.get_bodies().size();
+	stats.candidate_pairs = (uint)candidate_pairs.size();
+	stats.colliding_pairs = colliding_pairs;
+
+	if (debug::enabled && debugging.in_debug_mode)
+		draw_debug();
+}
+
+void PhysicsSystem::draw_debug()
+{
+	const vec3 cell_color = { 0.3f, 0.3f, 0.3f };
+	const vec3 crowded_cell_color = { 0.9f, 0.6f, 0.1f };
+	const vec3 box_color = { 0.2f, 0.4f, 1.f };
+	const vec3 hull_color = { 0.1f, 0.9f, 0.2f };
+	const vec3 pair_color = { 0.9f, 0.1f, 0.1f };
+
+	// Only the cells something was binned into, cells holding more than one body
+	// are the ones the broadphase has to look at
+	const ivec2 dims = spatial_index.get_dimensions();
+	const float cell_size = spatial_index.get_cell_size();
+	for (int y = 0; y < dims.y; y++)
+		for (int x = 0; x < dims.x; x++)
+		{
+			uint32_t count = spatial_index.get_cell_count(x, y);
+			if (count == 0)
+				continue;
+			vec2 center = spatial_index.get_origin() + vec2(x + 0.5f, y + 0.5f) * cell_size;
+			debug::obb(center, vec2(cell_size), 0.f, count > 1 ? crowded_cell_color : cell_color);
+		}
+
+	// The oriented box of every body, and its hull if the narrowphase uses one
+	WorldHull world;
+	for (const SpatialIndex::Body& body : spatial_index.get_bodies())
+	{
+		debug::obb(body.motion.position, body.motion.scale, body.motion.angle, box_color);
+		if (body.collider.hull == nullptr)
+			continue;
+		transform_hull(*body.collider.hull, body.motion, world);
+		for (int i = 0; i < world.size; i++)
+			debug::line(world.vertices[i], world.vertices[(i + 1) % world.size], hull_color);
+	}
+
+	for (const auto& pair : candidate_pairs)
+		debug::line(pair.first->motion.position, pair.second->motion.position, pair_color);
 }
@@ -4,6 +4,22 @@
 #include "tiny_ecs.hpp"
 #include "components.hpp"
 #include "tiny_ecs_registry.hpp"
+#include "spatial_index.hpp"
+
+// Narrowphase test between two entities, collider can be nullptr to use the oriented box
+bool collides(const Motion& motion1, const Collider* collider1,
+			  const Motion& motion2, const Collider* collider2);
+
+// Work done by the last step
+struct PhysicsStats
+{
+	uint bodies = 0;
+	uint candidate_pairs = 0; // sharing a grid cell with overlapping bounding boxes
+	uint colliding_pairs = 0; // confirmed by the narrowphase
+	float integration_ms = 0.f;
+	float broadphase_ms = 0.f;
+	float narrowphase_ms = 0.f;
+};
 
 // A simple physics system that moves rigid bodies and checks for collision
 class PhysicsSystem
@@ -13,7 +29,22 @@ public:
 
 	void step(float elapsed_ms);
 
+	const PhysicsStats& get_stats() const { return stats; }
+
+	// Raycasts, overlap and nearest neighbour queries for gameplay and AI.
+	// The index is rebuilt during step(), so it reflects the last physics step.
+	SpatialIndex& get_spatial_index() { return spatial_index; }
+
 	PhysicsSystem()
 	{
 	}
+
+private:
+	// Outlines of the colliders, occupied grid cells and candidate pairs, for debug mode
+	void draw_debug();
+
+	SpatialIndex spatial_index;
+	PhysicsStats stats;
+	// Broadphase output, pointers into the spatial index and only valid during step()
+	std::vector<std::pair<const SpatialIndex::Body*, const SpatialIndex::Body*>> candidate_pairs;
 };
\ No newline at end of file
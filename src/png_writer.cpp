@@ -0,0 +1,97 @@
+// internal
+#include "png_writer.hpp"
+
+// stlib
+#include <array>
+#include <fstream>
+#include <vector>
+
+namespace {
+	uint32_t crc32(const unsigned char* data, size_t length, uint32_t crc = 0) {
+		static const std::array<uint32_t, 256> table = [] {
+			std::array<uint32_t, 256> t;
+			for (uint32_t n = 0; n < 256; n++) {
+				uint32_t c = n;
+				for (int k = 0; k < 8; k++)
+					c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+				t[n] = c;
+			}
+			return t;
+		}();
+		crc = ~crc;
+		for (size_t i = 0; i < length; i++)
+			crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+		return ~crc;
+	}
+
+	void put_u32(std::vector<unsigned char>& out, uint32_t value) {
+		out.push_back((unsigned char)(value >> 24));
+		out.push_back((unsigned char)(value >> 16));
+		out.push_back((unsigned char)(value >> 8));
+		out.push_back((unsigned char)value);
+	}
+
+	void put_chunk(std::vector<unsigned char>& out, const char* type, const std::vector<unsigned char>& data) {
+		put_u32(out, (uint32_t)data.size());
+		size_t start = out.size();
+		out.insert(out.end(), type, type + 4);
+		out.insert(out.end(), data.begin(), data.end());
+		put_u32(out, crc32(out.data() + start, out.size() - start));
+	}
+}
+
+bool write_png(const std::string& path, const unsigned char* rgba, ivec2 size) {
+	if (size.x <= 0 || size.y <= 0)
+		return false;
+
+	// Every row starts with its filter type, 0 = none
+	const size_t row_bytes = (size_t)size.x * 4;
+	std::vector<unsigned char> raw;
+	raw.reserve((row_bytes + 1) * size.y);
+	for (int y = 0; y < size.y; y++) {
+		raw.push_back(0);
+		raw.insert(raw.end(), rgba + y * row_bytes, rgba + (y + 1) * row_bytes);
+	}
+
+	// zlib stream made of stored deflate blocks of at most 65535 bytes
+	std::vector<unsigned char> idat = { 0x78, 0x01 };
+	uint32_t a = 1, b = 0;
+	for (size_t offset = 0; offset < raw.size();) {
+		size_t length = std::min(raw.size() - offset, (size_t)65535);
+		bool last = offset + length == raw.size();
+		idat.push_back(last ? 1 : 0);
+		idat.push_back((unsigned char)length);
+		idat.push_back((unsigned char)(length >> 8));
+		idat.push_back((unsigned char)~length);
+		idat.push_back((unsigned char)(~length >> 8));
+		idat.insert(idat.end(), raw.begin() + offset, raw.begin() + offset + length);
+		for (size_t i = offset; i < offset + length; i++) {
+			a = (a + raw[i]) % 65521;
+			b = (b + a) % 65521;
+		}
+		offset += length;
+	}
+	put_u32(idat, (b << 16) | a); // adler32
+
+	std::vector<unsigned char> ihdr;
+	put_u32(ihdr, (uint32_t)size.x);
+	put_u32(ihdr, (uint32_t)size.y);
+	ihdr.push_back(8); // bits per channel
+	ihdr.push_back(6); // RGBA
+	ihdr.push_back(0); // deflate
+	ihdr.push_back(0); // adaptive filtering
+	ihdr.push_back(0); // no interlacing
+
+	std::vector<unsigned char> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	put_chunk(png, "IHDR", ihdr);
+	put_chunk(png, "IDAT", idat);
+	put_chunk(png, "IEND", {});
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file.good()) {
+		fprintf(stderr, "Could not open %s for writing\n", path.c_str());
+		return false;
+	}
+	file.write((const char*)png.data(), png.size());
+	return file.good();
+}
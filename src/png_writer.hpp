@@ -0,0 +1,10 @@
+#pragma once
+
+#include <string>
+
+#include "common.hpp"
+
+// Writes 8 bit RGBA pixels, top row first, to a PNG file. The image data is
+// stored without compression, which keeps this small and fast and is good
+// enough for captures that are compared or looked at once.
+bool write_png(const std::string& path, const unsigned char* rgba, ivec2 size);
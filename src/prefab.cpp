@@ -0,0 +1,43 @@
+// internal
+#include "prefab.hpp"
+#include "tiny_ecs_registry.hpp"
+
+Entity instantiate(const Prefab& prefab, vec2 position, float angle)
+{
+	Entity entity = registry.create_entity();
+	Motion& motion = registry.motions.insert(entity, prefab.motion);
+	motion.position = position;
+	motion.angle = angle;
+	if (prefab.mesh != nullptr)
+		registry.meshPtrs.insert(entity, prefab.mesh);
+	if (prefab.hull != nullptr)
+		registry.colliders.insert(entity, { prefab.hull });
+	if (prefab.deadly)
+		registry.deadlys.emplace(entity);
+	if (prefab.eatable)
+		registry.eatables.emplace(entity);
+	registry.renderRequests.insert(entity, prefab.render_request);
+	return entity;
+}
+
+void instantiate_batch(const Prefab& prefab, const vec2* positions, const float* angles, size_t count,
+	std::vector<Entity>* out)
+{
+	registry.motions.reserve(registry.motions.size() + count);
+	registry.renderRequests.reserve(registry.renderRequests.size() + count);
+	if (prefab.mesh != nullptr)
+		registry.meshPtrs.reserve(registry.meshPtrs.size() + count);
+	if (prefab.hull != nullptr)
+		registry.colliders.reserve(registry.colliders.size() + count);
+	if (prefab.deadly)
+		registry.deadlys.reserve(registry.deadlys.size() + count);
+	if (prefab.eatable)
+		registry.eatables.reserve(registry.eatables.size() + count);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		Entity entity = instantiate(prefab, positions[i], angles[i]);
+		if (out != nullptr)
+			out->push_back(entity);
+	}
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vector>
+
+#include "common.hpp"
+#include "components.hpp"
+#include "tiny_ecs.hpp"
+
+// The component set one kind of spawned entity starts out with, looked up and
+// filled in once (see world_init.hpp) and then copied into the registry for
+// every instance. Instances take their ids from ECSRegistry::create_entity, so
+// recycling them with ECSRegistry::recycle keeps spawning free of allocations.
+struct Prefab
+{
+	Motion motion; // position and angle are set per instance
+	RenderRequest render_request;
+	Mesh* mesh = nullptr;
+	const ConvexHull* hull = nullptr; // no Collider if nullptr
+	bool deadly = false;
+	bool eatable = false;
+};
+
+Entity instantiate(const Prefab& prefab, vec2 position, float angle);
+
+// count instances at once, each container makes room for all of them up front.
+// The entities are appended to out if it is not nullptr.
+void instantiate_batch(const Prefab& prefab, const vec2* positions, const float* angles, size_t count,
+	std::vector<Entity>* out = nullptr);
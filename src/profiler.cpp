@@ -0,0 +1,133 @@
+#ifdef PROFILER
+
+// internal
+#include "profiler.hpp"
+
+// stlib
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+	struct Zone
+	{
+		const char* name;
+		uint64_t start_ns;
+		uint64_t end_ns;
+	};
+
+	// Written only by its own thread. The exporter reads it concurrently and
+	// uses the write count to drop whatever was overwritten while it copied.
+	struct ThreadBuffer
+	{
+		static const size_t capacity = 1 << 16; // power of two
+		Zone zones[capacity];
+		std::atomic<uint64_t> written{ 0 };
+		std::atomic<const char*> name{ nullptr };
+		uint32_t id = 0;
+	};
+
+	// Buffers live until the program ends, so zones of finished threads still
+	// make it into the trace
+	std::mutex buffers_mutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+	ThreadBuffer& thread_buffer() {
+		thread_local ThreadBuffer* buffer = nullptr;
+		if (buffer == nullptr) {
+			std::lock_guard<std::mutex> lock(buffers_mutex);
+			buffers.emplace_back(new ThreadBuffer());
+			buffer = buffers.back().get();
+			buffer->id = (uint32_t)buffers.size();
+		}
+		return *buffer;
+	}
+
+	void write_json_string(std::ofstream& out, const char* s) {
+		out << '"';
+		for (; *s; s++) {
+			if (*s == '"' || *s == '\\')
+				out << '\\';
+			out << *s;
+		}
+		out << '"';
+	}
+}
+
+namespace profiler {
+	uint64_t now_ns() {
+		using Clock = std::chrono::steady_clock;
+		static const Clock::time_point epoch = Clock::now();
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - epoch).count();
+	}
+
+	void record(const char* name, uint64_t start_ns, uint64_t end_ns) {
+		ThreadBuffer& buffer = thread_buffer();
+		uint64_t n = buffer.written.load(std::memory_order_relaxed);
+		buffer.zones[n & (ThreadBuffer::capacity - 1)] = { name, start_ns, end_ns };
+		buffer.written.store(n + 1, std::memory_order_release);
+	}
+
+	void set_thread_name(const char* name) {
+		thread_buffer().name.store(name, std::memory_order_relaxed);
+	}
+
+	bool write_chrome_trace(const std::string& path) {
+		std::ofstream out(path);
+		if (!out.good()) {
+			fprintf(stderr, "Could not open %s for writing\n", path.c_str());
+			return false;
+		}
+
+		std::vector<ThreadBuffer*> threads;
+		{
+			std::lock_guard<std::mutex> lock(buffers_mutex);
+			for (auto& buffer : buffers)
+				threads.push_back(buffer.get());
+		}
+
+		out << "{\"traceEvents\":[\n";
+		bool first = true;
+		std::vector<Zone> zones;
+		for (ThreadBuffer* buffer : threads) {
+			const char* name = buffer->name.load(std::memory_order_relaxed);
+			if (name != nullptr) {
+				out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << buffer->id << ",\"args\":{\"name\":";
+				write_json_string(out, name);
+				out << "}}";
+				first = false;
+			}
+
+			// Copy what the ring holds, then keep only what the owner cannot
+			// have overwritten in the meantime
+			uint64_t end = buffer->written.load(std::memory_order_acquire);
+			uint64_t begin = end > ThreadBuffer::capacity ? end - ThreadBuffer::capacity : 0;
+			zones.clear();
+			for (uint64_t i = begin; i < end; i++)
+				zones.push_back(buffer->zones[i & (ThreadBuffer::capacity - 1)]);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			// the zone being written right now may already be in a slot we copied
+			uint64_t next = buffer->written.load(std::memory_order_relaxed) + 1;
+			uint64_t valid_begin = next > ThreadBuffer::capacity ? next - ThreadBuffer::capacity : 0;
+
+			for (uint64_t i = std::max(begin, valid_begin); i < end; i++) {
+				const Zone& zone = zones[i - begin];
+				out << (first ? "" : ",\n") << "{\"name\":";
+				write_json_string(out, zone.name);
+				out << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << buffer->id
+					<< ",\"ts\":" << zone.start_ns / 1000 << '.' << (zone.start_ns % 1000) / 100
+					<< ",\"dur\":" << (zone.end_ns - zone.start_ns) / 1000 << '.' << ((zone.end_ns - zone.start_ns) % 1000) / 100
+					<< "}";
+				first = false;
+			}
+		}
+		out << "\n]}\n";
+		return out.good();
+	}
+}
+
+#endif
@@ -0,0 +1,92 @@
+#pragma once
+
+// Scoped-zone frame profiler. Zones are recorded into a ring buffer per thread
+// without locks, and can be saved as a Chrome trace at any time; open the file
+// in chrome://tracing or https://ui.perfetto.dev.
+//
+//   void PhysicsSystem::step(float elapsed_ms) {
+//       PROFILE_FUNCTION();
+//       { PROFILE_SCOPE("broadphase"); ... }
+//   }
+//
+// Zone names must be string literals, only the pointer is stored. Without the
+// PROFILER build option (see CMakeLists.txt) every macro compiles to nothing,
+// except that PROFILE_SCOPE_TIMED still times its scope:
+//
+//   { PROFILE_SCOPE_TIMED("narrowphase", stats.narrowphase_ms); ... }
+//
+// is a zone, and writes how long it took into stats.narrowphase_ms on the way out.
+
+#include <chrono>
+
+namespace profiler {
+	inline float milliseconds(std::chrono::steady_clock::duration duration) {
+		return (float)std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count() / 1e6f;
+	}
+
+	// Writes the milliseconds it lived into out_ms
+	class Timer
+	{
+	public:
+		Timer(float& out_ms) : out_ms(out_ms), start(std::chrono::steady_clock::now()) {}
+		~Timer() { out_ms = milliseconds(std::chrono::steady_clock::now() - start); }
+		Timer(const Timer&) = delete;
+		Timer& operator=(const Timer&) = delete;
+
+	private:
+		float& out_ms;
+		std::chrono::steady_clock::time_point start;
+	};
+}
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE_TIMED(name, out_ms) \
+	PROFILE_SCOPE(name); \
+	profiler::Timer PROFILE_CONCAT(profile_timer_, __LINE__)(out_ms)
+
+#ifdef PROFILER
+
+#include <cstdint>
+#include <string>
+
+namespace profiler {
+	// Nanoseconds since the first call
+	uint64_t now_ns();
+
+	// Appends a finished zone to the calling thread's ring buffer. Once the
+	// ring is full the oldest zones are overwritten.
+	void record(const char* name, uint64_t start_ns, uint64_t end_ns);
+
+	// Shown as the track name in the trace, also a string literal
+	void set_thread_name(const char* name);
+
+	// Writes the zones of all threads in Chrome trace_event JSON. Safe to call
+	// from any thread while the others keep recording.
+	bool write_chrome_trace(const std::string& path);
+
+	class Scope
+	{
+	public:
+		Scope(const char* name) : name(name), start_ns(now_ns()) {}
+		~Scope() { record(name, start_ns, now_ns()); }
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		const char* name;
+		uint64_t start_ns;
+	};
+}
+
+#define PROFILE_SCOPE(name) profiler::Scope PROFILE_CONCAT(profile_scope_, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
+#define PROFILE_THREAD_NAME(name) profiler::set_thread_name(name)
+
+#else
+
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_FUNCTION() ((void)0)
+#define PROFILE_THREAD_NAME(name) ((void)0)
+
+#endif
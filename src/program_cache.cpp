@@ -0,0 +1,122 @@
+// internal
+#include "program_cache.hpp"
+
+// stlib
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace {
+	const uint32_t cache_magic = 0x43425053; // "SPBC"
+	const uint32_t cache_version = 1;
+
+	struct CacheHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t key;
+		uint32_t format;
+		uint32_t length;
+	};
+
+	// FNV-1a
+	uint64_t hash_bytes(const std::string& bytes, uint64_t hash = 0xcbf29ce484222325ull) {
+		for (unsigned char c : bytes) {
+			hash ^= c;
+			hash *= 0x100000001b3ull;
+		}
+		return hash;
+	}
+
+	bool has_program_binary() {
+		if (gl3w_is_supported(4, 1))
+			return true;
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+		for (GLint i = 0; i < count; i++) {
+			const char* name = (const char*)glGetStringi(GL_EXTENSIONS, i);
+			if (name != nullptr && strcmp(name, "GL_ARB_get_program_binary") == 0)
+				return true;
+		}
+		return false;
+	}
+
+	std::string gl_string(GLenum name) {
+		const char* value = (const char*)glGetString(name);
+		return value != nullptr ? value : "";
+	}
+}
+
+void ProgramCache::init() {
+	// Core since 4.1, an extension before that
+	supported = false;
+	if (!has_program_binary())
+		return;
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &count);
+	formats.resize(count);
+	if (count > 0)
+		glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, formats.data());
+	gl_has_errors();
+	supported = count > 0;
+	driver = gl_string(GL_VENDOR) + "\n" + gl_string(GL_RENDERER) + "\n" + gl_string(GL_VERSION);
+}
+
+uint64_t ProgramCache::key_of(const std::string& vs_source, const std::string& fs_source, const std::string& layout) const {
+	// The sizes keep "ab" + "c" apart from "a" + "bc"
+	uint64_t hash = hash_bytes(driver);
+	hash = hash_bytes(std::to_string(vs_source.size()) + "\n" + vs_source, hash);
+	hash = hash_bytes(std::to_string(fs_source.size()) + "\n" + fs_source, hash);
+	hash = hash_bytes(std::to_string(layout.size()) + "\n" + layout, hash);
+	return hash;
+}
+
+GLuint ProgramCache::load(const std::string& path, uint64_t key) const {
+	if (!supported)
+		return 0;
+	std::ifstream file(path, std::ios::binary);
+	if (!file.good())
+		return 0;
+
+	CacheHeader header;
+	if (!file.read((char*)&header, sizeof(header)) ||
+		header.magic != cache_magic || header.version != cache_version || header.key != key)
+		return 0;
+	// A format from another driver would only raise GL_INVALID_ENUM
+	if (std::find(formats.begin(), formats.end(), (GLint)header.format) == formats.end())
+		return 0;
+	std::vector<char> binary(header.length);
+	if (!file.read(binary.data(), binary.size()))
+		return 0;
+
+	GLuint program = glCreateProgram();
+	glProgramBinary(program, header.format, binary.data(), (GLsizei)binary.size());
+	GLint is_linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &is_linked);
+	if (is_linked == GL_FALSE) {
+		// Drivers may reject binaries at any time, e.g. after an update that kept the version string
+		glDeleteProgram(program);
+		return 0;
+	}
+	gl_has_errors();
+	return program;
+}
+
+void ProgramCache::save(const std::string& path, uint64_t key, GLuint program) const {
+	if (!supported)
+		return;
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(program, length, &length, &format, binary.data());
+	if (gl_has_errors())
+		return;
+
+	CacheHeader header = { cache_magic, cache_version, key, (uint32_t)format, (uint32_t)length };
+	std::ofstream file(path, std::ios::binary);
+	if (!file.write((const char*)&header, sizeof(header)) || !file.write(binary.data(), length))
+		fprintf(stderr, "Could not write the shader cache %s\n", path.c_str());
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+
+#include "common.hpp"
+
+// Linked shader programs saved with glGetProgramBinary, so later launches can
+// skip compiling and linking. Each entry is keyed by a hash of the shader
+// sources and the GL vendor, renderer and version strings. A driver update,
+// another GPU or an edited shader changes the key, and the entry is compiled
+// again and overwritten.
+class ProgramCache
+{
+public:
+	// Queries driver support, needs a current context
+	void init();
+	bool is_supported() const { return supported; }
+
+	// Key of a program built from these sources on this driver. layout stands
+	// for anything else fixed at link time, like the attribute locations.
+	uint64_t key_of(const std::string& vs_source, const std::string& fs_source, const std::string& layout) const;
+
+	// Program from the cache file, or 0 if there is none, it is stale, or the
+	// driver rejects it
+	GLuint load(const std::string& path, uint64_t key) const;
+	// Call after linking a program created with the retrievable hint set
+	void save(const std::string& path, uint64_t key, GLuint program) const;
+
+private:
+	bool supported = false;
+	std::string driver; // vendor, renderer and version, part of every key
+	std::vector<GLint> formats; // binary formats the driver accepts
+};
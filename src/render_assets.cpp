@@ -0,0 +1,474 @@
+// internal
+#include "render_assets.hpp"
+#include "convex_hull.hpp"
+
+// stlib
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+#include "../ext/stb_image/stb_image.h"
+
+namespace {
+	// Records of the archive, see writeArchive()
+	struct PackedAtlas
+	{
+		ivec2 page_size;
+		uint32_t page_count;
+		uint32_t padding;
+	};
+
+	struct PackedGeometry
+	{
+		vec2 original_size;
+		uint32_t index_size; // 2 or 4 bytes
+		uint32_t padding;
+	};
+
+	struct PackedTexture
+	{
+		ivec2 dimensions;
+		uint32_t page;
+		uint32_t hull_size; // vertices in texture_hull_vertices and _normals
+		vec4 uv_rect;
+	};
+
+	size_t vertex_stride(GEOMETRY_BUFFER_ID id) {
+		if (id == GEOMETRY_BUFFER_ID::SPRITE)
+			return sizeof(TexturedVertex);
+		if (id == GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE)
+			return sizeof(vec3);
+		return sizeof(ColoredVertex);
+	}
+
+	std::string geometry_entry(uint i, const char* part) {
+		return "geometry/" + std::to_string(i) + part;
+	}
+
+	template <class T>
+	void assign_from(std::vector<T>& out, const void* data, size_t bytes) {
+		out.assign((const T*)data, (const T*)data + bytes / sizeof(T));
+	}
+
+	// FNV-1a over the file's length and bytes, a missing file counts as empty
+	void hash_file(const std::string& path, uint64_t& hash) {
+		std::ifstream file(path, std::ios::binary);
+		std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		uint64_t length = contents.size();
+		auto add = [&hash](const void* data, size_t size) {
+			for (size_t i = 0; i < size; i++)
+				hash = (hash ^ ((const uint8_t*)data)[i]) * 1099511628211ull;
+		};
+		add(&length, sizeof(length));
+		add(contents.data(), contents.size());
+	}
+}
+
+bool RenderAssets::load()
+{
+	AssetLoader loader(1);
+	queueLoad(loader);
+	if (!loader.wait())
+		return false;
+	return finishLoad();
+}
+
+void RenderAssets::queueLoad(AssetLoader& loader)
+{
+	assert(!queued);
+	queued = true;
+	// Mapping the archive is instant, nothing left for the loader to do
+	if (use_archive && archive.open(archivePath(), archiveLayout(), sourceHash()))
+		return;
+	queueFiles(loader);
+}
+
+void RenderAssets::queueFiles(AssetLoader& loader)
+{
+	for (uint i = 0; i < texture_count; i++)
+		loader.add(texture_names[i], [this, i] { return loadTexture(i); });
+	for (uint i = 0; i < mesh_names.size(); i++)
+		loader.add(mesh_names[i].second, [this, i] { return loadMesh(i); });
+}
+
+bool RenderAssets::finishLoad()
+{
+	if (archive.is_open())
+	{
+		if (loadFromArchive())
+		{
+			printf("Assets mapped from %s\n", archivePath().c_str());
+			return true;
+		}
+		// Its contents do not add up, the loose files still work
+		fprintf(stderr, "%s does not match the game, loading the loose files\n", archivePath().c_str());
+		archive.close();
+		meshes = {};
+		geometry_data = {};
+		AssetLoader loader(1);
+		queueFiles(loader);
+		if (!loader.wait())
+			return false;
+	}
+
+	for (unsigned char* image : images)
+		if (image == nullptr)
+			return false;
+	packTextures();
+	createMeshes();
+	pointGeometryData();
+	return true;
+}
+
+// Runs on a loader thread
+bool RenderAssets::loadTexture(uint i)
+{
+	const std::string path = texturePath(i);
+	ivec2& dimensions = texture_dimensions[i];
+
+	stbi_uc* data;
+	data = stbi_load(path.c_str(), &dimensions.x, &dimensions.y, NULL, 4);
+
+	if (data == NULL)
+	{
+		const std::string message = "Could not load the file " + path + ".";
+		fprintf(stderr, "%s", message.c_str());
+		assert(false);
+		return false;
+	}
+
+	// Outline the opaque part of the sprite while we still have the pixels
+	texture_hulls[i] = hull_from_alpha(data, dimensions);
+	images[i] = data;
+	return true;
+}
+
+// Runs on a loader thread
+bool RenderAssets::loadMesh(uint i)
+{
+	GEOMETRY_BUFFER_ID geom_index = mesh_names[i].first;
+	return Mesh::loadFromOBJFile(meshPath(i), meshes[(int)geom_index]);
+}
+
+void RenderAssets::packTextures()
+{
+	// The atlas layout needs all the sizes up front
+	std::vector<ivec2> sizes(texture_dimensions.begin(), texture_dimensions.end());
+
+	// Pack the images into as few pages as possible, so that sprites of different
+	// types share a texture and can be drawn together
+	page_size = { atlas_page_size, atlas_page_size };
+	int page_count = 0;
+	std::vector<AtlasRect> rects = pack_atlas(sizes, atlas_padding, page_size, page_count);
+
+	atlas_storage.resize(page_count);
+	atlas_pages.resize(page_count);
+	for (int page = 0; page < page_count; page++)
+	{
+		atlas_storage[page].assign((size_t)page_size.x * page_size.y * 4, 0);
+		for (uint i = 0; i < texture_count; i++)
+			if (rects[i].page == page)
+				blit_to_atlas(atlas_storage[page].data(), page_size, images[i], rects[i], atlas_padding);
+		atlas_pages[page] = atlas_storage[page].data();
+	}
+
+	for (uint i = 0; i < texture_count; i++)
+	{
+		texture_pages[i] = (uint32_t)rects[i].page;
+		texture_uv_rects[i] = atlas_uv_rect(rects[i], page_size);
+		stbi_image_free(images[i]);
+		images[i] = nullptr;
+	}
+}
+
+// The meshes built in code
+void RenderAssets::createMeshes()
+{
+	//////////////////////////
+	// Initialize sprite
+	// The position corresponds to the center of the texture.
+	sprite_vertices.resize(4);
+	sprite_vertices[0].position = { -1.f/2, +1.f/2, 0.f };
+	sprite_vertices[1].position = { +1.f/2, +1.f/2, 0.f };
+	sprite_vertices[2].position = { +1.f/2, -1.f/2, 0.f };
+	sprite_vertices[3].position = { -1.f/2, -1.f/2, 0.f };
+	sprite_vertices[0].texcoord = { 0.f, 1.f };
+	sprite_vertices[1].texcoord = { 1.f, 1.f };
+	sprite_vertices[2].texcoord = { 1.f, 0.f };
+	sprite_vertices[3].texcoord = { 0.f, 0.f };
+
+	// Counterclockwise as it's the default opengl front winding direction.
+	sprite_indices = { 0, 3, 1, 1, 3, 2 };
+
+	////////////////////////
+	// Initialize Egg
+	std::vector<ColoredVertex> egg_vertices;
+	std::vector<uint16_t> egg_indices;
+	constexpr float z = -0.1f;
+	constexpr int NUM_TRIANGLES = 62;
+
+	for (int i = 0; i < NUM_TRIANGLES; i++) {
+		const float t = float(i) * M_PI * 2.f / float(NUM_TRIANGLES - 1);
+		egg_vertices.push_back({});
+		egg_vertices.back().position = { 0.5 * cos(t), 0.5 * sin(t), z };
+		egg_vertices.back().color = { 0.8, 0.8, 0.8 };
+	}
+	egg_vertices.push_back({});
+	egg_vertices.back().position = { 0, 0, 0 };
+	egg_vertices.back().color = { 1, 1, 1 };
+	for (int i = 0; i < NUM_TRIANGLES; i++) {
+		egg_indices.push_back((uint16_t)i);
+		egg_indices.push_back((uint16_t)((i + 1) % NUM_TRIANGLES));
+		egg_indices.push_back((uint16_t)NUM_TRIANGLES);
+	}
+	int geom_index = (int)GEOMETRY_BUFFER_ID::EGG;
+	meshes[geom_index].vertices = egg_vertices;
+	meshes[geom_index].vertex_indices = egg_indices;
+
+	///////////////////////////////////////////////////////
+	// Initialize screen triangle (yes, triangle, not quad; its more efficient).
+	screen_vertices.resize(3);
+	screen_vertices[0] = { -1, -6, 0.f };
+	screen_vertices[1] = { 6, -1, 0.f };
+	screen_vertices[2] = { -1, 6, 0.f };
+
+	// Counterclockwise as it's the default opengl front winding direction.
+	screen_indices = { 0, 1, 2 };
+}
+
+void RenderAssets::pointGeometryData()
+{
+	for (uint i = 0; i < geometry_count; i++)
+	{
+		const Mesh& mesh = meshes[i];
+		if (mesh.vertices.empty())
+			continue;
+		if (mesh.wide_indices.empty())
+			geometry_data[i] = { mesh.vertices.data(), mesh.vertices.size() * sizeof(ColoredVertex),
+				mesh.vertex_indices.data(), mesh.vertex_indices.size(), sizeof(uint16_t) };
+		else
+			geometry_data[i] = { mesh.vertices.data(), mesh.vertices.size() * sizeof(ColoredVertex),
+				mesh.wide_indices.data(), mesh.wide_indices.size(), sizeof(uint32_t) };
+	}
+	geometry_data[(int)GEOMETRY_BUFFER_ID::SPRITE] = { sprite_vertices.data(), sprite_vertices.size() * sizeof(TexturedVertex),
+		sprite_indices.data(), sprite_indices.size(), sizeof(uint16_t) };
+	geometry_data[(int)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE] = { screen_vertices.data(), screen_vertices.size() * sizeof(vec3),
+		screen_indices.data(), screen_indices.size(), sizeof(uint16_t) };
+}
+
+bool RenderAssets::readShader(const std::string& file_name, std::string& out_source) const
+{
+	if (archive.is_open())
+	{
+		size_t length = 0;
+		const char* source = (const char*)archive.find("shaders/" + file_name, length);
+		if (source == nullptr)
+			return false;
+		out_source.assign(source, length);
+		return true;
+	}
+	return readShaderFile(shaderPath(file_name), out_source);
+}
+
+bool RenderAssets::readShaderFile(const std::string& path, std::string& out_source)
+{
+	std::ifstream is(path);
+	if (!is.good())
+	{
+		fprintf(stderr, "Failed to load shader file %s\n", path.c_str());
+		return false;
+	}
+	std::stringstream ss;
+	ss << is.rdbuf();
+	out_source = ss.str();
+	return true;
+}
+
+bool RenderAssets::readTextureBlock(uint i, const std::string& path, std::vector<unsigned char>& out_rgba,
+	ivec2& out_position, ivec2& out_size) const
+{
+	ivec2 dimensions;
+	stbi_uc* data = stbi_load(path.c_str(), &dimensions.x, &dimensions.y, NULL, 4);
+	if (data == NULL)
+	{
+		fprintf(stderr, "Could not load the file %s\n", path.c_str());
+		return false;
+	}
+	if (dimensions.x != texture_dimensions[i].x || dimensions.y != texture_dimensions[i].y)
+	{
+		fprintf(stderr, "%s is %dx%d now instead of %dx%d, restart to repack the atlas\n", path.c_str(),
+			dimensions.x, dimensions.y, texture_dimensions[i].x, texture_dimensions[i].y);
+		stbi_image_free(data);
+		return false;
+	}
+
+	// The rect is where packTextures() put it, back from the uv rect in pixels
+	const vec4& uv_rect = texture_uv_rects[i];
+	const ivec2 position = { (int)roundf(uv_rect.x * page_size.x), (int)roundf(uv_rect.y * page_size.y) };
+	out_size = { dimensions.x + 2 * atlas_padding, dimensions.y + 2 * atlas_padding };
+	out_position = { position.x - atlas_padding, position.y - atlas_padding };
+
+	// Blitted into a page of just its own padded size, which repeats the border
+	AtlasRect rect;
+	rect.page = 0;
+	rect.position = { atlas_padding, atlas_padding };
+	rect.size = dimensions;
+	out_rgba.assign((size_t)out_size.x * out_size.y * 4, 0);
+	blit_to_atlas(out_rgba.data(), out_size, data, rect, atlas_padding);
+	stbi_image_free(data);
+	return true;
+}
+
+uint32_t RenderAssets::archiveLayout()
+{
+	return (uint32_t)sizeof(ColoredVertex) | (uint32_t)sizeof(TexturedVertex) << 8 |
+		(uint32_t)texture_count << 16 | (uint32_t)geometry_count << 24;
+}
+
+uint64_t RenderAssets::sourceHash() const
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (uint i = 0; i < texture_count; i++)
+		hash_file(texturePath(i), hash);
+	for (uint i = 0; i < mesh_names.size(); i++)
+		hash_file(meshPath(i), hash);
+	for (const std::string& name : effect_names)
+	{
+		hash_file(shaderPath(name + ".vs.glsl"), hash);
+		hash_file(shaderPath(name + ".fs.glsl"), hash);
+	}
+	return hash;
+}
+
+// Everything finishLoad() would build from the loose files, in the form it ends
+// up in: atlas pages, texture and hull tables, vertex and index buffers per
+// geometry, and the shader sources
+bool RenderAssets::writeArchive(const std::string& path) const
+{
+	AssetArchiveWriter writer;
+
+	const size_t page_bytes = (size_t)page_size.x * page_size.y * 4;
+	PackedAtlas atlas = { page_size, (uint32_t)atlas_pages.size(), 0 };
+	writer.add("atlas", &atlas, sizeof(atlas));
+	for (uint page = 0; page < atlas_pages.size(); page++)
+		writer.add("atlas/" + std::to_string(page), atlas_pages[page], page_bytes);
+
+	std::vector<PackedTexture> textures(texture_count);
+	std::vector<vec2> hull_vertices, hull_normals;
+	for (uint i = 0; i < texture_count; i++)
+	{
+		const ConvexHull& hull = texture_hulls[i];
+		textures[i] = { texture_dimensions[i], texture_pages[i], (uint32_t)hull.vertices.size(), texture_uv_rects[i] };
+		hull_vertices.insert(hull_vertices.end(), hull.vertices.begin(), hull.vertices.end());
+		hull_normals.insert(hull_normals.end(), hull.normals.begin(), hull.normals.end());
+	}
+	writer.add_array("textures", textures);
+	writer.add_array("texture_hull_vertices", hull_vertices);
+	writer.add_array("texture_hull_normals", hull_normals);
+
+	std::vector<PackedGeometry> geometries(geometry_count);
+	for (uint i = 0; i < geometry_count; i++)
+	{
+		const GeometryData& data = geometry_data[i];
+		geometries[i] = { meshes[i].original_size, data.index_size, 0 };
+		if (data.vertices == nullptr)
+			continue;
+		writer.add(geometry_entry(i, ".vertices"), data.vertices, data.vertex_bytes);
+		writer.add(geometry_entry(i, ".indices"), data.indices, data.index_count * data.index_size);
+	}
+	writer.add_array("geometries", geometries);
+
+	for (const std::string& name : effect_names)
+	{
+		for (const char* extension : { ".vs.glsl", ".fs.glsl" })
+		{
+			std::string source;
+			if (!readShader(name + extension, source))
+				return false;
+			writer.add("shaders/" + name + extension, source.data(), source.size());
+		}
+	}
+
+	return writer.write(path, archiveLayout(), sourceHash());
+}
+
+// Points straight into the mapping wherever the data goes to the GPU as is. Only
+// the few small meshes gameplay and the software rasterizer read get copied.
+bool RenderAssets::loadFromArchive()
+{
+	size_t count = 0;
+	const PackedAtlas* atlas = archive.find_array<PackedAtlas>("atlas", count);
+	if (atlas == nullptr || count != 1)
+		return false;
+	page_size = atlas->page_size;
+	const size_t page_bytes = (size_t)page_size.x * page_size.y * 4;
+	atlas_pages.assign(atlas->page_count, nullptr);
+	for (uint page = 0; page < atlas->page_count; page++)
+	{
+		size_t bytes = 0;
+		atlas_pages[page] = (const unsigned char*)archive.find("atlas/" + std::to_string(page), bytes);
+		if (atlas_pages[page] == nullptr || bytes != page_bytes)
+			return false;
+	}
+
+	size_t vertex_count = 0, normal_count = 0;
+	const PackedTexture* textures = archive.find_array<PackedTexture>("textures", count);
+	const vec2* hull_vertices = archive.find_array<vec2>("texture_hull_vertices", vertex_count);
+	const vec2* hull_normals = archive.find_array<vec2>("texture_hull_normals", normal_count);
+	if (textures == nullptr || count != texture_count || hull_vertices == nullptr || hull_normals == nullptr || vertex_count != normal_count)
+		return false;
+	size_t hull_begin = 0;
+	for (uint i = 0; i < texture_count; i++)
+	{
+		const PackedTexture& texture = textures[i];
+		if (texture.page >= atlas->page_count || texture.hull_size > vertex_count - hull_begin)
+			return false;
+		texture_dimensions[i] = texture.dimensions;
+		texture_pages[i] = texture.page;
+		texture_uv_rects[i] = texture.uv_rect;
+		texture_hulls[i].vertices.assign(hull_vertices + hull_begin, hull_vertices + hull_begin + texture.hull_size);
+		texture_hulls[i].normals.assign(hull_normals + hull_begin, hull_normals + hull_begin + texture.hull_size);
+		hull_begin += texture.hull_size;
+	}
+
+	const PackedGeometry* geometries = archive.find_array<PackedGeometry>("geometries", count);
+	if (geometries == nullptr || count != geometry_count)
+		return false;
+	for (uint i = 0; i < geometry_count; i++)
+	{
+		const GEOMETRY_BUFFER_ID id = (GEOMETRY_BUFFER_ID)i;
+		const uint32_t index_size = geometries[i].index_size;
+		size_t vertex_bytes = 0, index_bytes = 0;
+		const void* vertices = archive.find(geometry_entry(i, ".vertices"), vertex_bytes);
+		const void* indices = archive.find(geometry_entry(i, ".indices"), index_bytes);
+		if (vertices == nullptr || indices == nullptr)
+			continue;
+		// Only coloured meshes can be big enough for 32 bit indices
+		const bool wide = index_size == sizeof(uint32_t);
+		if (vertex_bytes % vertex_stride(id) != 0 || (index_size != sizeof(uint16_t) && !wide) ||
+			index_bytes % index_size != 0 || (wide && (id == GEOMETRY_BUFFER_ID::SPRITE || id == GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE)))
+			return false;
+		geometry_data[i] = { vertices, vertex_bytes, indices, index_bytes / index_size, index_size };
+
+		if (id == GEOMETRY_BUFFER_ID::SPRITE)
+		{
+			assign_from(sprite_vertices, vertices, vertex_bytes);
+			assign_from(sprite_indices, indices, index_bytes);
+		}
+		else if (id == GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE)
+		{
+			assign_from(screen_vertices, vertices, vertex_bytes);
+			assign_from(screen_indices, indices, index_bytes);
+		}
+		else
+		{
+			assign_from(meshes[i].vertices, vertices, vertex_bytes);
+			if (wide)
+				assign_from(meshes[i].wide_indices, indices, index_bytes);
+			else
+				assign_from(meshes[i].vertex_indices, indices, index_bytes);
+		}
+		meshes[i].original_size = geometries[i].original_size;
+	}
+	return true;
+}
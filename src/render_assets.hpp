@@ -0,0 +1,151 @@
+#pragma once
+
+#include <array>
+#include <utility>
+
+#include "common.hpp"
+#include "asset_archive.hpp"
+#include "asset_loader.hpp"
+#include "components.hpp"
+#include "texture_atlas.hpp"
+
+// Everything the game draws with, loaded from disk into CPU memory once at
+// startup. Render backends build their own resources from it (GL buffers and
+// textures, or nothing at all for the software rasterizer), and gameplay code
+// reads meshes and collision hulls from here, so none of it needs a GL context.
+//
+// If the resources hold an assets.pak made by tools/asset_packer.cpp from the
+// same files, all of it comes from that memory mapped archive instead of the
+// loose files.
+struct RenderAssets
+{
+#ifdef HOT_RELOAD_DIR
+	// The files hot reload watches, so what was edited while the game ran is
+	// still there after a restart. The archive would be out of date anyway.
+	std::string resources_dir = HOT_RELOAD_DIR;
+	bool use_archive = false;
+#else
+	// Loose files are read from data/ and shaders/ in here. The packer points it
+	// at the source tree.
+	std::string resources_dir = resources_path();
+	// Off for the packer, which must read the loose files
+	bool use_archive = true;
+#endif
+
+	// Make sure these names remain in sync with the associated enumerators.
+	// Associated id with .obj file in data/meshes
+	const std::vector < std::pair<GEOMETRY_BUFFER_ID, std::string>> mesh_names =
+	{
+		  std::pair<GEOMETRY_BUFFER_ID, std::string>(GEOMETRY_BUFFER_ID::CAR, "small_rect.obj"),
+		  std::pair<GEOMETRY_BUFFER_ID, std::string>(GEOMETRY_BUFFER_ID::WALL, "wall_panel.obj")
+		  // specify meshes of other assets here
+	};
+
+	// Make sure these names remain in sync with the associated enumerators.
+	// Images in data/textures
+	const std::array<std::string, texture_count> texture_names = {
+			"barrel_red_down.png",
+			"barrier_white.png",
+			"car_red_1.png",
+			"title.png" };
+
+	// Make sure these names remain in sync with the associated enumerators.
+	// Each has a .vs.glsl and a .fs.glsl in shaders/
+	const std::array<std::string, effect_count> effect_names = {
+		"coloured",
+		"egg",
+		"car",
+		"wall",
+		"textured",
+		"water",
+		"textured_instanced" };
+
+	std::string meshPath(uint i) const { return resources_dir + "/data/meshes/" + mesh_names[i].second; }
+	std::string texturePath(uint i) const { return texturePath(i, resources_dir); }
+	std::string shaderPath(const std::string& file_name) const { return shaderPath(file_name, resources_dir); }
+	// Same, under another directory laid out like Resources, e.g. the source tree
+	std::string texturePath(uint i, const std::string& dir) const { return dir + "/data/textures/" + texture_names[i]; }
+	std::string shaderPath(const std::string& file_name, const std::string& dir) const { return dir + "/shaders/" + file_name; }
+	std::string archivePath() const { return resources_dir + "/assets.pak"; }
+
+	// All textures packed into RGBA atlas pages, image row 0 is texcoord v = 0.
+	// The pages live in atlas_storage, or in the archive.
+	const int atlas_page_size = 1024;
+	const int atlas_padding = 2;
+	ivec2 page_size = { 0, 0 };
+	std::vector<const unsigned char*> atlas_pages;
+	std::array<ivec2, texture_count> texture_dimensions;
+	std::array<uint32_t, texture_count> texture_pages;
+	std::array<vec4, texture_count> texture_uv_rects;
+
+	// Coloured meshes (CAR, WALL and EGG) in their normalized -0.5 ... 0.5 space
+	std::array<Mesh, geometry_count> meshes;
+	// The unit quad all sprites are drawn with, and the triangle covering the screen
+	std::vector<TexturedVertex> sprite_vertices;
+	std::vector<uint16_t> sprite_indices;
+	std::vector<vec3> screen_vertices;
+	std::vector<uint16_t> screen_indices;
+
+	// What the GPU gets for each geometry, the vertex layout follows from the id
+	// (see archiveLayout()). Points into the vectors above, or into the archive.
+	struct GeometryData
+	{
+		const void* vertices = nullptr;
+		size_t vertex_bytes = 0;
+		const void* indices = nullptr;
+		size_t index_count = 0;
+		uint32_t index_size = sizeof(uint16_t); // 4 for meshes with wide_indices
+	};
+	std::array<GeometryData, geometry_count> geometry_data;
+
+	// Collision outlines. Sprites all share GEOMETRY_BUFFER_ID::SPRITE, so they are outlined per texture.
+	std::array<ConvexHull, texture_count> texture_hulls;
+
+	Mesh& getMesh(GEOMETRY_BUFFER_ID id) { return meshes[(int)id]; };
+	const ConvexHull& getHull(TEXTURE_ASSET_ID id) const { return texture_hulls[(int)id]; };
+
+	// Loads everything on the calling thread
+	bool load();
+	// Queues decoding the images and parsing the OBJ files on the loader.
+	// Call finishLoad() once the loader is done.
+	void queueLoad(AssetLoader& loader);
+	bool finishLoad();
+	bool isQueued() const { return queued; }
+	bool isFromArchive() const { return archive.is_open(); }
+
+	// Shader source from the archive or shaders/
+	bool readShader(const std::string& file_name, std::string& out_source) const;
+	static bool readShaderFile(const std::string& path, std::string& out_source);
+
+	// Decodes the image at path as texture i and lays it out the way the texture
+	// sits in its atlas page, padding included, for re-uploading an edited file.
+	// Fails if the image cannot be read or its size changed, as the atlas has no
+	// room for that. The collision hull is left as it was.
+	bool readTextureBlock(uint i, const std::string& path, std::vector<unsigned char>& out_rgba,
+		ivec2& out_position, ivec2& out_size) const;
+
+	// Writes everything loaded so far into an archive, for the packer
+	bool writeArchive(const std::string& path) const;
+	// Fingerprint of the structs in the archive, an archive packed with other
+	// vertex layouts or asset counts is not used
+	static uint32_t archiveLayout();
+	// Hash of the contents of every texture, mesh and shader file under
+	// resources_dir, an archive packed from other contents is not used.
+	// Reads the files, but they are small.
+	uint64_t sourceHash() const;
+
+private:
+	void queueFiles(AssetLoader& loader);
+	bool loadTexture(uint i);
+	bool loadMesh(uint i);
+	void packTextures();
+	void createMeshes();
+	void pointGeometryData();
+	bool loadFromArchive();
+
+	// Decoded images between loadTexture() and packTextures()
+	std::array<unsigned char*, texture_count> images = {};
+	std::vector<std::vector<unsigned char>> atlas_storage;
+	AssetArchive archive;
+	bool queued = false;
+};
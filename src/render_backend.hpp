@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+
+#include "common.hpp"
+#include "components.hpp"
+#include "frame_snapshot.hpp"
+#include "render_queue.hpp"
+
+// Everything the draw loop needs to know about one entity, gathered up front so
+// drawing in sorted order does not have to look components up again
+struct DrawItem
+{
+	Affine2D transform;
+	vec3 color;
+	bool lit;
+	RenderRequest request;
+};
+
+// Work done by the last frame, shown in the window title in debug mode
+struct RenderStats
+{
+	uint submitted = 0; // renderables that passed culling
+	uint culled = 0;
+	uint draw_calls = 0;
+	uint instances = 0;
+	uint program_binds = 0;
+	uint texture_binds = 0;
+	uint vao_binds = 0;
+};
+
+// What RenderSystem draws with. Culling, sorting and the render thread are the
+// same for every backend, a backend only turns the sorted draw list into pixels.
+// All calls except the constructor happen on the render thread.
+class RenderBackend
+{
+public:
+	virtual ~RenderBackend() {}
+
+	// Called when the render thread takes over or gives back the backend, for
+	// backends bound to a thread like a GL context
+	virtual void make_current() {}
+	virtual void release_current() {}
+
+	// Draws items in the order of the sorted queue, then the post processing pass
+	virtual void draw(const RenderQueue& queue, const std::vector<DrawItem>& items,
+		const mat3& projection, const FrameSnapshot& snapshot, RenderStats& stats) = 0;
+
+	// Copies the frame drawn last, RGBA with the top row first. Only valid
+	// between draw() and present().
+	virtual bool read_pixels(std::vector<unsigned char>& out_rgba, ivec2& out_size) = 0;
+
+	// Shows the frame, e.g. swaps the window buffers
+	virtual void present() {}
+};
@@ -0,0 +1,65 @@
+// internal
+#include "render_benchmark.hpp"
+#include "asset_loader.hpp"
+#include "render_system.hpp"
+#include "tiny_ecs_registry.hpp"
+#include "world_system.hpp"
+
+// stlib
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <thread>
+
+using Clock = std::chrono::steady_clock;
+
+int run_render_benchmark(const RenderBenchmarkOptions& options)
+{
+	WorldSystem world; // only for the window
+	RenderSystem renderer;
+	AssetLoader loader;
+	renderer.load_assets(loader);
+	loader.start();
+	GLFWwindow* window = world.create_window();
+	if (window == nullptr || !loader.wait())
+		return EXIT_FAILURE;
+	renderer.init(window);
+
+	// Same sprites as in the game, in random sizes and turned every which way
+	const TEXTURE_ASSET_ID textures[] = { TEXTURE_ASSET_ID::BONUS, TEXTURE_ASSET_ID::BARRIER, TEXTURE_ASSET_ID::CAR_SPRITE };
+	std::default_random_engine rng(1);
+	std::uniform_real_distribution<float> uniform_dist; // number between 0..1
+	for (unsigned i = 0; i < options.sprites; i++) {
+		Entity entity;
+		Motion& motion = registry.motions.emplace(entity);
+		motion.position = { uniform_dist(rng) * window_width_px, uniform_dist(rng) * window_height_px };
+		motion.scale = { 30.f + uniform_dist(rng) * 30.f, 20.f + uniform_dist(rng) * 20.f };
+		motion.angle = uniform_dist(rng) * 2.f * (float)M_PI;
+		registry.renderRequests.insert(entity,
+			{ textures[i % 3], EFFECT_ASSET_ID::TEXTURED, GEOMETRY_BUFFER_ID::SPRITE });
+	}
+
+	// The render thread takes the next frame once it is done with the last,
+	// so after a few frames to warm up, frames go as fast as it draws them
+	const unsigned warmup = 5;
+	renderer.start();
+	Clock::time_point start;
+	for (unsigned frame = 0; frame < warmup + options.frames; frame++) {
+		if (frame == warmup)
+			start = Clock::now();
+		renderer.submit_frame(1000.f / 60.f);
+		while (renderer.is_frame_pending()) {
+			glfwPollEvents();
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+	}
+	float run_ms = std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+	renderer.stop();
+
+	RenderStats stats = renderer.get_stats();
+	printf("Render benchmark: %u sprites on %s\n", options.sprites, (const char*)glGetString(GL_RENDERER));
+	printf("  %u draw calls, %u instances, %u program, %u texture and %u VAO binds per frame\n",
+		stats.draw_calls, stats.instances, stats.program_binds, stats.texture_binds, stats.vao_binds);
+	printf("  %.2f ms per frame over %u frames\n", run_ms / std::max(1u, options.frames), options.frames);
+	return EXIT_SUCCESS;
+}
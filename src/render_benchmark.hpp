@@ -0,0 +1,17 @@
+#pragma once
+
+#include "common.hpp"
+
+// Opens the game window and draws a scene of sprites, nothing but sprites,
+// spread over the screen with the game's textures through RenderSystem and
+// the OpenGL backend, then prints the GL draw calls and the time per frame.
+// Without a GPU, or to compare machines, run it on Mesa's llvmpipe with vsync off:
+//   LIBGL_ALWAYS_SOFTWARE=1 vblank_mode=0 main --render-benchmark --sprites 10000
+struct RenderBenchmarkOptions
+{
+	unsigned sprites = 10000;
+	unsigned frames = 100;
+};
+
+// Returns the exit code
+int run_render_benchmark(const RenderBenchmarkOptions& options);
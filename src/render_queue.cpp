@@ -0,0 +1,53 @@
+// internal
+#include "render_queue.hpp"
+
+// stlib
+#include <algorithm>
+#include <array>
+
+static_assert((int)RENDER_LAYER::LAYER_COUNT <= 16, "layer does not fit its 4 bits of the sort key");
+static_assert(effect_count <= 16, "effect does not fit its 4 bits of the sort key");
+static_assert(geometry_count < 256, "geometry does not fit its 8 bits of the sort key");
+
+void RenderQueue::push(const RenderRequest& request, uint32_t texture, uint32_t depth, uint32_t item)
+{
+	assert(texture < 256 && "texture does not fit its 8 bits of the sort key");
+	assert(item < (1u << 24));
+	uint64_t key =
+		((uint64_t)request.used_layer << 60) |
+		((uint64_t)request.used_effect << 56) |
+		((uint64_t)texture << 48) |
+		((uint64_t)request.used_geometry << 40) |
+		((uint64_t)std::min(depth, 0xffffu) << 24) |
+		(uint64_t)item;
+	keys.push_back(key);
+}
+
+void RenderQueue::sort()
+{
+	const size_t n = keys.size();
+	if (n < 2)
+		return;
+	scratch.resize(n);
+
+	for (int shift = 0; shift < 64; shift += 8)
+	{
+		std::array<size_t, 256> counts = {};
+		for (uint64_t key : keys)
+			counts[(key >> shift) & 0xff]++;
+		// all keys share this byte, nothing to reorder
+		if (counts[(keys[0] >> shift) & 0xff] == n)
+			continue;
+
+		size_t sum = 0;
+		for (size_t& count : counts)
+		{
+			size_t c = count;
+			count = sum;
+			sum += c;
+		}
+		for (uint64_t key : keys)
+			scratch[counts[(key >> shift) & 0xff]++] = key;
+		keys.swap(scratch);
+	}
+}
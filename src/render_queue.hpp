@@ -0,0 +1,38 @@
+#pragma once
+
+#include "common.hpp"
+#include "components.hpp"
+
+// Collects one 64 bit key per draw and sorts them so draws sharing GL state end up
+// next to each other. Layout, from the most to the least significant bits:
+//
+//   layer 4 | effect 4 | texture 8 | geometry 8 | depth 16 | item 24
+//
+// texture is the GL texture the draw binds, i.e. its atlas page, not the TEXTURE_ASSET_ID.
+// depth is the submission order within a state group, which keeps the painter's
+// order between sprites of the same kind. item indexes the caller's draw data.
+class RenderQueue
+{
+public:
+	void clear() { keys.clear(); }
+
+	void push(const RenderRequest& request, uint32_t texture, uint32_t depth, uint32_t item);
+
+	// LSD radix sort, 8 bits per pass. Passes where every key has the same byte are skipped.
+	void sort();
+
+	size_t size() const { return keys.size(); }
+	uint64_t operator[](size_t i) const { return keys[i]; }
+
+	// The upper 24 bits, equal for draws that need no state change in between
+	static uint32_t state_of(uint64_t key) { return (uint32_t)(key >> 40); }
+	static RENDER_LAYER layer_of(uint64_t key) { return (RENDER_LAYER)(key >> 60); }
+	static EFFECT_ASSET_ID effect_of(uint64_t key) { return (EFFECT_ASSET_ID)((key >> 56) & 0xf); }
+	static uint32_t texture_of(uint64_t key) { return (uint32_t)((key >> 48) & 0xff); }
+	static GEOMETRY_BUFFER_ID geometry_of(uint64_t key) { return (GEOMETRY_BUFFER_ID)((key >> 40) & 0xff); }
+	static uint32_t item_of(uint64_t key) { return (uint32_t)(key & 0xffffff); }
+
+private:
+	std::vector<uint64_t> keys;
+	std::vector<uint64_t> scratch;
+};
@@ -1,239 +1,198 @@
 // internal
 #include "render_system.hpp"
-#include <SDL.h>
+#include "debug_draw.hpp"
+#include "gl_render_backend.hpp"
+#include "png_writer.hpp"
+#include "profiler.hpp"
+#include "software_render_backend.hpp"
 
 #include "state_system.h"
 #include "tiny_ecs_registry.hpp"
 // #include "world_system.hpp"
-#include "state_system.h"
 
-void RenderSystem::drawTexturedMesh(Entity entity,
-                                    const mat3 &projection)
+bool RenderSystem::init(GLFWwindow* window)
 {
-	Motion &motion = registry.motions.get(entity);
-	// Transformation code, see Rendering and Transformation in the template
-	// specification for more info Incrementally updates transformation matrix,
-	// thus ORDER IS IMPORTANT
-	Transform transform;
-	transform.translate(motion.position);
-	// TODO: Move player around rear pivot point and fix collisions to accomodate
-	transform.rotate(motion.angle);
-	transform.scale(motion.scale);
-
-
-
-	assert(registry.renderRequests.has(entity));
-	const RenderRequest &render_request = registry.renderRequests.get(entity);
+	if (!initCommon())
+		return false;
+	std::unique_ptr<GlRenderBackend> gl_backend(new GlRenderBackend(window, assets));
+	if (!gl_backend->init())
+		return false;
+	backend = std::move(gl_backend);
+	return true;
+}
 
-	const GLuint used_effect_enum = (GLuint)render_request.used_effect;
-	assert(used_effect_enum != (GLuint)EFFECT_ASSET_ID::EFFECT_COUNT);
-	const GLuint program = (GLuint)effects[used_effect_enum];
+bool RenderSystem::init_headless(ivec2 framebuffer_size, unsigned threads)
+{
+	if (!initCommon())
+		return false;
+	backend.reset(new SoftwareRenderBackend(assets, framebuffer_size, threads));
+	return true;
+}
 
-	// Setting shaders
-	glUseProgram(program);
-	gl_has_errors();
+bool RenderSystem::initCommon()
+{
+	registry.screenStates.emplace(screen_state_entity);
+	// Loaded on the asset loader already if load_assets() was called
+	return assets.isQueued() ? assets.finishLoad() : assets.load();
+}
 
-	assert(render_request.used_geometry != GEOMETRY_BUFFER_ID::GEOMETRY_COUNT);
-	const GLuint vbo = vertex_buffers[(GLuint)render_request.used_geometry];
-	const GLuint ibo = index_buffers[(GLuint)render_request.used_geometry];
+RenderSystem::~RenderSystem()
+{
+	stop();
+	backend.reset();
 
-	// Setting vertex and index buffers
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-	gl_has_errors();
+	// remove all entities created by the render system
+	while (registry.renderRequests.entities.size() > 0)
+	    registry.remove_all_components_of(registry.renderRequests.entities.back());
+}
 
-	// Input data location as in the vertex buffer
-	if (render_request.used_effect == EFFECT_ASSET_ID::TEXTURED)
+// Copies what the next frame needs out of the registry and hands it to the
+// render thread. Called on the simulation thread after each step.
+void RenderSystem::submit_frame(float elapsed_ms)
+{
+	PROFILE_SCOPE("RenderSystem::submit_frame");
+	time_ms += elapsed_ms;
+	FrameSnapshot& snapshot = snapshots.write_buffer();
+	snapshot.renderables.clear();
+	auto& render_requests = registry.renderRequests;
+	for (uint i = 0; i < render_requests.size(); i++)
 	{
-		GLint in_position_loc = glGetAttribLocation(program, "in_position");
-		GLint in_texcoord_loc = glGetAttribLocation(program, "in_texcoord");
-		gl_has_errors();
-		assert(in_texcoord_loc >= 0);
-
-		glEnableVertexAttribArray(in_position_loc);
-		glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE,
-							  sizeof(TexturedVertex), (void *)0);
-		gl_has_errors();
-
-		glEnableVertexAttribArray(in_texcoord_loc);
-		glVertexAttribPointer(
-			in_texcoord_loc, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex),
-			(void *)sizeof(
-				vec3)); // note the stride to skip the preceeding vertex position
-
-		// Enabling and binding texture to slot 0
-		glActiveTexture(GL_TEXTURE0);
-		gl_has_errors();
-
-		assert(registry.renderRequests.has(entity));
-		GLuint texture_id =
-			texture_gl_handles[(GLuint)registry.renderRequests.get(entity).used_texture];
-
-		glBindTexture(GL_TEXTURE_2D, texture_id);
-		gl_has_errors();
+		Entity entity = render_requests.entities[i];
+		if (!registry.motions.has(entity))
+			continue;
+		FrameSnapshot::Renderable renderable;
+		renderable.motion = registry.motions.get(entity);
+		renderable.color = registry.colors.has(entity) ? registry.colors.get(entity) : vec3(1);
+		renderable.lit = registry.lit.has(entity);
+		renderable.request = render_requests.components[i];
+		snapshot.renderables.push_back(renderable);
 	}
-	else if (render_request.used_effect == EFFECT_ASSET_ID::CAR ||
-		render_request.used_effect == EFFECT_ASSET_ID::WALL ||
-		render_request.used_effect == EFFECT_ASSET_ID::EGG)
-	{
-		GLint in_position_loc = glGetAttribLocation(program, "in_position");
-		GLint in_color_loc = glGetAttribLocation(program, "in_color");
-		gl_has_errors();
+	snapshot.darken_screen_factor = registry.screenStates.get(screen_state_entity).darken_screen_factor;
+	snapshot.advanced = StateSystem::is_advanced();
+	snapshot.time = time_ms / 1000.f;
+	debug::swap_lines(snapshot.debug_lines);
+	// travels with the snapshot, so it is saved from exactly this frame
+	snapshot.capture_path.swap(capture_path);
+	capture_path.clear();
+	snapshots.publish();
+}
 
-		glEnableVertexAttribArray(in_position_loc);
-		glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE,
-							  sizeof(ColoredVertex), (void *)0);
-		gl_has_errors();
+void RenderSystem::start()
+{
+	assert(!running);
+	// The render thread owns the backend from now on
+	backend->release_current();
+	running = true;
+	render_thread = std::thread(&RenderSystem::renderLoop, this);
+}
 
-		glEnableVertexAttribArray(in_color_loc);
-		glVertexAttribPointer(in_color_loc, 3, GL_FLOAT, GL_FALSE,
-							  sizeof(ColoredVertex), (void *)sizeof(vec3));
-		gl_has_errors();
+void RenderSystem::stop()
+{
+	if (!running)
+		return;
+	running = false;
+	render_thread.join();
+	// Back to this thread, so the destructor can free the GL objects
+	backend->make_current();
+}
 
-		if (render_request.used_effect == EFFECT_ASSET_ID::CAR)
+void RenderSystem::renderLoop()
+{
+	PROFILE_THREAD_NAME("render");
+	backend->make_current();
+	while (running)
+	{
+		if (!snapshots.acquire())
 		{
-			// Light up?
-			GLint light_up_uloc = glGetUniformLocation(program, "light_up");
-			assert(light_up_uloc >= 0);
-
-			bool entity_lit = registry.lit.has(entity);
-			// similar to the glUniform1f call below. The 1f or 1i specified the type, here a single int.
-			glUniform1i(light_up_uloc, entity_lit);
-			gl_has_errors();
+			// the simulation is still working on the next frame
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+			continue;
 		}
+		draw(snapshots.read_buffer());
 	}
-	else
-	{
-		assert(false && "Type of render request not supported");
-	}
+	backend->release_current();
+}
 
-	// Getting uniform locations for glUniform* calls
-	GLint color_uloc = glGetUniformLocation(program, "fcolor");
-	const vec3 color = registry.colors.has(entity) ? registry.colors.get(entity) : vec3(1);
-	glUniform3fv(color_uloc, 1, (float *)&color);
-	gl_has_errors();
-
-	// Get number of indices from index buffer, which has elements uint16_t
-	GLint size = 0;
-	glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
-	gl_has_errors();
-
-	GLsizei num_indices = size / sizeof(uint16_t);
-	// GLsizei num_triangles = num_indices / 3;
-
-	GLint currProgram;
-	glGetIntegerv(GL_CURRENT_PROGRAM, &currProgram);
-	// Setting uniform values to the currently bound program
-	GLuint transform_loc = glGetUniformLocation(currProgram, "transform");
-	glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float *)&transform.mat);
-	GLuint projection_loc = glGetUniformLocation(currProgram, "projection");
-	glUniformMatrix3fv(projection_loc, 1, GL_FALSE, (float *)&projection);
-	gl_has_errors();
-	// Drawing of num_indices/3 triangles specified in the index buffer
-	glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr);
-	gl_has_errors();
+// Called on the render thread between drawing and presenting a frame
+void RenderSystem::saveCapture(const std::string& path)
+{
+	std::vector<unsigned char> pixels;
+	ivec2 size;
+	if (!backend->read_pixels(pixels, size) || !write_png(path, pixels.data(), size))
+		fprintf(stderr, "Failed to capture the frame to %s\n", path.c_str());
 }
 
-// draw the intermediate texture to the screen, with some distortion to simulate
-// water
-void RenderSystem::drawToScreen()
+RenderStats RenderSystem::get_stats()
 {
-	// Setting shaders
-	// get the water texture, sprite mesh, and program
-	glUseProgram(effects[(GLuint)EFFECT_ASSET_ID::ROAD]);
-	gl_has_errors();
-	// Clearing backbuffer
-	int w, h;
-	glfwGetFramebufferSize(window, &w, &h); // Note, this will be 2x the resolution given to glfwCreateWindow on retina displays
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	glViewport(0, 0, w, h);
-	glDepthRange(0, 10);
-	glClearColor(1.f, 0, 0, 1.0);
-	glClearDepth(1.f);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	gl_has_errors();
-	// Enabling alpha channel for textures
-	glDisable(GL_BLEND);
-	// glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	glDisable(GL_DEPTH_TEST);
-
-	// Draw the screen texture on the quad geometry
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]);
-	glBindBuffer(
-		GL_ELEMENT_ARRAY_BUFFER,
-		index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]); // Note, GL_ELEMENT_ARRAY_BUFFER associates
-																	 // indices to the bound GL_ARRAY_BUFFER
-	gl_has_errors();
-	const GLuint water_program = effects[(GLuint)EFFECT_ASSET_ID::ROAD];
-	// Set clock
-	GLuint time_uloc = glGetUniformLocation(water_program, "time");
-	GLuint advanced_uloc = glGetUniformLocation(water_program, "advanced");
-	GLuint dead_timer_uloc = glGetUniformLocation(water_program, "darken_screen_factor");
-	glUniform1f(time_uloc, (float)(glfwGetTime() * 10.0f));
-	glUniform1i(advanced_uloc, StateSystem::is_advanced());
-	ScreenState &screen = registry.screenStates.get(screen_state_entity);
-	glUniform1f(dead_timer_uloc, screen.darken_screen_factor);
-	gl_has_errors();
-	// Set the vertex position and vertex texture coordinates (both stored in the
-	// same VBO)
-	GLint in_position_loc = glGetAttribLocation(water_program, "in_position");
-	glEnableVertexAttribArray(in_position_loc);
-	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), (void *)0);
-	gl_has_errors();
-
-	// Bind our texture in Texture Unit 0
-	glActiveTexture(GL_TEXTURE0);
-
-	glBindTexture(GL_TEXTURE_2D, off_screen_render_buffer_color);
-	gl_has_errors();
-	// Draw
-	glDrawElements(
-		GL_TRIANGLES, 3, GL_UNSIGNED_SHORT,
-		nullptr); // one triangle = 3 vertices; nullptr indicates that there is
-				  // no offset from the bound index buffer
-	gl_has_errors();
+	std::lock_guard<std::mutex> lock(stats_mutex);
+	return published_stats;
 }
 
 // Render our game world
 // http://www.opengl-tutorial.org/intermediate-tutorials/tutorial-14-render-to-texture/
-void RenderSystem::draw()
+void RenderSystem::draw(const FrameSnapshot& snapshot)
 {
-	// Getting size of window
-	int w, h;
-	glfwGetFramebufferSize(window, &w, &h); // Note, this will be 2x the resolution given to glfwCreateWindow on retina displays
-
-	// First render to the custom framebuffer
-	glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer);
-	gl_has_errors();
-	// Clearing backbuffer
-	glViewport(0, 0, w, h);
-	glDepthRange(0.00001, 10);
-	glClearColor(GLfloat(172 / 255), GLfloat(216 / 255), GLfloat(255 / 255), 1.0);
-	glClearDepth(10.f);
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	glDisable(GL_DEPTH_TEST); // native OpenGL does not work with a depth buffer
-							  // and alpha blending, one would have to sort
-							  // sprites back to front
-	gl_has_errors();
+	PROFILE_SCOPE("RenderSystem::draw");
 	mat3 projection_2D = createProjectionMatrix();
-	// Draw all textured meshes that have a position and size component
-	for (Entity entity : registry.renderRequests.entities)
+
+	// Drop everything outside the view before it costs any more work. Entities
+	// are spawned off screen to the right and only removed once past the left edge.
+	const std::vector<FrameSnapshot::Renderable>& renderables = snapshot.renderables;
+	cull_list.clear();
+	for (uint i = 0; i < renderables.size(); i++)
 	{
-		if (!registry.motions.has(entity))
+		const Motion &motion = renderables[i].motion;
+		cull_list.push(motion.position, motion.scale, motion.angle, i);
+	}
+	vec2 view_min, view_max;
+	view_bounds(projection_2D, view_min, view_max);
+	size_t visible_count = cull_list.cull(view_min, view_max);
+
+	stats = RenderStats();
+	stats.submitted = (uint)visible_count;
+	stats.culled = (uint)(cull_list.size() - visible_count);
+
+	// Gather everything that gets drawn and queue it up by render state
+	draw_items.clear();
+	render_queue.clear();
+	transform_batch.clear();
+	for (size_t c = 0; c < cull_list.size(); c++)
+	{
+		if (!cull_list.is_visible(c))
 			continue;
-		// Note, its not very efficient to access elements indirectly via the entity
-		// albeit iterating through all Sprites in sequence. A good point to optimize
-		drawTexturedMesh(entity, projection_2D);
+		const FrameSnapshot::Renderable& renderable = renderables[cull_list.item(c)];
+
+		// Model matrices are all computed in one go below
+		// TODO: Move player around rear pivot point and fix collisions to accomodate
+		const Motion &motion = renderable.motion;
+		transform_batch.push(motion.position, motion.scale, motion.angle);
+
+		DrawItem item;
+		item.color = renderable.color;
+		item.lit = renderable.lit;
+		item.request = renderable.request;
+		// submission order doubles as depth, so equal state keeps the old painter's order
+		uint32_t index = (uint32_t)draw_items.size();
+		uint32_t page = item.request.used_texture == TEXTURE_ASSET_ID::TEXTURE_COUNT ? 0 : assets.texture_pages[(GLuint)item.request.used_texture];
+		render_queue.push(item.request, page, index, index);
+		draw_items.push_back(item);
 	}
+	// translate * rotate * scale of every item, written straight into the draw items
+	if (!draw_items.empty())
+		compute_transforms(transform_batch, &draw_items[0].transform, sizeof(DrawItem));
+	render_queue.sort();
+
+	backend->draw(render_queue, draw_items, projection_2D, snapshot, stats);
+	if (!snapshot.capture_path.empty())
+		saveCapture(snapshot.capture_path);
 
-	// Truely render to the screen
-	drawToScreen();
+	{
+		std::lock_guard<std::mutex> lock(stats_mutex);
+		published_stats = stats;
+	}
 
-	// flicker-free display with a double buffer
-	glfwSwapBuffers(window);
-	gl_has_errors();
+	PROFILE_SCOPE("present");
+	backend->present();
 }
 
 mat3 RenderSystem::createProjectionMatrix()
@@ -242,7 +201,6 @@ mat3 RenderSystem::createProjectionMatrix()
 	float left = 0.f;
 	float top = 0.f;
 
-	gl_has_errors();
 	float right = (float) window_width_px;
 	float bottom = (float) window_height_px;
 
@@ -1,98 +1,86 @@
 #pragma once
 
-#include <array>
-#include <utility>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
 
 #include "common.hpp"
 #include "components.hpp"
+#include "culling.hpp"
+#include "frame_snapshot.hpp"
+#include "render_assets.hpp"
+#include "render_backend.hpp"
+#include "render_queue.hpp"
 #include "tiny_ecs.hpp"
+#include "transform_batch.hpp"
 
-// System responsible for setting up OpenGL and for rendering all the
-// visual entities in the game
+// System responsible for rendering all the visual entities in the game. It
+// culls and sorts what is visible, a RenderBackend turns that into pixels:
+// OpenGL into the window, or the software rasterizer for headless runs.
 class RenderSystem {
-	/**
-	 * The following arrays store the assets the game will use. They are loaded
-	 * at initialization and are assumed to not be modified by the render loop.
-	 *
-	 * Whenever possible, add to these lists instead of creating dynamic state
-	 * it is easier to debug and faster to execute for the computer.
-	 */
-	std::array<GLuint, texture_count> texture_gl_handles;
-	std::array<ivec2, texture_count> texture_dimensions;
-
-	// Make sure these paths remain in sync with the associated enumerators.
-	// Associated id with .obj path
-	const std::vector < std::pair<GEOMETRY_BUFFER_ID, std::string>> mesh_paths =
-	{
-		  std::pair<GEOMETRY_BUFFER_ID, std::string>(GEOMETRY_BUFFER_ID::CAR, mesh_path("small_rect.obj")),
-		  std::pair<GEOMETRY_BUFFER_ID, std::string>(GEOMETRY_BUFFER_ID::WALL, mesh_path("wall_panel.obj"))
-		  // specify meshes of other assets here
-	};
-
-	// Make sure these paths remain in sync with the associated enumerators.
-	const std::array<std::string, texture_count> texture_paths = {
-			textures_path("barrel_red_down.png"),
-			textures_path("barrier_white.png"),
-			textures_path("car_red_1.png"),
-			textures_path("title.png") };
-
-	std::array<GLuint, effect_count> effects;
-	// Make sure these paths remain in sync with the associated enumerators.
-	const std::array<std::string, effect_count> effect_paths = {
-		shader_path("coloured"),
-		shader_path("egg"),
-		shader_path("car"),
-		shader_path("wall"),
-		shader_path("textured"),
-		shader_path("water") };
-
-	std::array<GLuint, geometry_count> vertex_buffers;
-	std::array<GLuint, geometry_count> index_buffers;
-	std::array<Mesh, geometry_count> meshes;
+	// Meshes, textures and collision hulls, shared by all backends
+	RenderAssets assets;
+	std::unique_ptr<RenderBackend> backend;
+
+	// Per frame draw list, drawn in the order of the sorted queue
+	CullList cull_list;
+	TransformBatch transform_batch;
+	std::vector<DrawItem> draw_items;
+	RenderQueue render_queue;
 
 public:
+	// Queues reading the meshes and textures on the loader, so it can overlap
+	// with window creation. init() has to wait for the loader to finish.
+	void load_assets(AssetLoader& loader) { assets.queueLoad(loader); }
+
 	// Initialize the window
 	bool init(GLFWwindow* window);
+	// Draw with the software rasterizer into an offscreen image of the given
+	// size instead, needs no window or GL context. threads = 0 uses all cores.
+	bool init_headless(ivec2 framebuffer_size, unsigned threads = 0);
 
-	template <class T>
-	void bindVBOandIBO(GEOMETRY_BUFFER_ID gid, std::vector<T> vertices, std::vector<uint16_t> indices);
-
-	void initializeGlTextures();
-
-	void initializeGlEffects();
-
-	void initializeGlMeshes();
-	Mesh& getMesh(GEOMETRY_BUFFER_ID id) { return meshes[(int)id]; };
-
-	void initializeGlGeometryBuffers();
-	// Initialize the screen texture used as intermediate render target
-	// The draw loop first renders to this texture, then it is used for the wind
-	// shader
-	bool initScreenTexture();
+	// The entity factories in world_init.hpp take their meshes and hulls from here
+	RenderAssets& get_assets() { return assets; }
+	const RenderAssets& get_assets() const { return assets; }
 
 	// Destroy resources associated to one or all entities created by the system
 	~RenderSystem();
 
-	// Draw all entities
-	void draw();
+	// Drawing happens on a render thread that owns the backend. Each call to
+	// submit_frame() hands it a snapshot of the world, which it draws while the
+	// simulation already works on the next step.
+	void start();
+	void stop();
+	void submit_frame(float elapsed_ms);
+	// True while the render thread has not picked up the last submitted frame yet
+	bool is_frame_pending() const { return snapshots.has_unread(); }
 
-	mat3 createProjectionMatrix();
+	// Saves the frame of the next submit_frame() as a PNG, once the render thread drew it
+	void capture_frame(const std::string& path) { capture_path = path; }
 
-private:
-	// Internal drawing functions for each entity type
-	void drawTexturedMesh(Entity entity, const mat3& projection);
-	void drawToScreen();
+	mat3 createProjectionMatrix();
 
-	// Window handle
-	GLFWwindow* window;
+	// Counters of the last frame the render thread finished
+	RenderStats get_stats();
 
-	// Screen texture handles
-	GLuint frame_buffer;
-	GLuint off_screen_render_buffer_color;
-	GLuint off_screen_render_buffer_depth;
+private:
+	bool initCommon();
+	void renderLoop();
+	// Draw all entities of a snapshot
+	void draw(const FrameSnapshot& snapshot);
+	void saveCapture(const std::string& path);
+
+	RenderStats stats;
+
+	TripleBuffer<FrameSnapshot> snapshots;
+	float time_ms = 0.f;
+	std::thread render_thread;
+	std::atomic<bool> running{ false };
+	std::mutex stats_mutex;
+	RenderStats published_stats; // guarded by stats_mutex
+	std::string capture_path; // for the next snapshot, empty if no capture is asked for
 
 	Entity screen_state_entity;
 };
-
-bool loadEffectFromFile(
-	const std::string& vs_path, const std::string& fs_path, GLuint& out_program);
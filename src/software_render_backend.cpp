@@ -0,0 +1,323 @@
+// internal
+#include "software_render_backend.hpp"
+#include "profiler.hpp"
+#include "render_queue.hpp"
+
+// stlib
+#include <algorithm>
+
+namespace {
+	// Twice the signed area of (a, b, c), positive if counter-clockwise in pixel space
+	float orient(vec2 a, vec2 b, vec2 c) {
+		return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+	}
+
+	// Pixels exactly on an edge belong to one of the two triangles sharing it,
+	// like in GL, so blended sprites do not get a seam along their diagonal
+	bool owns_edge(vec2 a, vec2 b) {
+		vec2 d = b - a;
+		return d.y > 0.f || (d.y == 0.f && d.x < 0.f);
+	}
+
+	float saturate(float x) {
+		return std::min(std::max(x, 0.f), 1.f);
+	}
+}
+
+SoftwareRenderBackend::SoftwareRenderBackend(const RenderAssets& assets_arg, ivec2 framebuffer_size, unsigned threads)
+	: assets(assets_arg), pool(threads), size(framebuffer_size)
+{
+	assert(size.x > 0 && size.y > 0);
+	tiles = { (size.x + tile_size - 1) / tile_size, (size.y + tile_size - 1) / tile_size };
+	tile_triangles.resize((size_t)tiles.x * tiles.y);
+	scene.resize((size_t)size.x * size.y);
+	output.resize((size_t)size.x * size.y * 4);
+	printf("Software renderer, %dx%d pixels on %u threads\n", size.x, size.y, pool.get_thread_count());
+}
+
+void SoftwareRenderBackend::draw(const RenderQueue& queue, const std::vector<DrawItem>& items,
+	const mat3& projection, const FrameSnapshot& snapshot, RenderStats& stats)
+{
+	PROFILE_SCOPE("SoftwareRenderBackend::draw");
+	states.clear();
+	triangles.clear();
+	for (std::vector<uint32_t>& bin : tile_triangles)
+		bin.clear();
+
+	for (size_t i = 0; i < queue.size(); i++)
+		addItem(items[RenderQueue::item_of(queue[i])], projection);
+	stats.draw_calls += (uint)queue.size();
+
+	{
+		PROFILE_SCOPE("rasterize");
+		pool.parallel_for(tile_triangles.size(), [this](size_t tile) { rasterizeTile(tile); });
+	}
+
+	PROFILE_SCOPE("drawToScreen");
+	const size_t blocks = (size.y + rows_per_block - 1) / rows_per_block;
+	pool.parallel_for(blocks, [&](size_t block) { postProcessRows(block, snapshot); });
+}
+
+bool SoftwareRenderBackend::read_pixels(std::vector<unsigned char>& out_rgba, ivec2& out_size)
+{
+	out_rgba = output;
+	out_size = size;
+	return true;
+}
+
+// Runs the vertex stage of one draw and bins its triangles
+void SoftwareRenderBackend::addItem(const DrawItem& item, const mat3& projection)
+{
+	const RenderRequest& request = item.request;
+	assert(request.used_effect != EFFECT_ASSET_ID::EFFECT_COUNT);
+	assert(request.used_geometry != GEOMETRY_BUFFER_ID::GEOMETRY_COUNT);
+
+	DrawState state;
+	state.effect = request.used_effect;
+	state.page = nullptr;
+	state.color = item.color;
+	state.lit = item.lit;
+	vec4 uv_rect = { 0.f, 0.f, 1.f, 1.f };
+	if (request.used_effect == EFFECT_ASSET_ID::TEXTURED)
+	{
+		assert(request.used_texture != TEXTURE_ASSET_ID::TEXTURE_COUNT);
+		state.page = assets.atlas_pages[assets.texture_pages[(int)request.used_texture]];
+		uv_rect = assets.texture_uv_rects[(int)request.used_texture];
+	}
+	else
+	{
+		assert((request.used_effect == EFFECT_ASSET_ID::CAR ||
+			request.used_effect == EFFECT_ASSET_ID::WALL ||
+			request.used_effect == EFFECT_ASSET_ID::EGG) && "Type of render request not supported");
+	}
+	const uint32_t state_index = (uint32_t)states.size();
+	states.push_back(state);
+
+	const mat3 mvp = projection * item.transform.to_mat3();
+	auto to_pixels = [&](vec3 position) {
+		vec3 ndc = mvp * vec3(position.x, position.y, 1.f);
+		return vec2((ndc.x + 1.f) * 0.5f * size.x, (1.f - ndc.y) * 0.5f * size.y);
+	};
+
+	std::vector<Vertex>& vertices = item_vertices;
+	vertices.clear();
+	if (request.used_geometry == GEOMETRY_BUFFER_ID::SPRITE)
+	{
+		for (const TexturedVertex& tv : assets.sprite_vertices)
+		{
+			Vertex v;
+			v.position = to_pixels(tv.position);
+			v.texcoord = vec2(uv_rect.x, uv_rect.y) + tv.texcoord * vec2(uv_rect.z, uv_rect.w);
+			v.color = vec3(1.f);
+			v.local = vec2(tv.position.x, tv.position.y);
+			vertices.push_back(v);
+		}
+		addTriangles(assets.sprite_indices, state_index);
+	}
+	else
+	{
+		const Mesh& mesh = assets.meshes[(int)request.used_geometry];
+		for (const ColoredVertex& cv : mesh.vertices)
+		{
+			Vertex v;
+			v.position = to_pixels(cv.position);
+			v.texcoord = vec2(0.f);
+			v.color = cv.color;
+			v.local = vec2(cv.position.x, cv.position.y);
+			vertices.push_back(v);
+		}
+		if (mesh.wide_indices.empty())
+			addTriangles(mesh.vertex_indices, state_index);
+		else
+			addTriangles(mesh.wide_indices, state_index);
+	}
+}
+
+// Triangles of item_vertices
+template <class Index>
+void SoftwareRenderBackend::addTriangles(const std::vector<Index>& indices, uint32_t state)
+{
+	const std::vector<Vertex>& vertices = item_vertices;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		addTriangle(vertices[indices[i]], vertices[indices[i + 1]], vertices[indices[i + 2]], state);
+}
+
+void SoftwareRenderBackend::addTriangle(const Vertex& a, const Vertex& b, const Vertex& c, uint32_t state)
+{
+	// No face culling in GL either, so both windings are drawn
+	float area = orient(a.position, b.position, c.position);
+	if (area == 0.f || !std::isfinite(area))
+		return;
+
+	Triangle triangle;
+	triangle.v[0] = a;
+	triangle.v[1] = area > 0.f ? b : c;
+	triangle.v[2] = area > 0.f ? c : b;
+	triangle.inv_area = 1.f / fabsf(area);
+	triangle.state = state;
+
+	vec2 lo = min(min(a.position, b.position), c.position);
+	vec2 hi = max(max(a.position, b.position), c.position);
+	// pixels whose centre can be inside
+	triangle.min = { std::max(0, (int)floorf(lo.x - 0.5f)), std::max(0, (int)floorf(lo.y - 0.5f)) };
+	triangle.max = { std::min(size.x - 1, (int)ceilf(hi.x - 0.5f)), std::min(size.y - 1, (int)ceilf(hi.y - 0.5f)) };
+	if (triangle.min.x > triangle.max.x || triangle.min.y > triangle.max.y)
+		return;
+
+	const uint32_t index = (uint32_t)triangles.size();
+	triangles.push_back(triangle);
+	for (int ty = triangle.min.y / tile_size; ty <= triangle.max.y / tile_size; ty++)
+		for (int tx = triangle.min.x / tile_size; tx <= triangle.max.x / tile_size; tx++)
+			tile_triangles[ty * tiles.x + tx].push_back(index);
+}
+
+void SoftwareRenderBackend::rasterizeTile(size_t tile)
+{
+	const ivec2 tile_min = { (int)(tile % tiles.x) * tile_size, (int)(tile / tiles.x) * tile_size };
+	const ivec2 tile_max = { std::min(tile_min.x + tile_size, size.x) - 1, std::min(tile_min.y + tile_size, size.y) - 1 };
+
+	// Same clear color as the GL backend. Its color is computed with integer
+	// division there, which leaves pure blue.
+	for (int y = tile_min.y; y <= tile_max.y; y++)
+		std::fill(scene.begin() + y * size.x + tile_min.x, scene.begin() + y * size.x + tile_max.x + 1, vec4(0.f, 0.f, 1.f, 1.f));
+
+	for (uint32_t index : tile_triangles[tile])
+	{
+		const Triangle& triangle = triangles[index];
+		const vec2 p0 = triangle.v[0].position;
+		const vec2 p1 = triangle.v[1].position;
+		const vec2 p2 = triangle.v[2].position;
+		const bool owns0 = owns_edge(p1, p2);
+		const bool owns1 = owns_edge(p2, p0);
+		const bool owns2 = owns_edge(p0, p1);
+
+		const int x0 = std::max(triangle.min.x, tile_min.x);
+		const int x1 = std::min(triangle.max.x, tile_max.x);
+		const int y0 = std::max(triangle.min.y, tile_min.y);
+		const int y1 = std::min(triangle.max.y, tile_max.y);
+		for (int y = y0; y <= y1; y++)
+		{
+			vec4* row = scene.data() + (size_t)y * size.x;
+			for (int x = x0; x <= x1; x++)
+			{
+				const vec2 p = { x + 0.5f, y + 0.5f };
+				const float w0 = orient(p1, p2, p);
+				const float w1 = orient(p2, p0, p);
+				const float w2 = orient(p0, p1, p);
+				if (w0 < 0.f || w1 < 0.f || w2 < 0.f)
+					continue;
+				if ((w0 == 0.f && !owns0) || (w1 == 0.f && !owns1) || (w2 == 0.f && !owns2))
+					continue;
+
+				const vec4 src = shade(triangle, vec3(w0, w1, w2) * triangle.inv_area);
+				// glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA), also on alpha
+				vec4& dst = row[x];
+				dst = src * src.w + dst * (1.f - src.w);
+			}
+		}
+	}
+}
+
+// The fragment shaders of the effects drawn by DrawItems
+vec4 SoftwareRenderBackend::shade(const Triangle& triangle, vec3 weights) const
+{
+	const DrawState& state = states[triangle.state];
+	const Vertex* v = triangle.v;
+	vec4 color;
+	if (state.effect == EFFECT_ASSET_ID::TEXTURED)
+	{
+		vec2 texcoord = v[0].texcoord * weights.x + v[1].texcoord * weights.y + v[2].texcoord * weights.z;
+		color = vec4(state.color, 1.f) * sampleAtlas(state.page, texcoord);
+	}
+	else
+	{
+		vec3 vcolor = v[0].color * weights.x + v[1].color * weights.y + v[2].color * weights.z;
+		color = vec4(state.color * vcolor, 1.f);
+		if (state.effect == EFFECT_ASSET_ID::CAR && state.lit)
+		{
+			vec2 local = v[0].local * weights.x + v[1].local * weights.y + v[2].local * weights.z;
+			float radius = length(local);
+			if (radius < 0.3f)
+				color += vec4((0.3f - radius) * 0.8f * vec3(1.f, 1.f, 0.f), 0.f);
+		}
+	}
+	// written to an RGBA8 target, so GL clamps too
+	return vec4(saturate(color.x), saturate(color.y), saturate(color.z), saturate(color.w));
+}
+
+// GL_LINEAR with GL_CLAMP_TO_EDGE, page row 0 is v = 0
+vec4 SoftwareRenderBackend::sampleAtlas(const unsigned char* page, vec2 texcoord) const
+{
+	const ivec2 page_size = assets.page_size;
+	float fx = texcoord.x * page_size.x - 0.5f;
+	float fy = texcoord.y * page_size.y - 0.5f;
+	int x0 = (int)floorf(fx);
+	int y0 = (int)floorf(fy);
+	float tx = fx - x0;
+	float ty = fy - y0;
+	int x1 = std::min(std::max(x0 + 1, 0), page_size.x - 1);
+	int y1 = std::min(std::max(y0 + 1, 0), page_size.y - 1);
+	x0 = std::min(std::max(x0, 0), page_size.x - 1);
+	y0 = std::min(std::max(y0, 0), page_size.y - 1);
+
+	auto texel = [&](int x, int y) {
+		const unsigned char* t = page + ((size_t)y * page_size.x + x) * 4;
+		return vec4(t[0], t[1], t[2], t[3]) * (1.f / 255.f);
+	};
+	vec4 top = texel(x0, y0) * (1.f - tx) + texel(x1, y0) * tx;
+	vec4 bottom = texel(x0, y1) * (1.f - tx) + texel(x1, y1) * tx;
+	return top * (1.f - ty) + bottom * ty;
+}
+
+// The scene texture as water.fs.glsl sees it: GL_LINEAR, default GL_REPEAT
+// wrapping, and v = 0 at the bottom of the screen
+vec4 SoftwareRenderBackend::sampleScene(vec2 texcoord) const
+{
+	float fx = texcoord.x * size.x - 0.5f;
+	float fy = (1.f - texcoord.y) * size.y - 0.5f;
+	int x0 = (int)floorf(fx);
+	int y0 = (int)floorf(fy);
+	float tx = fx - x0;
+	float ty = fy - y0;
+	auto wrap = [](int i, int n) { return ((i % n) + n) % n; };
+	int x1 = wrap(x0 + 1, size.x);
+	int y1 = wrap(y0 + 1, size.y);
+	x0 = wrap(x0, size.x);
+	y0 = wrap(y0, size.y);
+
+	const vec4* scene_data = scene.data();
+	vec4 top = scene_data[y0 * size.x + x0] * (1.f - tx) + scene_data[y0 * size.x + x1] * tx;
+	vec4 bottom = scene_data[y1 * size.x + x0] * (1.f - tx) + scene_data[y1 * size.x + x1] * tx;
+	return top * (1.f - ty) + bottom * ty;
+}
+
+// water.fs.glsl for a block of rows
+void SoftwareRenderBackend::postProcessRows(size_t block, const FrameSnapshot& snapshot)
+{
+	const float time = snapshot.time * 10.f;
+	const int y_end = std::min((int)(block + 1) * rows_per_block, size.y);
+	for (int y = (int)block * rows_per_block; y < y_end; y++)
+	{
+		unsigned char* row = output.data() + (size_t)y * size.x * 4;
+		for (int x = 0; x < size.x; x++)
+		{
+			vec2 uv = { (x + 0.5f) / size.x, 1.f - (y + 0.5f) / size.y };
+			if (snapshot.advanced)
+			{
+				uv.y += cosf(time + 10 * uv.x) * 0.0005f +
+						sinf(time + uv.x * 40) * 0.0005f +
+						cosf(time + uv.x * 100) * 0.0007f;
+			}
+			vec4 color = sampleScene(uv);
+			if (snapshot.advanced)
+				color -= vec4(0.1f, 0.05f, 0.f, 0.f);
+			if (snapshot.darken_screen_factor > 0)
+				color -= snapshot.darken_screen_factor * vec4(0.8f, 0.8f, 0.8f, 0.f);
+
+			row[x * 4 + 0] = (unsigned char)(saturate(color.x) * 255.f + 0.5f);
+			row[x * 4 + 1] = (unsigned char)(saturate(color.y) * 255.f + 0.5f);
+			row[x * 4 + 2] = (unsigned char)(saturate(color.z) * 255.f + 0.5f);
+			row[x * 4 + 3] = 255;
+		}
+	}
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vector>
+
+#include "common.hpp"
+#include "components.hpp"
+#include "render_assets.hpp"
+#include "render_backend.hpp"
+#include "worker_pool.hpp"
+
+// Draws on the CPU into an offscreen image, for CI and benchmarks on machines
+// without a GPU or display. It mirrors what the GL effects do closely enough
+// for frames to be compared by eye: coloured meshes, atlas sprites with
+// bilinear filtering and alpha blending, and the water post processing pass.
+//
+// Triangles are transformed and binned into screen tiles on the render thread,
+// then the tiles are rasterized in parallel. Each tile walks its triangles in
+// draw order, so blending matches the sorted queue exactly.
+class SoftwareRenderBackend : public RenderBackend
+{
+public:
+	// threads = 0 uses one thread per core
+	SoftwareRenderBackend(const RenderAssets& assets, ivec2 framebuffer_size, unsigned threads = 0);
+
+	void draw(const RenderQueue& queue, const std::vector<DrawItem>& items,
+		const mat3& projection, const FrameSnapshot& snapshot, RenderStats& stats) override;
+	bool read_pixels(std::vector<unsigned char>& out_rgba, ivec2& out_size) override;
+
+private:
+	// What the fragment shader of one draw needs
+	struct DrawState
+	{
+		EFFECT_ASSET_ID effect;
+		const unsigned char* page; // atlas page for TEXTURED, nullptr otherwise
+		vec3 color;
+		bool lit;
+	};
+
+	struct Vertex
+	{
+		vec2 position; // in pixels, y down
+		vec2 texcoord; // in the atlas page
+		vec3 color;
+		vec2 local; // mesh position before the transform, for the car glow
+	};
+
+	struct Triangle
+	{
+		Vertex v[3]; // counter-clockwise in pixel space
+		float inv_area;
+		ivec2 min, max; // pixel bounds, clamped to the screen
+		uint32_t state;
+	};
+
+	void addItem(const DrawItem& item, const mat3& projection);
+	void addTriangle(const Vertex& a, const Vertex& b, const Vertex& c, uint32_t state);
+	template <class Index>
+	void addTriangles(const std::vector<Index>& indices, uint32_t state);
+	void rasterizeTile(size_t tile);
+	vec4 shade(const Triangle& triangle, vec3 weights) const;
+	vec4 sampleAtlas(const unsigned char* page, vec2 texcoord) const;
+	void postProcessRows(size_t block, const FrameSnapshot& snapshot);
+	vec4 sampleScene(vec2 texcoord) const;
+
+	static const int tile_size = 64;
+	static const int rows_per_block = 16;
+
+	const RenderAssets& assets;
+	WorkerPool pool;
+	ivec2 size;
+	ivec2 tiles;
+
+	std::vector<vec4> scene; // colors before post processing, top row first
+	std::vector<unsigned char> output; // final RGBA8 frame, top row first
+
+	// Rebuilt every frame, the vectors keep their capacity
+	std::vector<DrawState> states;
+	std::vector<Triangle> triangles;
+	std::vector<Vertex> item_vertices;
+	std::vector<std::vector<uint32_t>> tile_triangles; // indices into triangles, in draw order
+};
@@ -0,0 +1,329 @@
+// internal
+#include "spatial_index.hpp"
+#include "convex_hull.hpp"
+#include "physics_system.hpp"
+#include "tiny_ecs_registry.hpp"
+
+// stlib
+#include <algorithm>
+
+namespace {
+	const ConvexHull& square_hull() {
+		static const ConvexHull square = unit_square_hull();
+		return square;
+	}
+
+	// Clips the ray against the half planes of the body's hull in the hull's local
+	// space. The map to local space is affine, so the ray parameter t is the same
+	// in both spaces and no renormalization is needed.
+	bool ray_body(const SpatialIndex::Body& body, vec2 o, vec2 d, float max_t, float& out_t, vec2& out_normal) {
+		const Motion& m = body.motion;
+		if (m.scale.x == 0.f || m.scale.y == 0.f)
+			return false; // nothing to hit, and the map to local space would divide by zero
+		const ConvexHull& hull = body.collider.hull != nullptr ? *body.collider.hull : square_hull();
+		float c = cosf(m.angle);
+		float s = sinf(m.angle);
+		vec2 ro = o - m.position;
+		vec2 lo = vec2(c * ro.x + s * ro.y, -s * ro.x + c * ro.y) / m.scale;
+		vec2 ld = vec2(c * d.x + s * d.y, -s * d.x + c * d.y) / m.scale;
+
+		float t_enter = 0.f, t_exit = max_t;
+		int enter_edge = -1;
+		for (size_t i = 0; i < hull.vertices.size(); i++) {
+			const vec2& n = hull.normals[i];
+			float denom = dot(n, ld);
+			float dist = dot(n, lo - hull.vertices[i]); // > 0 means outside this edge
+			if (denom == 0.f) {
+				if (dist > 0.f) return false;
+				continue;
+			}
+			float t = -dist / denom;
+			if (denom < 0.f) {
+				if (t > t_enter) { t_enter = t; enter_edge = (int)i; }
+			} else if (t < t_exit) {
+				t_exit = t;
+			}
+			if (t_enter > t_exit) return false;
+		}
+
+		out_t = t_enter;
+		if (enter_edge < 0) {
+			out_normal = -d; // started inside
+		} else {
+			vec2 n = hull.normals[enter_edge] / m.scale;
+			out_normal = vec2(c * n.x - s * n.y, s * n.x + c * n.y);
+		}
+		return true;
+	}
+}
+
+ivec2 SpatialIndex::cell_of(vec2 p) const {
+	int x = (int)floorf((p.x - grid_origin.x) / cell_size);
+	int y = (int)floorf((p.y - grid_origin.y) / cell_size);
+	return { std::min(std::max(x, 0), dims.x - 1), std::min(std::max(y, 0), dims.y - 1) };
+}
+
+void SpatialIndex::next_stamp() {
+	stamp++;
+	if (stamp == 0) {
+		// wrapped around, old stamps could now look current
+		std::fill(visit_stamp.begin(), visit_stamp.end(), 0);
+		stamp = 1;
+	}
+}
+
+void SpatialIndex::rebuild() {
+	auto& motion_container = registry.motions;
+	bool has_traffic = registry.trafficCars.size() > 0; // skips the lookup when there is none
+	bodies.clear();
+	vec2 lo = { INFINITY, INFINITY };
+	vec2 hi = { -INFINITY, -INFINITY };
+	for (uint i = 0; i < motion_container.size(); i++) {
+		Entity entity = motion_container.entities[i];
+		bodies.emplace_back(entity);
+		Body& body = bodies.back();
+		body.motion = motion_container.components[i];
+		if (registry.colliders.has(entity))
+			body.collider = registry.colliders.get(entity);
+		if (registry.players.has(entity)) body.mask = MASK_PLAYER;
+		else if (registry.deadlys.has(entity)) body.mask = MASK_DEADLY;
+		else if (registry.eatables.has(entity)) body.mask = MASK_EATABLE;
+		else body.mask = MASK_OTHER;
+		if (body.mask == MASK_DEADLY && has_traffic && registry.trafficCars.has(entity))
+			body.mask |= MASK_TRAFFIC;
+
+		// bounding box of the rotated rectangle
+		vec2 half = abs(body.motion.scale) / 2.f;
+		float c = fabsf(cosf(body.motion.angle));
+		float s = fabsf(sinf(body.motion.angle));
+		vec2 extent = { c * half.x + s * half.y, s * half.x + c * half.y };
+		body.aabb_min = body.motion.position - extent;
+		body.aabb_max = body.motion.position + extent;
+		lo = min(lo, body.aabb_min);
+		hi = max(hi, body.aabb_max);
+	}
+	visit_stamp.assign(bodies.size(), 0);
+	stamp = 0;
+
+	if (bodies.empty()) {
+		dims = { 0, 0 };
+		return;
+	}
+
+	// Pick the cell size, growing it if the entities are spread out too far
+	grid_origin = lo;
+	vec2 extent = hi - lo;
+	cell_size = min_cell_size;
+	while (ceilf(extent.x / cell_size) * ceilf(extent.y / cell_size) > max_cells)
+		cell_size *= 2.f;
+	dims = { std::max(1, (int)ceilf(extent.x / cell_size)), std::max(1, (int)ceilf(extent.y / cell_size)) };
+
+	// Counting sort of the bodies into the cells they overlap
+	size_t num_cells = (size_t)dims.x * dims.y;
+	cell_start.assign(num_cells + 1, 0);
+	for (const Body& body : bodies) {
+		ivec2 a = cell_of(body.aabb_min);
+		ivec2 b = cell_of(body.aabb_max);
+		for (int y = a.y; y <= b.y; y++)
+			for (int x = a.x; x <= b.x; x++)
+				cell_start[y * dims.x + x + 1]++;
+	}
+	for (size_t c = 0; c < num_cells; c++)
+		cell_start[c + 1] += cell_start[c];
+	cell_items.resize(cell_start[num_cells]);
+	cell_fill.assign(cell_start.begin(), cell_start.end() - 1);
+	for (uint32_t i = 0; i < bodies.size(); i++) {
+		ivec2 a = cell_of(bodies[i].aabb_min);
+		ivec2 b = cell_of(bodies[i].aabb_max);
+		for (int y = a.y; y <= b.y; y++)
+			for (int x = a.x; x <= b.x; x++)
+				cell_items[cell_fill[y * dims.x + x]++] = i;
+	}
+}
+
+SpatialIndex::RayHit SpatialIndex::raycast(vec2 origin, vec2 dir, float max_dist, uint32_t mask) {
+	RayHit result;
+	float len = length(dir);
+	if (bodies.empty() || len == 0.f)
+		return result;
+	vec2 d = dir / len;
+
+	// Clip the ray to the grid bounds
+	vec2 grid_max = grid_origin + vec2((float)dims.x, (float)dims.y) * cell_size;
+	float t_begin = 0.f, t_end = max_dist;
+	for (int axis = 0; axis < 2; axis++) {
+		if (fabsf(d[axis]) < 1e-8f) {
+			if (origin[axis] < grid_origin[axis] || origin[axis] > grid_max[axis])
+				return result;
+			continue;
+		}
+		float t0 = (grid_origin[axis] - origin[axis]) / d[axis];
+		float t1 = (grid_max[axis] - origin[axis]) / d[axis];
+		t_begin = max(t_begin, min(t0, t1));
+		t_end = min(t_end, max(t0, t1));
+	}
+	if (t_begin > t_end)
+		return result;
+
+	// Walk the cells along the ray (Amanatides & Woo)
+	ivec2 cell = cell_of(origin + d * t_begin);
+	ivec2 step = { d.x > 0 ? 1 : -1, d.y > 0 ? 1 : -1 };
+	vec2 t_max, t_delta;
+	for (int axis = 0; axis < 2; axis++) {
+		if (d[axis] == 0.f) {
+			t_max[axis] = INFINITY;
+			t_delta[axis] = INFINITY;
+			continue;
+		}
+		int c = axis == 0 ? cell.x : cell.y;
+		float boundary = grid_origin[axis] + (d[axis] > 0 ? c + 1 : c) * cell_size;
+		t_max[axis] = (boundary - origin[axis]) / d[axis];
+		t_delta[axis] = cell_size / fabsf(d[axis]);
+	}
+
+	next_stamp();
+	float best = max_dist;
+	while (true) {
+		int c = cell.y * dims.x + cell.x;
+		for (uint32_t k = cell_start[c]; k < cell_start[c + 1]; k++) {
+			uint32_t i = cell_items[k];
+			if ((bodies[i].mask & mask) == 0 || visit_stamp[i] == stamp)
+				continue;
+			visit_stamp[i] = stamp;
+			float t;
+			vec2 normal;
+			if (ray_body(bodies[i], origin, d, best, t, normal)) {
+				best = t;
+				result.body = &bodies[i];
+				result.distance = t;
+				result.point = origin + d * t;
+				result.normal = normal;
+			}
+		}
+
+		// nothing further along can be closer than what we have
+		float t_next = min(t_max.x, t_max.y);
+		if (t_next > best || t_next > t_end)
+			break;
+		if (t_max.x < t_max.y) {
+			cell.x += step.x;
+			t_max.x += t_delta.x;
+		} else {
+			cell.y += step.y;
+			t_max.y += t_delta.y;
+		}
+		if (cell.x < 0 || cell.y < 0 || cell.x >= dims.x || cell.y >= dims.y)
+			break;
+	}
+	return result;
+}
+
+size_t SpatialIndex::overlap_obb(vec2 center, vec2 size, float angle, uint32_t mask, std::vector<Entity>& out) {
+	out.clear();
+	if (bodies.empty())
+		return 0;
+
+	Motion query;
+	query.position = center;
+	query.scale = size;
+	query.angle = angle;
+	vec2 half = abs(size) / 2.f;
+	float c = fabsf(cosf(angle));
+	float s = fabsf(sinf(angle));
+	vec2 extent = { c * half.x + s * half.y, s * half.x + c * half.y };
+	vec2 lo = center - extent;
+	vec2 hi = center + extent;
+
+	next_stamp();
+	ivec2 a = cell_of(lo);
+	ivec2 b = cell_of(hi);
+	for (int y = a.y; y <= b.y; y++)
+		for (int x = a.x; x <= b.x; x++) {
+			int cell = y * dims.x + x;
+			for (uint32_t k = cell_start[cell]; k < cell_start[cell + 1]; k++) {
+				uint32_t i = cell_items[k];
+				const Body& body = bodies[i];
+				if ((body.mask & mask) == 0 || visit_stamp[i] == stamp)
+					continue;
+				visit_stamp[i] = stamp;
+				if (body.aabb_min.x > hi.x || body.aabb_max.x < lo.x ||
+					body.aabb_min.y > hi.y || body.aabb_max.y < lo.y)
+					continue;
+				const Collider* collider = body.collider.hull != nullptr ? &body.collider : nullptr;
+				if (collides(query, nullptr, body.motion, collider))
+					out.push_back(body.entity);
+			}
+		}
+	return out.size();
+}
+
+size_t SpatialIndex::overlap_aabb(vec2 lo, vec2 hi, uint32_t mask, std::vector<const Body*>& out) {
+	out.clear();
+	if (bodies.empty())
+		return 0;
+
+	next_stamp();
+	ivec2 a = cell_of(lo);
+	ivec2 b = cell_of(hi);
+	for (int y = a.y; y <= b.y; y++)
+		for (int x = a.x; x <= b.x; x++) {
+			int cell = y * dims.x + x;
+			for (uint32_t k = cell_start[cell]; k < cell_start[cell + 1]; k++) {
+				uint32_t i = cell_items[k];
+				const Body& body = bodies[i];
+				if ((body.mask & mask) == 0 || visit_stamp[i] == stamp)
+					continue;
+				visit_stamp[i] = stamp;
+				if (body.aabb_min.x > hi.x || body.aabb_max.x < lo.x ||
+					body.aabb_min.y > hi.y || body.aabb_max.y < lo.y)
+					continue;
+				out.push_back(&body);
+			}
+		}
+	return out.size();
+}
+
+size_t SpatialIndex::nearest_k(vec2 point, uint32_t mask, size_t k, std::vector<Entity>& out) {
+	out.clear();
+	if (bodies.empty() || k == 0)
+		return 0;
+
+	// sorted (distance squared, body) of the best candidates so far
+	nearest.clear();
+	next_stamp();
+	ivec2 center = cell_of(point);
+	int max_ring = std::max(std::max(center.x, dims.x - 1 - center.x), std::max(center.y, dims.y - 1 - center.y));
+	for (int ring = 0; ring <= max_ring; ring++) {
+		for (int y = center.y - ring; y <= center.y + ring; y++) {
+			if (y < 0 || y >= dims.y) continue;
+			// only the border of the ring, the inside was visited already
+			int x_step = (y == center.y - ring || y == center.y + ring) ? 1 : std::max(1, 2 * ring);
+			for (int x = center.x - ring; x <= center.x + ring; x += x_step) {
+				if (x < 0 || x >= dims.x) continue;
+				int cell = y * dims.x + x;
+				for (uint32_t j = cell_start[cell]; j < cell_start[cell + 1]; j++) {
+					uint32_t i = cell_items[j];
+					if ((bodies[i].mask & mask) == 0 || visit_stamp[i] == stamp)
+						continue;
+					visit_stamp[i] = stamp;
+					vec2 dp = bodies[i].motion.position - point;
+					float dist2 = dot(dp, dp);
+					if (nearest.size() == k && dist2 >= nearest.back().first)
+						continue;
+					if (nearest.size() == k)
+						nearest.pop_back();
+					auto pos = std::upper_bound(nearest.begin(), nearest.end(), std::make_pair(dist2, i));
+					nearest.insert(pos, std::make_pair(dist2, i));
+				}
+			}
+		}
+		// Any body whose centre is farther out lies in a later ring, at least ring * cell_size away
+		float reach = ring * cell_size;
+		if (nearest.size() == k && nearest.back().first <= reach * reach)
+			break;
+	}
+
+	for (const auto& candidate : nearest)
+		out.push_back(bodies[candidate.second].entity);
+	return out.size();
+}
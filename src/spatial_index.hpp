@@ -0,0 +1,124 @@
+#pragma once
+
+#include "common.hpp"
+#include "tiny_ecs.hpp"
+#include "components.hpp"
+
+// Categories used to filter spatial queries, derived from the components of each entity
+const uint32_t MASK_PLAYER = 1u << 0;
+const uint32_t MASK_DEADLY = 1u << 1;
+const uint32_t MASK_EATABLE = 1u << 2;
+const uint32_t MASK_OTHER = 1u << 3; // anything else with a Motion (title, eggs, ...)
+const uint32_t MASK_TRAFFIC = 1u << 4; // set along with MASK_DEADLY for cars the AISystem drives
+const uint32_t MASK_ALL = 0xffffffffu;
+
+// Uniform grid over all moving entities. It is rebuilt once per PhysicsSystem::step,
+// so query results reflect the world as of the last physics step. All storage is
+// reused between rebuilds and queries write into caller provided arrays, so once
+// the buffers have grown to fit the scene nothing here allocates.
+// raycast and overlap_aabb hand out Body pointers into the index, overlap_obb and
+// nearest_k copy out the Entity. Copying an Entity keeps its id, only Entity() reserves one.
+class SpatialIndex
+{
+public:
+	// Snapshot of one entity as the index sees it
+	// Note, Entity() reserves a new id, so bodies are always built from an existing one
+	struct Body
+	{
+		Entity entity;
+		uint32_t mask = 0;
+		Motion motion;
+		Collider collider; // hull is nullptr if the entity has no Collider
+		vec2 aabb_min, aabb_max;
+		Body(Entity e) : entity(e) {}
+	};
+
+	// Result of a raycast, body is only valid until the next rebuild
+	struct RayHit
+	{
+		const Body* body = nullptr;
+		float distance = INFINITY;
+		vec2 point = { 0.f, 0.f };
+		vec2 normal = { 0.f, 0.f }; // not normalized
+	};
+
+	// Re-reads every entity with a Motion from the registry and re-bins it
+	void rebuild();
+
+	// Closest hit along origin + t * dir for t in [0, max_dist], dir does not need to be normalized
+	RayHit raycast(vec2 origin, vec2 dir, float max_dist, uint32_t mask);
+
+	// Fills out with the entities overlapping the given oriented box (size as in Motion::scale).
+	// out is cleared first, pass the same vector every frame to reuse its memory.
+	size_t overlap_obb(vec2 center, vec2 size, float angle, uint32_t mask, std::vector<Entity>& out);
+
+	// Fills out with the bodies whose bounding boxes overlap the box lo..hi. Cheaper than
+	// overlap_obb, for callers that want the bodies as seen by the index and can live with
+	// bounding boxes. The pointers are only valid until the next rebuild.
+	size_t overlap_aabb(vec2 lo, vec2 hi, uint32_t mask, std::vector<const Body*>& out);
+
+	// Fills out with up to k entities closest to point by centre distance, nearest first
+	size_t nearest_k(vec2 point, uint32_t mask, size_t k, std::vector<Entity>& out);
+
+	// Calls callback(body_a, body_b) once for every pair whose bounding boxes overlap
+	template <class Callback>
+	void for_each_candidate_pair(Callback callback);
+
+	const std::vector<Body>& get_bodies() const { return bodies; }
+	vec2 get_origin() const { return grid_origin; }
+	ivec2 get_dimensions() const { return dims; }
+	float get_cell_size() const { return cell_size; }
+	// Number of bodies binned into cell (x, y)
+	uint32_t get_cell_count(int x, int y) const {
+		int cell = y * dims.x + x;
+		return cell_start[cell + 1] - cell_start[cell];
+	}
+
+private:
+	ivec2 cell_of(vec2 p) const; // clamped to the grid
+	void next_stamp(); // marks all bodies as not visited by the current query
+
+	const float min_cell_size = 64.f;
+	const int max_cells = 64 * 64;
+
+	std::vector<Body> bodies;
+	std::vector<uint32_t> cell_start; // cell c holds cell_items[cell_start[c] .. cell_start[c+1])
+	std::vector<uint32_t> cell_fill;
+	std::vector<uint32_t> cell_items; // indices into bodies
+	std::vector<uint32_t> visit_stamp; // per body, avoids testing a body twice when it spans cells
+	uint32_t stamp = 0;
+	std::vector<std::pair<float, uint32_t>> nearest; // scratch for nearest_k
+
+	vec2 grid_origin = { 0.f, 0.f };
+	ivec2 dims = { 0, 0 };
+	float cell_size = min_cell_size;
+};
+
+template <class Callback>
+void SpatialIndex::for_each_candidate_pair(Callback callback)
+{
+	for (uint32_t i = 0; i < bodies.size(); i++)
+	{
+		next_stamp();
+		const Body& a = bodies[i];
+		ivec2 lo = cell_of(a.aabb_min);
+		ivec2 hi = cell_of(a.aabb_max);
+		for (int y = lo.y; y <= hi.y; y++)
+			for (int x = lo.x; x <= hi.x; x++)
+			{
+				int cell = y * dims.x + x;
+				for (uint32_t k = cell_start[cell]; k < cell_start[cell + 1]; k++)
+				{
+					uint32_t j = cell_items[k];
+					// only report (i, j) once, from the body with the smaller index
+					if (j <= i || visit_stamp[j] == stamp)
+						continue;
+					visit_stamp[j] = stamp;
+					const Body& b = bodies[j];
+					if (a.aabb_min.x <= b.aabb_max.x && b.aabb_min.x <= a.aabb_max.x &&
+						a.aabb_min.y <= b.aabb_max.y && b.aabb_min.y <= a.aabb_max.y)
+						callback(a, b);
+				}
+			}
+	}
+}
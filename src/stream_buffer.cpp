@@ -0,0 +1,125 @@
+// internal
+#include "stream_buffer.hpp"
+
+// stlib
+#include <algorithm>
+#include <cstring>
+
+namespace {
+	bool has_buffer_storage() {
+		if (gl3w_is_supported(4, 4))
+			return true;
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+		for (GLint i = 0; i < count; i++) {
+			const char* name = (const char*)glGetStringi(GL_EXTENSIONS, i);
+			if (name != nullptr && strcmp(name, "GL_ARB_buffer_storage") == 0)
+				return true;
+		}
+		return false;
+	}
+}
+
+void StreamBuffer::init(size_t bytes_per_frame) {
+	capacity = bytes_per_frame;
+	persistent = has_buffer_storage();
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	if (persistent) {
+		// Coherent, so writes need no explicit flush before the draw
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_ARRAY_BUFFER, capacity * frame_count, nullptr, flags);
+		mapped = (unsigned char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, capacity * frame_count, flags);
+		assert(mapped != nullptr);
+	} else {
+		glBufferData(GL_ARRAY_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+		staging.resize(capacity);
+	}
+	gl_has_errors();
+
+	region = 0;
+	head = 0;
+	flushed = 0;
+}
+
+void StreamBuffer::destroy() {
+	for (int i = 0; i < frame_count; i++)
+		wait_for(i);
+	if (persistent && mapped != nullptr) {
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+	}
+	glDeleteBuffers(1, &buffer);
+	buffer = 0;
+	mapped = nullptr;
+	staging.clear();
+}
+
+void StreamBuffer::reserve(size_t bytes_per_frame) {
+	if (bytes_per_frame <= capacity)
+		return;
+	// Grow geometrically so a slowly growing scene does not reallocate every frame
+	size_t new_capacity = std::max(bytes_per_frame, capacity * 2);
+	destroy();
+	init(new_capacity);
+}
+
+void StreamBuffer::wait_for(int region_index) {
+	GLsync& fence = fences[region_index];
+	if (fence == nullptr)
+		return;
+	// Three frames of latency are usually long gone, so this returns immediately
+	GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	while (result == GL_TIMEOUT_EXPIRED)
+		result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); // 1ms
+	assert(result != GL_WAIT_FAILED);
+	glDeleteSync(fence);
+	fence = nullptr;
+}
+
+void StreamBuffer::begin_frame() {
+	region = (region + 1) % frame_count;
+	head = 0;
+	flushed = 0;
+	if (persistent) {
+		wait_for(region);
+	} else {
+		// Orphan, the driver hands us fresh storage while the GPU still reads the old one
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glBufferData(GL_ARRAY_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+		gl_has_errors();
+	}
+}
+
+StreamBuffer::Allocation StreamBuffer::allocate(size_t size, size_t alignment) {
+	Allocation allocation;
+	size_t start = (head + alignment - 1) / alignment * alignment;
+	if (start + size > capacity)
+		return allocation;
+	head = start + size;
+	if (persistent) {
+		allocation.offset = region * capacity + start;
+		allocation.data = mapped + allocation.offset;
+	} else {
+		allocation.offset = start;
+		allocation.data = staging.data() + start;
+	}
+	return allocation;
+}
+
+void StreamBuffer::flush() {
+	if (persistent || flushed == head)
+		return;
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferSubData(GL_ARRAY_BUFFER, flushed, head - flushed, staging.data() + flushed);
+	gl_has_errors();
+	flushed = head;
+}
+
+void StreamBuffer::end_frame() {
+	if (!persistent)
+		return; // the orphaned storage is tracked by the driver
+	assert(fences[region] == nullptr);
+	fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
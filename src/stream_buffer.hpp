@@ -0,0 +1,60 @@
+#pragma once
+
+#include "common.hpp"
+
+// stlib
+#include <array>
+
+// GL buffer for data the CPU rewrites every frame (sprite instances, debug lines,
+// particles, ...). It is split into frame_count regions used round robin, and a
+// fence after each frame's draws tells when the GPU is done with a region, so
+// the CPU normally never waits for the GPU.
+//
+// With ARB_buffer_storage (GL 4.4) the whole buffer is mapped once, persistently,
+// and allocations point straight into GPU visible memory. Without it (e.g. macOS)
+// allocations go to a CPU side copy that flush() uploads into an orphaned buffer.
+//
+// Per frame: begin_frame(), allocate() and write, flush(), draw, end_frame().
+class StreamBuffer
+{
+public:
+	static const int frame_count = 3;
+
+	struct Allocation
+	{
+		void* data = nullptr; // nullptr if the frame's region is full
+		size_t offset = 0; // byte offset in get_buffer(), for glVertexAttribPointer and co
+	};
+
+	void init(size_t bytes_per_frame);
+	void destroy();
+
+	// Grows the regions to at least bytes_per_frame, waiting for the GPU to finish
+	// with the old buffer. Only call it outside of begin_frame() ... end_frame().
+	void reserve(size_t bytes_per_frame);
+
+	void begin_frame();
+	Allocation allocate(size_t size, size_t alignment = 16);
+	// Makes everything allocated so far visible to the GPU
+	void flush();
+	void end_frame();
+
+	GLuint get_buffer() const { return buffer; }
+	size_t get_capacity() const { return capacity; }
+	bool is_persistent() const { return persistent; }
+
+private:
+	void wait_for(int region_index);
+
+	GLuint buffer = 0;
+	size_t capacity = 0; // bytes per region
+	bool persistent = false;
+
+	unsigned char* mapped = nullptr; // whole buffer, persistent path only
+	std::vector<unsigned char> staging; // one region, orphaning path only
+
+	std::array<GLsync, frame_count> fences = {};
+	int region = 0;
+	size_t head = 0; // bump pointer within the region
+	size_t flushed = 0; // staging bytes already uploaded this frame
+};
@@ -0,0 +1,291 @@
+// internal
+#include "stress_test.hpp"
+#include "ai_system.hpp"
+#include "audio_backend.hpp"
+#include "physics_system.hpp"
+#include "prefab.hpp"
+#include "profiler.hpp"
+#include "render_assets.hpp"
+#include "state_system.h"
+#include "tiny_ecs_registry.hpp"
+#include "world_init.hpp"
+#include "world_system.hpp"
+
+// stlib
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+
+#if defined(_WIN32)
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+	// Most memory the process has held so far, in bytes
+	size_t peak_memory() {
+#if defined(_WIN32)
+		PROCESS_MEMORY_COUNTERS counters;
+		if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+			return 0;
+		return counters.PeakWorkingSetSize;
+#else
+		struct rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) != 0)
+			return 0;
+#if defined(__APPLE__)
+		return (size_t)usage.ru_maxrss; // bytes on macOS
+#else
+		return (size_t)usage.ru_maxrss * 1024; // kilobytes on Linux
+#endif
+#endif
+	}
+
+	// Mean and worst of something measured every step
+	struct Series
+	{
+		double sum = 0.;
+		double max = 0.;
+		void add(double value) {
+			sum += value;
+			max = std::max(max, value);
+		}
+	};
+
+	void print_series(const char* name, const Series& series, unsigned steps) {
+		printf("  %-14s %10.3f %10.3f\n", name, series.sum / std::max(1u, steps), series.max);
+	}
+
+	std::string trim(const std::string& s) {
+		size_t first = s.find_first_not_of(" \t\r");
+		if (first == std::string::npos)
+			return "";
+		size_t last = s.find_last_not_of(" \t\r");
+		return s.substr(first, last - first + 1);
+	}
+
+	// The area the entities live in. Whatever leaves it comes back in on the
+	// other side, so the density holds.
+	struct Field
+	{
+		vec2 size;
+		std::default_random_engine rng;
+		std::uniform_real_distribution<float> uniform_dist; // number between 0..1
+		std::vector<vec2> positions;
+		std::vector<float> angles;
+		std::vector<Entity> spawned;
+	};
+
+	void spawn(const Prefab& prefab, float base_angle, unsigned count, const StressConfig& config, Field& field) {
+		field.positions.resize(count);
+		field.angles.resize(count);
+		for (unsigned i = 0; i < count; i++) {
+			field.positions[i] = vec2(field.uniform_dist(field.rng) * field.size.x, field.uniform_dist(field.rng) * field.size.y);
+			field.angles[i] = base_angle + (field.uniform_dist(field.rng) * 2.f - 1.f) * config.rotation;
+		}
+		field.spawned.clear();
+		instantiate_batch(prefab, field.positions.data(), field.angles.data(), count, &field.spawned);
+
+		for (Entity entity : field.spawned) {
+			float direction = field.uniform_dist(field.rng) * 2.f * (float)M_PI;
+			float speed = field.uniform_dist(field.rng) * config.speed_spread;
+			Motion& motion = registry.motions.get(entity);
+			motion.velocity.x += cosf(direction) * speed;
+			motion.velocity.y += sinf(direction) * speed;
+		}
+	}
+}
+
+bool StressConfig::set(const std::string& name, const std::string& value)
+{
+	if (name == "barriers") return parse_unsigned(value, barriers);
+	if (name == "bonuses") return parse_unsigned(value, bonuses);
+	if (name == "bodies") return parse_unsigned(value, bodies);
+	if (name == "traffic") return parse_unsigned(value, traffic);
+	if (name == "ai_budget_ms") return parse_float(value, ai_budget_ms) && ai_budget_ms >= 0.f;
+	if (name == "density") return parse_float(value, density) && density > 0.f;
+	if (name == "speed_spread") return parse_float(value, speed_spread);
+	if (name == "rotation") return parse_float(value, rotation);
+	if (name == "steps") return parse_unsigned(value, steps);
+	if (name == "step_ms") return parse_float(value, step_ms) && step_ms > 0.f;
+	if (name == "seed") return parse_unsigned(value, seed);
+	return false;
+}
+
+bool StressConfig::load(const std::string& path)
+{
+	std::ifstream file(path);
+	if (!file.is_open()) {
+		fprintf(stderr, "Failed to open stress config %s\n", path.c_str());
+		return false;
+	}
+
+	std::string line;
+	for (int line_number = 1; std::getline(file, line); line_number++)
+	{
+		line = trim(line.substr(0, line.find('#')));
+		if (line.empty())
+			continue;
+		size_t equals = line.find('=');
+		if (equals == std::string::npos || !set(trim(line.substr(0, equals)), trim(line.substr(equals + 1)))) {
+			fprintf(stderr, "%s:%d: can't read setting '%s'\n", path.c_str(), line_number, line.c_str());
+			return false;
+		}
+	}
+	return true;
+}
+
+bool StressConfig::parse_args(int argc, char* argv[])
+{
+	// The config file first, so the other arguments override it
+	for (int i = 0; i + 1 < argc; i++)
+		if (strcmp(argv[i], "--config") == 0 && !load(argv[i + 1]))
+			return false;
+
+	for (int i = 0; i < argc; i++)
+	{
+		if (strncmp(argv[i], "--", 2) != 0 || i + 1 >= argc) {
+			fprintf(stderr, "Expected --setting value, got %s\n", argv[i]);
+			return false;
+		}
+		if (strcmp(argv[i], "--config") != 0 && !set(argv[i] + 2, argv[i + 1])) {
+			fprintf(stderr, "Unknown stress setting or bad value: %s %s\n", argv[i], argv[i + 1]);
+			return false;
+		}
+		i++;
+	}
+	return true;
+}
+
+int run_stress(const StressConfig& config)
+{
+	StateSystem state;
+	WorldSystem world;
+	PhysicsSystem physics;
+	AISystem ai;
+	RenderAssets assets;
+	NullAudioBackend audio;
+
+	if (!assets.load())
+		return EXIT_FAILURE;
+	world.set_seed(config.seed);
+	world.init(&assets, &physics, &audio);
+	ai.init(&physics);
+	ai.set_budget_ms(config.ai_budget_ms);
+	state.init();
+
+	// Park the player outside the field, a crash would start the death timer
+	Entity player = registry.players.entities[0];
+	Motion& player_motion = registry.motions.get(player);
+	player_motion.position = { -2.f * CAR_HEIGHT, -2.f * CAR_HEIGHT };
+	player_motion.velocity = { 0.f, 0.f };
+
+	// As many window sized areas as the density asks for, in the window's aspect
+	unsigned total = config.barriers + config.bonuses + config.bodies + config.traffic;
+	float screens = std::max(1.f, total / config.density);
+	Field field;
+	field.size = vec2(window_width_px * sqrtf(screens), window_height_px * sqrtf(screens));
+	field.rng.seed(config.seed);
+
+	Prefab barrier_prefab = createBarrierPrefab(&assets);
+	Prefab bonus_prefab = createBonusPrefab(&assets);
+	Prefab body_prefab = createBodyPrefab(&assets);
+	Prefab traffic_prefab = createTrafficPrefab(&assets);
+
+	size_t memory_before = peak_memory();
+	auto spawn_start = Clock::now();
+	spawn(barrier_prefab, BARRIER_ANGLE, config.barriers, config, field);
+	spawn(bonus_prefab, 0.f, config.bonuses, config, field);
+	spawn(body_prefab, (float)M_PI, config.bodies, config, field);
+	// Traffic on a road as wide as the field
+	int lanes = std::max(1, (int)(field.size.y / LANE_WIDTH));
+	ai.set_lanes(lanes, LANE_WIDTH);
+	registry.trafficCars.reserve(config.traffic);
+	for (unsigned i = 0; i < config.traffic; i++) {
+		int lane = std::min((int)(field.uniform_dist(field.rng) * lanes), lanes - 1);
+		vec2 position = vec2(field.uniform_dist(field.rng) * field.size.x, ai.lane_center(lane));
+		createTrafficCar(traffic_prefab, position, lane, 150.f + field.uniform_dist(field.rng) * 150.f);
+	}
+	float spawn_ms = profiler::milliseconds(Clock::now() - spawn_start);
+
+	Series upkeep, ai_decide, ai_steer, integration, broadphase, narrowphase, collisions, step_total;
+	Series candidate_pairs, colliding_pairs, decisions;
+	size_t respawned = 0;
+	auto run_start = Clock::now();
+	for (unsigned step = 0; step < config.steps; step++)
+	{
+		auto start = Clock::now();
+		// Wrap around the field, and put back the bonuses that were eaten
+		auto& motions = registry.motions;
+		for (uint i = 0; i < motions.size(); i++) {
+			if (motions.entities[i] == player)
+				continue;
+			vec2& position = motions.components[i].position;
+			if (position.x < 0.f) position.x += field.size.x;
+			else if (position.x >= field.size.x) position.x -= field.size.x;
+			if (position.y < 0.f) position.y += field.size.y;
+			else if (position.y >= field.size.y) position.y -= field.size.y;
+		}
+		if (registry.eatables.size() < config.bonuses) {
+			unsigned missing = config.bonuses - (unsigned)registry.eatables.size();
+			spawn(bonus_prefab, 0.f, missing, config, field);
+			respawned += missing;
+		}
+		auto ai_start = Clock::now();
+
+		ai.step(config.step_ms);
+		const AIStats& ai_stats = ai.get_stats();
+
+		physics.step(config.step_ms);
+		const PhysicsStats& stats = physics.get_stats();
+		auto collisions_start = Clock::now();
+
+		world.handle_collisions();
+		auto end = Clock::now();
+
+		upkeep.add(profiler::milliseconds(ai_start - start));
+		ai_decide.add(ai_stats.decide_ms);
+		ai_steer.add(ai_stats.steer_ms);
+		decisions.add(ai_stats.decisions);
+		integration.add(stats.integration_ms);
+		broadphase.add(stats.broadphase_ms);
+		narrowphase.add(stats.narrowphase_ms);
+		collisions.add(profiler::milliseconds(end - collisions_start));
+		step_total.add(profiler::milliseconds(end - start));
+		candidate_pairs.add(stats.candidate_pairs);
+		colliding_pairs.add(stats.colliding_pairs);
+	}
+	float run_ms = profiler::milliseconds(Clock::now() - run_start);
+	size_t memory_after = peak_memory();
+
+	printf("Stress: %u barriers, %u bonuses, %u bodies, %u traffic on %.0f x %.0f px (%.1f per window), %u steps of %.2f ms\n",
+		config.barriers, config.bonuses, config.bodies, config.traffic, field.size.x, field.size.y,
+		total / screens, config.steps, config.step_ms);
+	printf("Spawned in %.1f ms, %u bodies in physics\n", spawn_ms, physics.get_stats().bodies);
+	printf("  %-14s %10s %10s\n", "ms per step", "mean", "max");
+	print_series("upkeep", upkeep, config.steps);
+	print_series("ai decide", ai_decide, config.steps);
+	print_series("ai steer", ai_steer, config.steps);
+	print_series("integration", integration, config.steps);
+	print_series("broadphase", broadphase, config.steps);
+	print_series("narrowphase", narrowphase, config.steps);
+	print_series("collisions", collisions, config.steps);
+	print_series("total", step_total, config.steps);
+	printf("  %-14s %10s %10s\n", "pairs per step", "mean", "max");
+	print_series("candidate", candidate_pairs, config.steps);
+	print_series("colliding", colliding_pairs, config.steps);
+	printf("  %-14s %10s %10s\n", "ai per step", "mean", "max");
+	print_series("decisions", decisions, config.steps);
+	printf("%.0f steps/s, %zu bonuses eaten and put back\n",
+		run_ms > 0.f ? config.steps * 1000.f / run_ms : 0.f, respawned);
+	printf("Peak memory %.1f MB, %.1f MB before spawning\n",
+		memory_after / (1024. * 1024.), memory_before / (1024. * 1024.));
+	return EXIT_SUCCESS;
+}
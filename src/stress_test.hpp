@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+
+#include "common.hpp"
+
+// A world filled with far more barriers, bonuses, driverless cars and traffic than the
+// game ever spawns, to measure how the systems scale. Settings come from a
+// config file of "name = value" lines ('#' starts a comment) and from
+// --name value arguments, which override the file:
+//   main --stress --config stress.cfg --barriers 100000
+struct StressConfig
+{
+	unsigned barriers = 1000;
+	unsigned bonuses = 1000;
+	unsigned bodies = 1000; // moving cars nobody drives
+	unsigned traffic = 0; // cars the AISystem drives, in lanes across the field
+	float ai_budget_ms = 2.f; // see AISystem::set_budget_ms
+	// Entities per window sized area, the field grows with the count to keep it.
+	// The game has about a dozen.
+	float density = 12.f;
+	// Every entity gets a random velocity up to this fast on top of its own
+	// (barriers and bonuses scroll left like in the game), in pixels per second
+	float speed_spread = 200.f;
+	// Entities are turned by up to this many radians either way from how the
+	// game spawns them
+	float rotation = (float)M_PI;
+	unsigned steps = 1000;
+	float step_ms = 1000.f / 60.f;
+	unsigned seed = 1;
+
+	bool load(const std::string& path);
+	// Arguments after --stress
+	bool parse_args(int argc, char* argv[]);
+	// False if there is no such setting or the value doesn't fit it
+	bool set(const std::string& name, const std::string& value);
+};
+
+// Spawns the entities and runs the AI, physics and collision handling for
+// config.steps fixed steps on them, without window, audio or GL. The game
+// rules that spawn, remove and restart stay off so the counts hold steady,
+// only bonuses eaten by the collision handling are put back. Prints the time
+// each system took, the collision pairs and the peak memory. Returns the exit code.
+int run_stress(const StressConfig& config);
@@ -0,0 +1,135 @@
+// internal
+#include "texture_atlas.hpp"
+
+// stlib
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+SkylinePacker::SkylinePacker(ivec2 page_size) : page_size(page_size) {
+	skyline.push_back({ 0, 0, page_size.x });
+}
+
+int SkylinePacker::fit(size_t i, ivec2 size) const {
+	int x = skyline[i].x;
+	if (x + size.x > page_size.x)
+		return -1;
+	// the rectangle rests on the highest segment below it
+	int y = 0;
+	int width_left = size.x;
+	while (width_left > 0) {
+		y = std::max(y, skyline[i].y);
+		if (y + size.y > page_size.y)
+			return -1;
+		width_left -= skyline[i].width;
+		i++;
+	}
+	return y;
+}
+
+bool SkylinePacker::insert(ivec2 size, ivec2& out_position) {
+	int best = -1;
+	int best_top = INT_MAX;
+	int best_width = INT_MAX;
+	for (size_t i = 0; i < skyline.size(); i++) {
+		int y = fit(i, size);
+		if (y < 0)
+			continue;
+		// lowest top edge first, then the narrowest segment to keep wide ones free
+		int top = y + size.y;
+		if (top < best_top || (top == best_top && skyline[i].width < best_width)) {
+			best = (int)i;
+			best_top = top;
+			best_width = skyline[i].width;
+			out_position = { skyline[i].x, y };
+		}
+	}
+	if (best < 0)
+		return false;
+
+	// Raise the skyline over the new rectangle and cut back the segments it covers
+	skyline.insert(skyline.begin() + best, { out_position.x, best_top, size.x });
+	int right = out_position.x + size.x;
+	size_t i = best + 1;
+	while (i < skyline.size() && skyline[i].x < right) {
+		int overlap = right - skyline[i].x;
+		if (overlap >= skyline[i].width) {
+			skyline.erase(skyline.begin() + i);
+			continue;
+		}
+		skyline[i].x += overlap;
+		skyline[i].width -= overlap;
+		break;
+	}
+
+	// Merge neighbours at the same height
+	for (size_t j = 0; j + 1 < skyline.size();) {
+		if (skyline[j].y == skyline[j + 1].y) {
+			skyline[j].width += skyline[j + 1].width;
+			skyline.erase(skyline.begin() + j + 1);
+		} else {
+			j++;
+		}
+	}
+	return true;
+}
+
+std::vector<AtlasRect> pack_atlas(const std::vector<ivec2>& sizes, int padding, ivec2& page_size, int& out_page_count) {
+	std::vector<AtlasRect> rects(sizes.size());
+
+	// Make sure the largest image fits on an empty page
+	for (const ivec2& size : sizes) {
+		while (size.x + 2 * padding > page_size.x) page_size.x *= 2;
+		while (size.y + 2 * padding > page_size.y) page_size.y *= 2;
+	}
+
+	// Tall images first leaves a flatter skyline for the short ones
+	std::vector<size_t> order(sizes.size());
+	for (size_t i = 0; i < order.size(); i++)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&sizes](size_t a, size_t b) {
+		return sizes[a].y > sizes[b].y || (sizes[a].y == sizes[b].y && sizes[a].x > sizes[b].x);
+	});
+
+	std::vector<SkylinePacker> pages;
+	for (size_t i : order) {
+		ivec2 padded = sizes[i] + ivec2(2 * padding, 2 * padding);
+		ivec2 position;
+		size_t page = 0;
+		while (page < pages.size() && !pages[page].insert(padded, position))
+			page++;
+		if (page == pages.size()) {
+			pages.push_back(SkylinePacker(page_size));
+			bool fits = pages.back().insert(padded, position);
+			assert(fits);
+			(void)fits;
+		}
+		rects[i].page = (int)page;
+		rects[i].position = position + ivec2(padding, padding);
+		rects[i].size = sizes[i];
+	}
+	out_page_count = (int)pages.size();
+	return rects;
+}
+
+void blit_to_atlas(unsigned char* page, ivec2 page_size, const unsigned char* rgba, const AtlasRect& rect, int padding) {
+	for (int y = -padding; y < rect.size.y + padding; y++) {
+		int src_y = std::min(std::max(y, 0), rect.size.y - 1);
+		unsigned char* dst = page + ((size_t)(rect.position.y + y) * page_size.x + rect.position.x) * 4;
+		const unsigned char* src = rgba + (size_t)src_y * rect.size.x * 4;
+		// the row itself, then its first and last pixel repeated out to the sides
+		memcpy(dst, src, (size_t)rect.size.x * 4);
+		for (int x = 1; x <= padding; x++) {
+			memcpy(dst - x * 4, src, 4);
+			memcpy(dst + (rect.size.x - 1 + x) * 4, src + (rect.size.x - 1) * 4, 4);
+		}
+	}
+}
+
+vec4 atlas_uv_rect(const AtlasRect& rect, ivec2 page_size) {
+	return {
+		(float)rect.position.x / page_size.x,
+		(float)rect.position.y / page_size.y,
+		(float)rect.size.x / page_size.x,
+		(float)rect.size.y / page_size.y };
+}
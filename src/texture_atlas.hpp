@@ -0,0 +1,50 @@
+#pragma once
+
+#include "common.hpp"
+#include <glm/vec4.hpp> // vec4
+
+// Where one image ended up in the atlas, in pixels of its page. The rect covers
+// the image itself, its padding lies around it.
+struct AtlasRect
+{
+	int page = -1;
+	ivec2 position = { 0, 0 };
+	ivec2 size = { 0, 0 };
+};
+
+// Skyline bottom-left packer for a single page. The top edge of everything packed
+// so far is kept as a list of horizontal segments, and each rectangle goes where
+// its own top edge ends up lowest.
+class SkylinePacker
+{
+public:
+	SkylinePacker(ivec2 page_size);
+
+	// Finds room for a rectangle of the given size, false if the page is too full
+	bool insert(ivec2 size, ivec2& out_position);
+
+private:
+	struct Segment
+	{
+		int x, y, width;
+	};
+
+	// Lowest y a rectangle can sit at when its left edge is at segment i, -1 if it does not fit there
+	int fit(size_t i, ivec2 size) const;
+
+	ivec2 page_size;
+	std::vector<Segment> skyline;
+};
+
+// Packs images of the given sizes into as few pages as possible, tallest first.
+// Every image keeps padding free pixels on each side so linear filtering never
+// reaches into its neighbours. page_size is grown (to a power of two) if a single
+// image would not fit. Returns one rect per size, in the order of sizes.
+std::vector<AtlasRect> pack_atlas(const std::vector<ivec2>& sizes, int padding, ivec2& page_size, int& out_page_count);
+
+// Copies an RGBA image into its rect of an RGBA page and repeats the border
+// pixels out into the padding
+void blit_to_atlas(unsigned char* page, ivec2 page_size, const unsigned char* rgba, const AtlasRect& rect, int padding);
+
+// Offset (xy) and scale (zw) mapping the 0 ... 1 texcoords of the sprite quad onto the rect
+vec4 atlas_uv_rect(const AtlasRect& rect, ivec2 page_size);
@@ -1,6 +1,9 @@
 #pragma once
 
 #include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
 #include <vector>
 #include <unordered_map>
 #include <set>
@@ -17,11 +20,89 @@ public:
 	Entity()
 	{
 		id = id_count++;
-		// Note, indices of already deleted entities arent re-used in this simple implementation.
+		// Note, ids are only re-used through ECSRegistry::create_entity and recycle
 	}
+	// Refers to an id that exists already, does not reserve a new one
+	explicit Entity(unsigned int existing_id) : id(existing_id) {}
 	operator unsigned int() { return id; } // this enables automatic casting to int
 };
 
+// Blocks of one size for the nodes of the entity -> index maps. Freed blocks go
+// on a free list and are handed out again first, so once the maps have held as
+// many entries as they ever will, adding and removing components no longer
+// touches the heap. The blocks are never given back. Not thread safe, just like
+// the registry itself.
+template <size_t Size, size_t Align>
+class BlockPool
+{
+public:
+	static void* allocate() {
+		if (free_list != nullptr) {
+			void* block = free_list;
+			free_list = *(void**)block;
+			return block;
+		}
+		if (next == end) {
+			// operator new aligns for any fundamental type
+			next = (char*)::operator new(block_size * blocks_per_chunk);
+			end = next + block_size * blocks_per_chunk;
+		}
+		void* block = next;
+		next += block_size;
+		return block;
+	}
+	static void deallocate(void* block) {
+		*(void**)block = free_list;
+		free_list = block;
+	}
+
+private:
+	static_assert(Align <= alignof(std::max_align_t), "over-aligned blocks are not supported");
+	// Every block has to be able to hold the free list pointer
+	static constexpr size_t align = Align > alignof(void*) ? Align : alignof(void*);
+	static constexpr size_t block_size = ((Size > sizeof(void*) ? Size : sizeof(void*)) + align - 1) / align * align;
+	static constexpr size_t blocks_per_chunk = 256;
+
+	// Zero initialized before any constructor runs, so they outlive the registry
+	static void* free_list;
+	static char* next;
+	static char* end;
+};
+
+template <size_t Size, size_t Align> void* BlockPool<Size, Align>::free_list = nullptr;
+template <size_t Size, size_t Align> char* BlockPool<Size, Align>::next = nullptr;
+template <size_t Size, size_t Align> char* BlockPool<Size, Align>::end = nullptr;
+
+// Allocator taking single objects (the map nodes) from a BlockPool, arrays
+// (the bucket table) still come from the heap
+template <class T>
+struct NodePoolAllocator
+{
+	typedef T value_type;
+
+	NodePoolAllocator() = default;
+	template <class U>
+	NodePoolAllocator(const NodePoolAllocator<U>&) {}
+
+	T* allocate(size_t n) {
+		if (n == 1)
+			return (T*)BlockPool<sizeof(T), alignof(T)>::allocate();
+		return std::allocator<T>().allocate(n);
+	}
+	void deallocate(T* p, size_t n) {
+		if (n == 1)
+			BlockPool<sizeof(T), alignof(T)>::deallocate(p);
+		else
+			std::allocator<T>().deallocate(p, n);
+	}
+};
+
+// All pools of one type are the same pool
+template <class T, class U>
+bool operator==(const NodePoolAllocator<T>&, const NodePoolAllocator<U>&) { return true; }
+template <class T, class U>
+bool operator!=(const NodePoolAllocator<T>&, const NodePoolAllocator<U>&) { return false; }
+
 // Common interface to refer to all containers in the ECS registry
 struct ContainerInterface
 {
@@ -36,8 +117,9 @@ template <typename Component> // A component can be any class
 class ComponentContainer : public ContainerInterface
 {
 private:
-	// The hash map from Entity -> array index.
-	std::unordered_map<unsigned int, unsigned int> map_entity_componentID; // the entity is cast to uint to be hashable.
+	// The hash map from Entity -> array index, its nodes come from a pool
+	std::unordered_map<unsigned int, unsigned int, std::hash<unsigned int>, std::equal_to<unsigned int>,
+		NodePoolAllocator<std::pair<const unsigned int, unsigned int>>> map_entity_componentID; // the entity is cast to uint to be hashable.
 	bool registered = false;
 public:
 	// Container of all components of type 'Component'
@@ -120,6 +202,18 @@ public:
 		return components.size();
 	}
 
+	// Makes room for count components in total before inserting many at once.
+	// Grows geometrically like push_back does, so calling it per batch is cheap.
+	void reserve(size_t count)
+	{
+		if (count <= components.capacity())
+			return;
+		count = std::max(count, 2 * components.capacity());
+		components.reserve(count);
+		entities.reserve(count);
+		map_entity_componentID.reserve(count);
+	}
+
 	// Sort the components and associated entity assignment structures by the comparisonFunction, see std::sort
 	template <class Compare>
 	void sort(Compare comparisonFunction)
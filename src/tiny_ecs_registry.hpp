@@ -21,8 +21,9 @@ public:
 	ComponentContainer<ScreenState> screenStates;
 	ComponentContainer<Eatable> eatables;
 	ComponentContainer<Deadly> deadlys;
-	ComponentContainer<DebugComponent> debugComponents;
 	ComponentContainer<vec3> colors;
+	ComponentContainer<Collider> colliders;
+	ComponentContainer<TrafficCar> trafficCars;
 
 	// constructor that adds all containers for looping over them
 	// IMPORTANT: Don't forget to add any newly added containers!
@@ -38,8 +39,9 @@ public:
 		registry_list.push_back(&screenStates);
 		registry_list.push_back(&eatables);
 		registry_list.push_back(&deadlys);
-		registry_list.push_back(&debugComponents);
 		registry_list.push_back(&colors);
+		registry_list.push_back(&colliders);
+		registry_list.push_back(&trafficCars);
 	}
 
 	void clear_all_components() {
@@ -65,6 +67,34 @@ public:
 		for (ContainerInterface* reg : registry_list)
 			reg->remove(e);
 	}
+
+	// Entity with an id given back by recycle() if there is one, or a new id.
+	// Handles to a recycled entity refer to whatever reuses its id, so only
+	// recycle entities nothing else holds on to (barriers, bonuses, ...).
+	Entity create_entity() {
+		if (free_ids.empty())
+			return Entity();
+		Entity entity(free_ids.back());
+		free_ids.pop_back();
+		return entity;
+	}
+
+	// Removes all components of e and keeps its id for create_entity()
+	void recycle(Entity e) {
+		// An entity without components is gone already, handing its id out
+		// twice would make two entities share it
+		bool exists = false;
+		for (ContainerInterface* reg : registry_list)
+			if (reg->has(e)) {
+				reg->remove(e);
+				exists = true;
+			}
+		if (exists)
+			free_ids.push_back(e);
+	}
+
+private:
+	std::vector<unsigned int> free_ids;
 };
 
 extern ECSRegistry registry;
\ No newline at end of file
@@ -0,0 +1,131 @@
+// internal
+#include "transform_batch.hpp"
+
+// stlib
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRANSFORM_BATCH_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+	// Range reduction by multiples of pi/2, split in three parts so that the
+	// reduced angle stays exact for any angle far beyond a full turn (Cody-Waite)
+	const float two_over_pi = 0.636619772367581343f;
+	const float pi_over_2_a = 1.5703125f;
+	const float pi_over_2_b = 4.837512969970703125e-4f;
+	const float pi_over_2_c = 7.54978995489188216e-8f;
+
+	// Minimax polynomials on [-pi/4, pi/4], from Cephes
+	const float sin_1 = -1.6666654611e-1f;
+	const float sin_2 = 8.3321608736e-3f;
+	const float sin_3 = -1.9515295891e-4f;
+	const float cos_1 = 4.166664568298827e-2f;
+	const float cos_2 = -1.388731625493765e-3f;
+	const float cos_3 = 2.443315711809948e-5f;
+
+	// The tail and any CPU without SSE2, same steps as the vector version
+	void sin_cos(float angle, float& out_sin, float& out_cos) {
+		const float quadrant = std::nearbyint(angle * two_over_pi);
+		const float r = ((angle - quadrant * pi_over_2_a) - quadrant * pi_over_2_b) - quadrant * pi_over_2_c;
+		const float r2 = r * r;
+		const float s = r + r * r2 * (sin_1 + r2 * (sin_2 + r2 * sin_3));
+		const float c = 1.f - 0.5f * r2 + r2 * r2 * (cos_1 + r2 * (cos_2 + r2 * cos_3));
+		switch ((int)quadrant & 3) {
+		case 0: out_sin = s; out_cos = c; break;
+		case 1: out_sin = c; out_cos = -s; break;
+		case 2: out_sin = -s; out_cos = -c; break;
+		default: out_sin = -c; out_cos = s; break;
+		}
+	}
+
+	void compute_one(vec2 position, vec2 scale, float angle, unsigned char* out) {
+		float s, c;
+		sin_cos(angle, s, c);
+		const float values[6] = { c * scale.x, s * scale.x, -s * scale.y, c * scale.y, position.x, position.y };
+		memcpy(out, values, sizeof(values));
+	}
+
+#ifdef TRANSFORM_BATCH_SSE2
+	void sin_cos(__m128 angle, __m128& out_sin, __m128& out_cos) {
+		const __m128i quadrant_i = _mm_cvtps_epi32(_mm_mul_ps(angle, _mm_set1_ps(two_over_pi)));
+		const __m128 quadrant = _mm_cvtepi32_ps(quadrant_i);
+		__m128 r = _mm_sub_ps(angle, _mm_mul_ps(quadrant, _mm_set1_ps(pi_over_2_a)));
+		r = _mm_sub_ps(r, _mm_mul_ps(quadrant, _mm_set1_ps(pi_over_2_b)));
+		r = _mm_sub_ps(r, _mm_mul_ps(quadrant, _mm_set1_ps(pi_over_2_c)));
+		const __m128 r2 = _mm_mul_ps(r, r);
+
+		__m128 s = _mm_add_ps(_mm_set1_ps(sin_2), _mm_mul_ps(r2, _mm_set1_ps(sin_3)));
+		s = _mm_add_ps(_mm_set1_ps(sin_1), _mm_mul_ps(r2, s));
+		s = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, r2), s));
+		__m128 c = _mm_add_ps(_mm_set1_ps(cos_2), _mm_mul_ps(r2, _mm_set1_ps(cos_3)));
+		c = _mm_add_ps(_mm_set1_ps(cos_1), _mm_mul_ps(r2, c));
+		c = _mm_add_ps(_mm_sub_ps(_mm_set1_ps(1.f), _mm_mul_ps(_mm_set1_ps(0.5f), r2)), _mm_mul_ps(_mm_mul_ps(r2, r2), c));
+
+		// Odd quadrants swap sine and cosine, the sign flips follow from the quadrant bits
+		const __m128i bits = _mm_and_si128(quadrant_i, _mm_set1_epi32(3));
+		const __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(bits, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+		const __m128 sin_value = _mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s));
+		const __m128 cos_value = _mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c));
+		// sin is negated in quadrants 2 and 3, cos in 1 and 2
+		const __m128i sign_bit = _mm_set1_epi32((int)0x80000000u);
+		const __m128i sin_sign = _mm_and_si128(_mm_slli_epi32(bits, 30), sign_bit);
+		const __m128i cos_sign = _mm_and_si128(_mm_slli_epi32(_mm_add_epi32(bits, _mm_set1_epi32(1)), 30), sign_bit);
+		out_sin = _mm_xor_ps(sin_value, _mm_castsi128_ps(sin_sign));
+		out_cos = _mm_xor_ps(cos_value, _mm_castsi128_ps(cos_sign));
+	}
+
+	// Two interleaved vec2 pairs into their x and y lanes
+	void deinterleave(const vec2* pairs, __m128& out_x, __m128& out_y) {
+		const __m128 lo = _mm_loadu_ps(&pairs[0].x);
+		const __m128 hi = _mm_loadu_ps(&pairs[2].x);
+		out_x = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+		out_y = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+	}
+#endif
+}
+
+void compute_transforms(const TransformBatch& batch, void* out, size_t out_stride)
+{
+	const size_t count = batch.size();
+	assert(batch.positions.size() == count && batch.scales.size() == count);
+	unsigned char* destination = (unsigned char*)out;
+	size_t i = 0;
+
+#ifdef TRANSFORM_BATCH_SSE2
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 position_x, position_y, scale_x, scale_y, s, c;
+		deinterleave(&batch.positions[i], position_x, position_y);
+		deinterleave(&batch.scales[i], scale_x, scale_y);
+		sin_cos(_mm_loadu_ps(&batch.angles[i]), s, c);
+
+		const __m128 m00 = _mm_mul_ps(c, scale_x);
+		const __m128 m01 = _mm_mul_ps(s, scale_x);
+		const __m128 m10 = _mm_mul_ps(_mm_xor_ps(s, _mm_set1_ps(-0.f)), scale_y);
+		const __m128 m11 = _mm_mul_ps(c, scale_y);
+
+		// Back to one 6 float transform per entity
+		const __m128 column_0_lo = _mm_unpacklo_ps(m00, m01), column_0_hi = _mm_unpackhi_ps(m00, m01);
+		const __m128 column_1_lo = _mm_unpacklo_ps(m10, m11), column_1_hi = _mm_unpackhi_ps(m10, m11);
+		const __m128 column_2_lo = _mm_unpacklo_ps(position_x, position_y), column_2_hi = _mm_unpackhi_ps(position_x, position_y);
+		float* out_0 = (float*)(destination + (i + 0) * out_stride);
+		float* out_1 = (float*)(destination + (i + 1) * out_stride);
+		float* out_2 = (float*)(destination + (i + 2) * out_stride);
+		float* out_3 = (float*)(destination + (i + 3) * out_stride);
+		_mm_storeu_ps(out_0, _mm_movelh_ps(column_0_lo, column_1_lo));
+		_mm_storel_pi((__m64*)(out_0 + 4), column_2_lo);
+		_mm_storeu_ps(out_1, _mm_movehl_ps(column_1_lo, column_0_lo));
+		_mm_storeh_pi((__m64*)(out_1 + 4), column_2_lo);
+		_mm_storeu_ps(out_2, _mm_movelh_ps(column_0_hi, column_1_hi));
+		_mm_storel_pi((__m64*)(out_2 + 4), column_2_hi);
+		_mm_storeu_ps(out_3, _mm_movehl_ps(column_1_hi, column_0_hi));
+		_mm_storeh_pi((__m64*)(out_3 + 4), column_2_hi);
+	}
+#endif
+
+	for (; i < count; i++)
+		compute_one(batch.positions[i], batch.scales[i], batch.angles[i], destination + i * out_stride);
+}
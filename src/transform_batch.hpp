@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+
+#include "common.hpp"
+
+// Positions, scales and angles of many entities, laid out as separate arrays
+// so compute_transforms() can work on four entities at a time
+struct TransformBatch
+{
+	std::vector<vec2> positions;
+	std::vector<vec2> scales;
+	std::vector<float> angles;
+
+	void clear() { positions.clear(); scales.clear(); angles.clear(); }
+	void push(vec2 position, vec2 scale, float angle) {
+		positions.push_back(position);
+		scales.push_back(scale);
+		angles.push_back(angle);
+	}
+	size_t size() const { return angles.size(); }
+};
+
+// The model matrix of every entity in the batch, the same one Transform builds
+// with translate, rotate and scale, but in closed form:
+//
+//   | cos * scale.x   -sin * scale.y   position.x |
+//   | sin * scale.x    cos * scale.y   position.y |
+//
+// Runs four entities per step with SSE2 where available. The sine and cosine
+// come from one polynomial shared by all lanes, within a few ulp of sinf/cosf
+// for the angles the game uses.
+//
+// Transform i is written to out + i * out_stride bytes, so the results can go
+// straight into an array of larger structs (draw items, instances).
+void compute_transforms(const TransformBatch& batch, void* out, size_t out_stride = sizeof(Affine2D));
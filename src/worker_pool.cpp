@@ -0,0 +1,77 @@
+// internal
+#include "worker_pool.hpp"
+
+WorkerPool::WorkerPool(unsigned threads)
+{
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	for (unsigned i = 1; i < threads; i++)
+		workers.emplace_back(&WorkerPool::workerLoop, this);
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quitting = true;
+	}
+	wake.notify_all();
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+void WorkerPool::parallel_for(size_t count, const std::function<void(size_t)>& job)
+{
+	if (count == 0)
+		return;
+	if (workers.empty() || count == 1)
+	{
+		for (size_t i = 0; i < count; i++)
+			job(i);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		current_job = &job;
+		job_count = count;
+		next_job = 0;
+		busy = (unsigned)workers.size();
+		generation++;
+	}
+	wake.notify_all();
+	runJobs();
+
+	// job has to outlive every worker that may still be calling it
+	std::unique_lock<std::mutex> lock(mutex);
+	done.wait(lock, [this] { return busy == 0; });
+	current_job = nullptr;
+}
+
+// Takes indices until there are none left, shared by the caller and the workers
+void WorkerPool::runJobs()
+{
+	for (size_t i = next_job++; i < job_count; i = next_job++)
+		(*current_job)(i);
+}
+
+void WorkerPool::workerLoop()
+{
+	uint64_t seen = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&] { return quitting || generation != seen; });
+			if (quitting)
+				return;
+			seen = generation;
+		}
+		runJobs();
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			busy--;
+		}
+		done.notify_one();
+	}
+}
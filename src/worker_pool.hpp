@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of threads that split loops between them. The calling thread
+// works on the loop too, so a pool of one thread runs everything inline.
+class WorkerPool
+{
+public:
+	// threads = 0 uses one thread per core
+	WorkerPool(unsigned threads = 0);
+	~WorkerPool();
+
+	// Calls job(i) for every i in [0, count), spread over all threads, and
+	// returns once all calls are done. Not reentrant.
+	void parallel_for(size_t count, const std::function<void(size_t)>& job);
+
+	unsigned get_thread_count() const { return (unsigned)workers.size() + 1; }
+
+private:
+	void workerLoop();
+	void runJobs();
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	uint64_t generation = 0; // bumped for every parallel_for, guarded by mutex
+	bool quitting = false;
+	unsigned busy = 0; // workers still inside the current loop, guarded by mutex
+
+	const std::function<void(size_t)>* current_job = nullptr;
+	size_t job_count = 0;
+	std::atomic<size_t> next_job{ 0 };
+};
@@ -4,11 +4,11 @@
 // Define barrier speed
 // static float BARRIER_SPEED = -300.f;
 
-Entity createTitle(RenderSystem* renderer, vec2 pos) {
+Entity createTitle(RenderAssets* assets, vec2 pos) {
 	auto entity = Entity();
 
 	// Store a reference to the potentially re-used mesh object
-	Mesh& mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::SPRITE);
+	Mesh& mesh = assets->getMesh(GEOMETRY_BUFFER_ID::SPRITE);
 	registry.meshPtrs.emplace(entity, &mesh);
 
 	// Setting initial motion values
@@ -24,19 +24,20 @@ Entity createTitle(RenderSystem* renderer, vec2 pos) {
 		entity,
 		{ TEXTURE_ASSET_ID::TITLE, // TEXTURE_COUNT indicates that no texture is needed
 			EFFECT_ASSET_ID::TEXTURED,
-			GEOMETRY_BUFFER_ID::SPRITE });
+			GEOMETRY_BUFFER_ID::SPRITE,
+			RENDER_LAYER::UI });
 
 	return entity;
 }
 
-Entity createCar(RenderSystem* renderer, vec2 pos)
+Entity createCar(RenderAssets* assets, vec2 pos)
 {
 	// auto entity = createEel(renderer,pos);
 	auto entity = Entity();
 
 
 	// Store a reference to the potentially re-used mesh object
-	Mesh& mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::SPRITE);
+	Mesh& mesh = assets->getMesh(GEOMETRY_BUFFER_ID::SPRITE);
 	registry.meshPtrs.emplace(entity, &mesh);
 
 	// Setting initial motion values
@@ -49,6 +50,9 @@ Entity createCar(RenderSystem* renderer, vec2 pos)
 
 	// create an empty Car component for our character
 	registry.players.emplace(entity);
+
+	// Tight outline of the opaque part of the sprite
+	registry.colliders.insert(entity, { &assets->getHull(TEXTURE_ASSET_ID::CAR_SPRITE) });
 	registry.renderRequests.insert(
 		entity,
 		{ TEXTURE_ASSET_ID::CAR_SPRITE, // TEXTURE_COUNT indicates that no texture is needed
@@ -58,87 +62,82 @@ Entity createCar(RenderSystem* renderer, vec2 pos)
 	return entity;
 }
 
-Entity createBonus(RenderSystem* renderer, vec2 position, float angle = 0.f)
+Prefab createBonusPrefab(RenderAssets* assets)
 {
-	// Reserve en entity
-	auto entity = Entity();
-
+	Prefab prefab;
 	// Store a reference to the potentially re-used mesh object
-	Mesh& mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::SPRITE);
-	registry.meshPtrs.emplace(entity, &mesh);
-
-	// Initialize the position, scale, and physics components
-	auto& motion = registry.motions.emplace(entity);
-	motion.angle = angle;
-	motion.velocity = { BARRIER_SPEED, 0 };
-	motion.position = position;
-
-	// Setting initial values, scale is negative to make it face the opposite way
-	motion.scale = vec2({ BONUS_WIDTH, BONUS_HEIGHT });
-
-	// Create an (empty) Bug component to be able to refer to all bug
-	registry.eatables.emplace(entity);
-	registry.renderRequests.insert(
-		entity,
-		{
-			TEXTURE_ASSET_ID::BONUS,
-			EFFECT_ASSET_ID::TEXTURED,
-			GEOMETRY_BUFFER_ID::SPRITE
-		});
-
-	return entity;
+	prefab.mesh = &assets->getMesh(GEOMETRY_BUFFER_ID::SPRITE);
+
+	// Initialize the physics components, position and angle are set per instance
+	prefab.motion.velocity = { BARRIER_SPEED, 0 };
+	prefab.motion.scale = vec2({ BONUS_WIDTH, BONUS_HEIGHT });
+
+	// Eatable, to be able to refer to all bonuses
+	prefab.eatable = true;
+	prefab.hull = &assets->getHull(TEXTURE_ASSET_ID::BONUS);
+	prefab.render_request = {
+		TEXTURE_ASSET_ID::BONUS,
+		EFFECT_ASSET_ID::TEXTURED,
+		GEOMETRY_BUFFER_ID::SPRITE
+	};
+	return prefab;
 }
 
-Entity createBarrier(RenderSystem* renderer, vec2 position)
+Prefab createBarrierPrefab(RenderAssets* assets)
 {
-	auto entity = Entity();
-
+	Prefab prefab;
 	// Store a reference to the potentially re-used mesh object (the value is stored in the resource cache)
-	Mesh& mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::SPRITE);
-	registry.meshPtrs.emplace(entity, &mesh);
-
-	// Initialize the motion
-	auto& motion = registry.motions.emplace(entity);
-	motion.angle = 3.f * M_PI_2 / 4.f;
-	motion.velocity = { BARRIER_SPEED, 0.f };
-	motion.position = position;
-
-	// Setting initial values
-	motion.scale = vec2({ BARRIER_WIDTH, BARRIER_HEIGHT});
-
-	// create an empty Wall component to be able to refer to all walls
-	registry.deadlys.emplace(entity);
-	registry.renderRequests.insert(
-		entity,
-		{
-			TEXTURE_ASSET_ID::BARRIER,
-			EFFECT_ASSET_ID::TEXTURED,
-			GEOMETRY_BUFFER_ID::SPRITE
-		});
-
-	return entity;
+	prefab.mesh = &assets->getMesh(GEOMETRY_BUFFER_ID::SPRITE);
+
+	// Initialize the motion, barriers are all spawned at BARRIER_ANGLE
+	prefab.motion.velocity = { BARRIER_SPEED, 0.f };
+	prefab.motion.scale = vec2({ BARRIER_WIDTH, BARRIER_HEIGHT });
+
+	// Deadly, to be able to refer to all barriers
+	prefab.deadly = true;
+	prefab.hull = &assets->getHull(TEXTURE_ASSET_ID::BARRIER);
+	prefab.render_request = {
+		TEXTURE_ASSET_ID::BARRIER,
+		EFFECT_ASSET_ID::TEXTURED,
+		GEOMETRY_BUFFER_ID::SPRITE
+	};
+	return prefab;
 }
 
-Entity createLine(vec2 position, vec2 scale)
+Prefab createBodyPrefab(RenderAssets* assets)
 {
-	Entity entity = Entity();
-
-	// Store a reference to the potentially re-used mesh object (the value is stored in the resource cache)
-	registry.renderRequests.insert(
-		entity, {
-			TEXTURE_ASSET_ID::TEXTURE_COUNT,
-			EFFECT_ASSET_ID::EGG,
-			GEOMETRY_BUFFER_ID::DEBUG_LINE
-		});
+	Prefab prefab;
+	prefab.mesh = &assets->getMesh(GEOMETRY_BUFFER_ID::SPRITE);
+
+	// Same shape as the player's car, standing still until given a velocity
+	prefab.motion.scale = vec2({ CAR_HEIGHT, -CAR_WIDTH });
+	prefab.hull = &assets->getHull(TEXTURE_ASSET_ID::CAR_SPRITE);
+	prefab.render_request = {
+		TEXTURE_ASSET_ID::CAR_SPRITE,
+		EFFECT_ASSET_ID::TEXTURED,
+		GEOMETRY_BUFFER_ID::SPRITE
+	};
+	return prefab;
+}
 
-	// Create motion
-	Motion& motion = registry.motions.emplace(entity);
-	motion.angle = 0.f;
-	motion.velocity = { 0, 0 };
-	motion.position = position;
-	motion.scale = scale;
+Prefab createTrafficPrefab(RenderAssets* assets)
+{
+	// A body that kills the player like a barrier does
+	Prefab prefab = createBodyPrefab(assets);
+	prefab.deadly = true;
+	return prefab;
+}
 
-	registry.debugComponents.emplace(entity);
+Entity createTrafficCar(const Prefab& prefab, vec2 pos, int lane, float cruise_speed)
+{
+	Entity entity = instantiate(prefab, pos, M_PI);
+	TrafficCar& car = registry.trafficCars.emplace(entity);
+	car.lane = lane;
+	car.cruise_speed = cruise_speed;
+	car.target_speed = cruise_speed;
+
+	// Already up to speed, the road scrolls by underneath
+	registry.motions.get(entity).velocity = { BARRIER_SPEED + cruise_speed, 0.f };
 	return entity;
 }
 
@@ -2,7 +2,8 @@
 
 #include "common.hpp"
 #include "tiny_ecs.hpp"
-#include "render_system.hpp"
+#include "prefab.hpp"
+#include "render_assets.hpp"
 
 // These are hardcoded to the dimensions of the entity texture
 // BB = bounding box
@@ -16,23 +17,34 @@ const float BARRIER_WIDTH   = 2.f * 62.f;	// 1001
 const float BARRIER_HEIGHT  = 2.f * 210.f;	// 870
 
 const float BARRIER_SPEED = -400.f;
+const float BARRIER_ANGLE = 3.f * M_PI_2 / 4.f;
 
 const float SPEED_FACTOR = 1.05f;
 
+// The road traffic drives on, lanes are numbered from the top
+const int LANE_COUNT = 4;
+const float LANE_WIDTH = (float)window_height_px / LANE_COUNT;
+
+// The factories only need the meshes and hulls, so they work without a renderer
+
 // the player
-Entity createCar(RenderSystem* renderer, vec2 pos);
+Entity createCar(RenderAssets* assets, vec2 pos);
+
+// the prey, spawned with instantiate()
+Prefab createBonusPrefab(RenderAssets* assets);
 
-// the prey
-Entity createBonus(RenderSystem* renderer, vec2 position, float angle);
+// the enemy, spawned with instantiate()
+Prefab createBarrierPrefab(RenderAssets* assets);
 
-// the enemy
-Entity createBarrier(RenderSystem* renderer, vec2 position);
+// a car nobody drives, for filling the world in the stress test
+Prefab createBodyPrefab(RenderAssets* assets);
 
-// a red line for debugging purposes
-Entity createLine(vec2 position, vec2 size);
+// a car the AISystem drives, spawned with createTrafficCar()
+Prefab createTrafficPrefab(RenderAssets* assets);
+Entity createTrafficCar(const Prefab& prefab, vec2 pos, int lane, float cruise_speed);
 
 // a egg
 Entity createEgg(vec2 pos, vec2 size);
 
 // the title
-Entity createTitle(RenderSystem* renderer, vec2 pos);
+Entity createTitle(RenderAssets* assets, vec2 pos);
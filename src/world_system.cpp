@@ -3,12 +3,13 @@
 #include "world_init.hpp"
 
 // stlib
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 #include <sstream>
-#include <xpc/xpc.h>
 
 #include "physics_system.hpp"
+#include "profiler.hpp"
 #include "state_system.h"
 
 // Game configuration
@@ -16,6 +17,8 @@ const size_t MAX_NUM_WALLS = 7;
 const size_t MAX_NUM_BONUS = 5;
 const size_t BARRIER_SPAWN_DELAY_MS = 500 * 3;
 const size_t BONUS_SPAWN_DELAY_MS = 750 * 3;
+const size_t MAX_NUM_TRAFFIC = 3;
+const size_t TRAFFIC_SPAWN_DELAY_MS = 1000 * 3;
 size_t CURRENT_BONUS_SPAWN_DELAY_MS = BONUS_SPAWN_DELAY_MS;
 size_t CURRENT_BARRIER_SPAWN_DELAY_MS = BARRIER_SPAWN_DELAY_MS;
 const size_t WALL_GAP = 350.f;
@@ -24,37 +27,34 @@ const size_t WALL_GAP = 350.f;
 // Car speed
 static float CAR_SPEED = 400.f;
 
-std::unordered_map<int, bool> WorldSystem::key_map;
-vec2 WorldSystem::mouse_pos;
 float WorldSystem::target_angle = M_PI;
 
-std::unordered_map<int, bool> WorldSystem::button_map;
-
 // create the world
 WorldSystem::WorldSystem()
-	: next_barrier_spawn(0.f)
-	, next_bonus_spawn(0.f) {
+	: window(nullptr)
+	, over(false)
+	, live_input(true)
+	, recorder(nullptr)
+	, next_barrier_spawn(0.f)
+	, next_bonus_spawn(0.f)
+	, next_traffic_spawn(0.f) {
 	// Seeding rng with random device
-	rng = std::default_random_engine(std::random_device()());
+	set_seed(std::random_device()());
 }
 
-WorldSystem::~WorldSystem() {
-	
-	// destroy music components
-	if (background_music != nullptr)
-		Mix_FreeMusic(background_music);
-	if (car_crash_sound != nullptr)
-		Mix_FreeChunk(car_crash_sound);
-	if (point_scored_sound != nullptr)
-		Mix_FreeChunk(point_scored_sound);
-
-	Mix_CloseAudio();
+void WorldSystem::set_seed(uint32_t seed_arg) {
+	seed = seed_arg;
+	rng.seed(seed);
+	uniform_dist.reset();
+}
 
+WorldSystem::~WorldSystem() {
 	// Destroy all created components
 	registry.clear_all_components();
 
 	// Close the window
-	glfwDestroyWindow(window);
+	if (window != nullptr)
+		glfwDestroyWindow(window);
 }
 
 // Debugging
@@ -76,20 +76,29 @@ GLFWwindow* WorldSystem::create_window() {
 	}
 
 	//-------------------------------------------------------------------------
-	// If you are on Linux or Windows, you can change these 2 numbers to 4 and 3 and
-	// enable the glDebugMessageCallback to have OpenGL catch your mistakes for you.
 	// GLFW / OGL Initialization
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-	glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
 #if __APPLE__
 	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 	glfwWindowHint(GLFW_RESIZABLE, 0);
+#ifdef GL_ERROR_CHECKS
+	glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
+#endif
 
 	// Create the main window (for rendering, keyboard, and mouse input)
+	window = nullptr;
+#if defined(GL_ERROR_CHECKS) && !__APPLE__
+	// Try for 4.3 first, it lets glDebugMessageCallback catch our mistakes (see gl_enable_debug_output)
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	window = glfwCreateWindow(window_width_px, window_height_px, "Drifty Cars", nullptr, nullptr);
+#endif
+	if (window == nullptr) {
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		window = glfwCreateWindow(window_width_px, window_height_px, "Drifty Cars", nullptr, nullptr);
+	}
 	if (window == nullptr) {
 		fprintf(stderr, "Failed to glfwCreateWindow");
 		return nullptr;
@@ -98,90 +107,71 @@ GLFWwindow* WorldSystem::create_window() {
 	// Setting callbacks to member functions (that's why the redirect is needed)
 	// Input is handled using GLFW, for more info see
 	// http://www.glfw.org/docs/latest/input_guide.html
+	// The callbacks only queue the input, step() applies it
 	glfwSetWindowUserPointer(window, this);
-	auto key_redirect = [](GLFWwindow* wnd, int _0, int _1, int _2, int _3) { ((WorldSystem*)glfwGetWindowUserPointer(wnd))->on_key(_0, _1, _2, _3); };
-	auto cursor_pos_redirect = [](GLFWwindow* wnd, double _0, double _1) { ((WorldSystem*)glfwGetWindowUserPointer(wnd))->on_mouse_move({ _0, _1 }); };
-	auto mouse_button_redirect = [](GLFWwindow* wnd, int button, int action, int mods) { ((WorldSystem*)glfwGetMouseButton(wnd, button))->on_mouse_click(button, action, mods); };
+	auto key_redirect = [](GLFWwindow* wnd, int _0, int _1, int _2, int _3) {
+		WorldSystem* world = (WorldSystem*)glfwGetWindowUserPointer(wnd);
+		if (world->live_input) world->input.push_key(_0, _2, _3);
+		else if (_0 == GLFW_KEY_ESCAPE) world->end_game();
+	};
+	auto cursor_pos_redirect = [](GLFWwindow* wnd, double _0, double _1) {
+		WorldSystem* world = (WorldSystem*)glfwGetWindowUserPointer(wnd);
+		if (world->live_input) world->input.push_mouse_move({ _0, _1 });
+	};
+	auto mouse_button_redirect = [](GLFWwindow* wnd, int button, int action, int mods) {
+		WorldSystem* world = (WorldSystem*)glfwGetWindowUserPointer(wnd);
+		if (world->live_input) world->input.push_mouse_button(button, action, mods);
+	};
 	glfwSetKeyCallback(window, key_redirect);
 	glfwSetCursorPosCallback(window, cursor_pos_redirect);
 	glfwSetMouseButtonCallback(window, mouse_button_redirect);
 
-	//////////////////////////////////////
-	// Loading music and sounds with SDL
-	if (SDL_Init(SDL_INIT_AUDIO) < 0) {
-		fprintf(stderr, "Failed to initialize SDL Audio");
-		return nullptr;
-	}
-	if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) == -1) {
-		fprintf(stderr, "Failed to open audio device");
-		return nullptr;
-	}
-
-	background_music = Mix_LoadMUS(audio_path("background_chiptune.wav").c_str());
-	car_crash_sound = Mix_LoadWAV(audio_path("car_crash.mp3").c_str());
-	point_scored_sound = Mix_LoadWAV(audio_path("honk.wav").c_str());
-
-	if (background_music == nullptr || car_crash_sound == nullptr || point_scored_sound == nullptr) {
-		fprintf(stderr, "Failed to load sounds\n %s\n %s\n %s\n make sure the data directory is present",
-			audio_path("background_chiptune.wav").c_str(),
-			audio_path("car_crash.wav").c_str(),
-			audio_path("honk.wav").c_str());
-		return nullptr;
-	}
-
 	return window;
 }
 
-void WorldSystem::init(RenderSystem* renderer_arg) {
+void WorldSystem::init(RenderAssets* assets_arg, PhysicsSystem* physics_arg, AudioBackend* audio_arg, RenderSystem* renderer_arg) {
+	this->assets = assets_arg;
+	this->physics = physics_arg;
+	this->audio = audio_arg;
 	this->renderer = renderer_arg;
-	// Playing background music indefinitely
-	Mix_PlayMusic(background_music, -1);
-	fprintf(stderr, "Loaded music\n");
+	// RenderSystem creates it along with its backend, headless runs have none
+	if (registry.screenStates.size() == 0)
+		registry.screenStates.emplace(Entity());
+	// Looked up once, spawning only copies them
+	barrier_prefab = createBarrierPrefab(assets);
+	bonus_prefab = createBonusPrefab(assets);
+	traffic_prefab = createTrafficPrefab(assets);
+	audio->play_music();
 	// Set all states to default
     restart_game();
 }
 
-vec2 WorldSystem::get_mouse_position() {
-	return mouse_pos;
-}
-
-void WorldSystem::on_mouse_move(vec2 mouse_position) {
-	mouse_pos = mouse_position;
-}
-
-// Set a mouse button as clicked
-void WorldSystem::click_button(int button) {
-	button_map[button] = true;
-}
-
-// Set a mouse button as released
-void WorldSystem::release_button(int button) {
-	button_map[button] = false;
-}
-
-// Is mouse button clicked?
-bool WorldSystem::button_clicked(int button) {
-	return WorldSystem::button_map[button];
-}
-
-void WorldSystem::on_mouse_click(int button, int action, int mods) {
-	if (action == GLFW_PRESS) {
-		click_button(button);
-	} else if (action == GLFW_RELEASE) {
-		release_button(button);
-	}
-}
-
 // Update our game world
 bool WorldSystem::step(float elapsed_ms_since_last_update) {
-	// Updating window title with points
-	std::stringstream title_ss;
-	title_ss << "Points: " << StateSystem::get_points();
-	glfwSetWindowTitle(window, title_ss.str().c_str());
-
-	// Remove debug info from the last step
-	while (registry.debugComponents.entities.size() > 0)
-	    registry.remove_all_components_of(registry.debugComponents.entities.back());
+	PROFILE_SCOPE("WorldSystem::step");
+	process_input();
+	// closes the record of the input that came in since the last step
+	if (recorder != nullptr)
+		recorder->end_step(elapsed_ms_since_last_update);
+
+	// Updating window title with points, headless runs have no window
+	if (window != nullptr) {
+		std::stringstream title_ss;
+		title_ss << "Points: " << StateSystem::get_points();
+		if (debugging.in_debug_mode && renderer != nullptr) {
+			// GL work of the last frame, to see how well the render queue batches
+			const RenderStats stats = renderer->get_stats();
+			title_ss << " | submitted: " << stats.submitted
+				<< " culled: " << stats.culled
+				<< " draws: " << stats.draw_calls
+				<< " instances: " << stats.instances
+				<< " programs: " << stats.program_binds
+				<< " textures: " << stats.texture_binds
+				<< " vaos: " << stats.vao_binds
+				<< " input latency: " << input.get_latency_ms() << " ms";
+		}
+		glfwSetWindowTitle(window, title_ss.str().c_str());
+	}
 
 	// Removing out of screen entities
 	auto& motions_registry = registry.motions;
@@ -193,32 +183,60 @@ bool WorldSystem::step(float elapsed_ms_since_last_update) {
 	    Motion& motion = motions_registry.components[i];
 		if (motion.position.x + abs(motion.scale.x) < 0.f) {
 			if(!registry.players.has(motions_registry.entities[i])) // don't remove the player
-				registry.remove_all_components_of(motions_registry.entities[i]);
+				registry.recycle(motions_registry.entities[i]);
 		}
 	}
 
 	// spawn new walls
 	next_barrier_spawn -= elapsed_ms_since_last_update * current_speed;
-	if (registry.deadlys.components.size() <= MAX_NUM_WALLS && next_barrier_spawn < 0.f) {
+	// traffic is deadly too, but doesn't count as walls
+	size_t num_walls = registry.deadlys.components.size() - registry.trafficCars.components.size();
+	if (num_walls <= MAX_NUM_WALLS && next_barrier_spawn < 0.f) {
 		next_barrier_spawn = CURRENT_BARRIER_SPAWN_DELAY_MS * (1 + (uniform_dist(rng) - 0.5f)/2.f);
 		// next_barrier_spawn = CURRENT_BARRIER_SPAWN_DELAY_MS;
 		float gap_loc = uniform_dist(rng) * window_height_px * .5f;
 
-		// create Wall with random gap position
-        createBarrier(renderer, vec2(window_width_px + 200.f, gap_loc - BARRIER_HEIGHT / 2.f));
-        createBarrier(renderer, vec2(window_width_px + 200.f,gap_loc + WALL_GAP + BARRIER_HEIGHT / 2.f));
+		// create Wall with random gap position, both halves at once
+		const vec2 positions[2] = {
+			vec2(window_width_px + 200.f, gap_loc - BARRIER_HEIGHT / 2.f),
+			vec2(window_width_px + 200.f, gap_loc + WALL_GAP + BARRIER_HEIGHT / 2.f) };
+		const float angles[2] = { BARRIER_ANGLE, BARRIER_ANGLE };
+		instantiate_batch(barrier_prefab, positions, angles, 2);
 	}
 
 	// spawn bonus
 	next_bonus_spawn -= elapsed_ms_since_last_update * current_speed;
 	// std::cout << next_bonus_spawn << std::endl;
 	if (registry.eatables.components.size() <= MAX_NUM_BONUS && next_bonus_spawn < 0.f) {
-		// reset timer
-		next_bonus_spawn = CURRENT_BONUS_SPAWN_DELAY_MS / 2 + uniform_dist(rng) * (CURRENT_BONUS_SPAWN_DELAY_MS / 2);
-		// next_bonus_spawn = CURRENT_BONUS_SPAWN_DELAY_MS;
+		// random initial position
+		vec2 bonus_position = vec2(window_width_px + 200.f, uniform_dist(rng) * (window_height_px));
+		float bonus_angle = uniform_dist(rng) * 2 * M_PI;
+
+		// only spawn where there is no barrier, otherwise try again next step
+		SpatialIndex& spatial_index = physics->get_spatial_index();
+		if (spatial_index.overlap_obb(bonus_position, { BONUS_WIDTH, BONUS_HEIGHT }, bonus_angle, MASK_DEADLY, spawn_overlaps) == 0) {
+			// reset timer
+			next_bonus_spawn = CURRENT_BONUS_SPAWN_DELAY_MS / 2 + uniform_dist(rng) * (CURRENT_BONUS_SPAWN_DELAY_MS / 2);
+			// next_bonus_spawn = CURRENT_BONUS_SPAWN_DELAY_MS;
+
+			// create Bonus
+			instantiate(bonus_prefab, bonus_position, bonus_angle);
+		}
+	}
 
-		// create Bonus with random initial position
-		createBonus(renderer, vec2(window_width_px + 200.f, uniform_dist(rng) * (window_height_px)), uniform_dist(rng) * 2 * M_PI);
+	// spawn traffic, the AISystem drives it
+	next_traffic_spawn -= elapsed_ms_since_last_update * current_speed;
+	if (registry.trafficCars.components.size() < MAX_NUM_TRAFFIC && next_traffic_spawn < 0.f) {
+		int lane = std::min((int)(uniform_dist(rng) * LANE_COUNT), LANE_COUNT - 1);
+		vec2 traffic_position = vec2(window_width_px + 200.f, LANE_WIDTH * (lane + .5f));
+		float cruise_speed = 150.f + uniform_dist(rng) * 150.f;
+
+		// same as the bonus, not on top of anything deadly
+		SpatialIndex& spatial_index = physics->get_spatial_index();
+		if (spatial_index.overlap_obb(traffic_position, { CAR_HEIGHT, CAR_WIDTH }, 0.f, MASK_DEADLY, spawn_overlaps) == 0) {
+			next_traffic_spawn = TRAFFIC_SPAWN_DELAY_MS / 2 + uniform_dist(rng) * (TRAFFIC_SPAWN_DELAY_MS / 2);
+			createTrafficCar(traffic_prefab, traffic_position, lane, cruise_speed);
+		}
 	}
 
 	// Processing the car state
@@ -226,7 +244,7 @@ bool WorldSystem::step(float elapsed_ms_since_last_update) {
     ScreenState &screen = registry.screenStates.components[0];
 
     float min_counter_ms = 3000.f;
-	if (registry.deathTimers.entities.size() > 0) {Mix_PauseMusic();}
+	if (registry.deathTimers.entities.size() > 0) {audio->pause_music();}
 	for (Entity entity : registry.deathTimers.entities) {
 		// progress timer
 		DeathTimer& counter = registry.deathTimers.get(entity);
@@ -276,39 +294,39 @@ void WorldSystem::basic_car_handling(float elapsed_ms_since_last_update) {
 		float sin_angle = sinf(player_motion.angle);
 
 		// left key pressed
-		if (key_pressed(GLFW_KEY_LEFT)) {
+		if (input.held(GLFW_KEY_LEFT)) {
 			player_motion.velocity.x = cos_angle * CAR_SPEED;
 			player_motion.velocity.y = sin_angle * CAR_SPEED;
 		}
 
 		// right key pressed
-		if (key_pressed(GLFW_KEY_RIGHT)) {
+		if (input.held(GLFW_KEY_RIGHT)) {
 			player_motion.velocity.x = -cos_angle * CAR_SPEED;
 			player_motion.velocity.y = -sin_angle * CAR_SPEED;
 		}
 
 		// up key pressed
-		if (key_pressed(GLFW_KEY_UP)) {
+		if (input.held(GLFW_KEY_UP)) {
 			player_motion.velocity.x = -sin_angle * CAR_SPEED;
 			player_motion.velocity.y = cos_angle * CAR_SPEED;
 		}
 
 		// down key pressed
-		if (key_pressed(GLFW_KEY_DOWN)) {
+		if (input.held(GLFW_KEY_DOWN)) {
 			player_motion.velocity.x = sin_angle * CAR_SPEED;
 			player_motion.velocity.y = -cos_angle * CAR_SPEED;
 		}
 
 		// stop if no keys pressed
-		if (!key_pressed(GLFW_KEY_RIGHT) &&
-			!key_pressed(GLFW_KEY_LEFT) &&
-			!key_pressed(GLFW_KEY_DOWN) &&
-			!key_pressed(GLFW_KEY_UP)) {
+		if (!input.held(GLFW_KEY_RIGHT) &&
+			!input.held(GLFW_KEY_LEFT) &&
+			!input.held(GLFW_KEY_DOWN) &&
+			!input.held(GLFW_KEY_UP)) {
 			player_motion.velocity = vec2(0.f, 0.f);
 		}
 
 		// Basic rotation
-		vec2 mouse = get_mouse_position();
+		vec2 mouse = input.mouse_position();
 		float angle_mouse = atan2f(player_motion.position.y - mouse.y,
 									player_motion.position.x - mouse.x);
 		player_motion.angle = angle_mouse;
@@ -327,7 +345,7 @@ void WorldSystem::advanced_car_handling(float elapsed_ms_since_last_update) {
 		float inline_component = -x_velocity * cos_angle -y_velocity * sin_angle;
 		float normal_component = -x_velocity * sin_angle -y_velocity * cos_angle;
 		// left key pressed
-		// if (key_pressed(GLFW_KEY_LEFT)) {
+		// if (input.held(GLFW_KEY_LEFT)) {
 		// 	if (inline_component > -CAR_SPEED) {
 		// 		player_motion.velocity.x += cos_angle * elapsed_ms_since_last_update / 1.f;
 		// 		player_motion.velocity.y += sin_angle * elapsed_ms_since_last_update / 1.f;
@@ -335,8 +353,8 @@ void WorldSystem::advanced_car_handling(float elapsed_ms_since_last_update) {
 		// }
 
 		// right key pressed
-		// if (key_pressed(GLFW_KEY_RIGHT) || button_clicked(GLFW_MOUSE_BUTTON_LEFT)) {
-		if (button_clicked(GLFW_MOUSE_BUTTON_LEFT)) {
+		// if (input.held(GLFW_KEY_RIGHT) || button_clicked(GLFW_MOUSE_BUTTON_LEFT)) {
+		if (input.button_held(GLFW_MOUSE_BUTTON_LEFT)) {
 			if (inline_component < CAR_SPEED) {
 				player_motion.velocity.x -= cos_angle * elapsed_ms_since_last_update / 1.f;
 				player_motion.velocity.y -= sin_angle * elapsed_ms_since_last_update / 1.f;
@@ -344,7 +362,7 @@ void WorldSystem::advanced_car_handling(float elapsed_ms_since_last_update) {
 		}
 
 		// // up key pressed
-		// if (key_pressed(GLFW_KEY_UP)) {
+		// if (input.held(GLFW_KEY_UP)) {
 		// 	if (normal_component > -CAR_SPEED && abs(inline_component) < CAR_SPEED) {
 		// 		player_motion.velocity.x -= sin_angle * elapsed_ms_since_last_update / 1.f;
 		// 		player_motion.velocity.y += cos_angle * elapsed_ms_since_last_update / 1.f;
@@ -352,7 +370,7 @@ void WorldSystem::advanced_car_handling(float elapsed_ms_since_last_update) {
 		// }
 
 		// // down key pressed
-		// if (key_pressed(GLFW_KEY_DOWN)) {
+		// if (input.held(GLFW_KEY_DOWN)) {
 		// 	if (normal_component < CAR_SPEED) {
 		// 		player_motion.velocity.x += sin_angle * elapsed_ms_since_last_update / 1.f;
 		// 		player_motion.velocity.y -= cos_angle * elapsed_ms_since_last_update / 1.f;
@@ -368,7 +386,7 @@ void WorldSystem::advanced_car_handling(float elapsed_ms_since_last_update) {
 		// std::cout << "Current car Normal: " << normal_component << std::endl;
 
 		// Smoothed rotation
-		vec2 mouse = get_mouse_position();
+		vec2 mouse = input.mouse_position();
 		float angle_mouse = atan2f(player_motion.position.y - mouse.y,
 									player_motion.position.x - mouse.x);
 		if (abs(player_motion.angle - angle_mouse) > 0.01f) {
@@ -409,20 +427,20 @@ void WorldSystem::restart_game() {
 	StateSystem::set_advanced();
 
 	// Resume music
-	Mix_ResumeMusic();
+	audio->resume_music();
 
 	// Remove all entities that we created
 	while (registry.motions.entities.size() > 0)
-	    registry.remove_all_components_of(registry.motions.entities.back());
+	    registry.recycle(registry.motions.entities.back());
 
 	// Debugging for memory/component leaks
 	registry.list_all_components();
 
 	// display title
-	title = createTitle(renderer, {window_width_px/2, window_height_px/3});
+	title = createTitle(assets, {window_width_px/2, window_height_px/3});
 
 	// create a new Car
-	player_car = createCar(renderer, { window_width_px/4, 2 * window_height_px / 3 });
+	player_car = createCar(assets, { window_width_px/4, 2 * window_height_px / 3 });
 	registry.colors.insert(player_car, {1, 0.8f, 0.8f});
 
 
@@ -442,6 +460,7 @@ void WorldSystem::restart_game() {
 
 // Compute collisions between entities
 void WorldSystem::handle_collisions() {
+	PROFILE_SCOPE("WorldSystem::handle_collisions");
 	// Loop over all collisions detected by the physics system
 	auto& collisionsRegistry = registry.collisions;
 	for (uint i = 0; i < collisionsRegistry.components.size(); i++) {
@@ -459,7 +478,7 @@ void WorldSystem::handle_collisions() {
 				if (!registry.deathTimers.has(entity)) {
 					// Crash sound, reset timer, and make the car bounce
 					registry.deathTimers.emplace(entity);
-					Mix_PlayChannel(-1, car_crash_sound, 0);
+					audio->play(SOUND_ASSET_ID::CAR_CRASH);
 					Motion& player_motion = registry.motions.get(player_car);
 					// TODO: Update collision system to get angle between colliders
 					// player_motion.velocity = vec2(-player_motion.velocity.x + 300 * sin(-player_motion.angle), -player_motion.velocity.y - 300 * cos(-player_motion.angle));
@@ -487,8 +506,8 @@ void WorldSystem::handle_collisions() {
 			else if (registry.eatables.has(entity_other)) {
 				if (!registry.deathTimers.has(entity)) {
 					// chew, count points, and set the LightUp timer
-					registry.remove_all_components_of(entity_other);
-					Mix_PlayChannel(-1, point_scored_sound, 0);
+					registry.recycle(entity_other);
+					audio->play(SOUND_ASSET_ID::POINT_SCORED);
 					StateSystem::increment_points(1);
 					current_speed *= SPEED_FACTOR;
 					if (StateSystem::is_advanced()) {
@@ -501,7 +520,7 @@ void WorldSystem::handle_collisions() {
 
 		if (registry.eatables.has(entity) && registry.deadlys.has(entity_other)) {
 			if (registry.motions.get(entity).position.x > window_height_px) {
-				registry.remove_all_components_of(entity);
+				registry.recycle(entity);
 			}
 		}
 	}
@@ -511,38 +530,44 @@ void WorldSystem::handle_collisions() {
 
 // Should the game be over ?
 bool WorldSystem::is_over() const {
-	return bool(glfwWindowShouldClose(window));
+	return over || (window != nullptr && glfwWindowShouldClose(window));
 }
 
 // Set the game to be over
-void WorldSystem::end_game() const {
-	glfwSetWindowShouldClose(window, true);
-}
-
-// Set a key to pressed
-void WorldSystem::press_key(int key) {
-	key_map[key] = true;
-}
-
-// Set a key to released
-void WorldSystem::release_key(int key) {
-	key_map[key] = false;
+void WorldSystem::end_game() {
+	over = true;
+	if (window != nullptr)
+		glfwSetWindowShouldClose(window, true);
 }
 
-// Is key pressed?
-bool WorldSystem::key_pressed(int key) {
-	return key_map[key];
-}
-
-// On key callback
-void WorldSystem::on_key(int key, int, int action, int mod) {
-	if (action == GLFW_PRESS) {
-		press_key(key);
-	}
-	if (action == GLFW_RELEASE) {
-		release_key(key);
+// Takes the input queued by the callbacks, held keys and buttons are then
+// read off input by the car handling
+void WorldSystem::process_input() {
+	// The callbacks run on this thread as well, hand over what they held back
+	input.flush();
+	input.begin_frame();
+	InputSystem::Event event;
+	while (input.poll(event)) {
+		switch (event.type) {
+		case InputSystem::EVENT_TYPE::KEY:
+			if (recorder != nullptr)
+				recorder->key(event.code, event.action, event.mods);
+			on_key(event.code, event.action, event.mods);
+			break;
+		case InputSystem::EVENT_TYPE::MOUSE_MOVE:
+			if (recorder != nullptr)
+				recorder->mouse_move(event.position);
+			break;
+		case InputSystem::EVENT_TYPE::BUTTON:
+			if (recorder != nullptr)
+				recorder->mouse_button(event.code, event.action);
+			break;
+		}
 	}
+}
 
+// Key presses that do more than steer
+void WorldSystem::on_key(int key, int action, int mod) {
 	// Turning on advanced mode
 	if (action == GLFW_RELEASE && key == GLFW_KEY_A) {
 		std::cout << "Advanced Mode";
@@ -557,9 +582,6 @@ void WorldSystem::on_key(int key, int, int action, int mod) {
 
 	// Resetting game
 	if (action == GLFW_RELEASE && key == GLFW_KEY_R) {
-		int w, h;
-		glfwGetWindowSize(window, &w, &h);
-
         restart_game();
 	}
 
@@ -586,4 +608,12 @@ void WorldSystem::on_key(int key, int, int action, int mod) {
 		printf("Current speed = %f\n", current_speed);
 	}
 	current_speed = fmax(0.f, current_speed);
+
+#ifdef PROFILER
+	// Save what the profiler has recorded so far
+	if (action == GLFW_RELEASE && key == GLFW_KEY_P) {
+		if (profiler::write_chrome_trace("trace.json"))
+			printf("Saved the profile to trace.json\n");
+	}
+#endif
 }
\ No newline at end of file
@@ -7,26 +7,27 @@
 #include <vector>
 #include <random>
 
-#define SDL_MAIN_HANDLED
-#include <SDL.h>
-#include <SDL_mixer.h>
-
+#include "audio_backend.hpp"
+#include "input_recording.hpp"
+#include "input_system.hpp"
+#include "prefab.hpp"
 #include "render_system.hpp"
 
+class PhysicsSystem;
+
 // Container for all our entities and game logic. Individual rendering / update is
 // deferred to the relative update() methods
 class WorldSystem
 {
 public:
-	static std::unordered_map<int, bool> button_map;
-
 	WorldSystem();
 
-	// Creates a window
+	// Creates a window, optional: without one the game only runs on injected input
 	GLFWwindow* create_window();
 
-	// starts the game
-	void init(RenderSystem* renderer);
+	// starts the game. renderer is only used for the debug stats in the window
+	// title and may be nullptr, like the window in headless runs.
+	void init(RenderAssets* assets, PhysicsSystem* physics, AudioBackend* audio, RenderSystem* renderer = nullptr);
 
 	// Releases all associated resources
 	~WorldSystem();
@@ -46,54 +47,65 @@ public:
 	bool is_over()const;
 
 	// Ends the game
-	void end_game() const;
+	void end_game();
 
 	// Returns the number of points
 	static int get_points();
 
-private:
-	// Input callback functions
-	void on_key(int key, int, int action, int mod);
-	static void on_mouse_move(vec2 pos);
+	// Input as the GLFW callbacks would deliver it, for scripted runs without a window
+	void inject_key(int key, int action, int mods) { input.push_key(key, action, mods); }
+	void inject_mouse_move(vec2 pos) { input.push_mouse_move(pos); }
+	void inject_mouse_button(int button, int action) { input.push_mouse_button(button, action, 0); }
 
-	void on_mouse_click(int button, int action, int mods);
+	// All input and the elapsed time of every step go to the recorder if there is one
+	void set_recorder(InputRecorder* recorder_arg) { recorder = recorder_arg; }
+	// False while a replay drives the world, the window then only listens for escape
+	void set_live_input(bool live) { live_input = live; }
 
-	static void click_button(int button);
-	static void release_button(int button);
-	static bool button_clicked(int button);
+	// Seeds the random spawns, set before init() to replay a recording
+	void set_seed(uint32_t seed_arg);
+	uint32_t get_seed() const { return seed; }
 
-	static void press_key(int key);
-	static void release_key(int key);
-	static bool key_pressed(int key);
-
-	static vec2 get_mouse_position();
+private:
+	// Applies the input queued since the last step
+	void process_input();
+	void on_key(int key, int action, int mod);
 
 	// restart level
 	void restart_game();
 
-	// OpenGL window handle
+	// OpenGL window handle, nullptr when headless
 	GLFWwindow* window;
+	bool over;
+	bool live_input;
+	InputRecorder* recorder;
 
 	// Number of bonuses collected by the bar, displayed in the window title
 	static unsigned int points;
 
 	// Game state
+	RenderAssets* assets;
+	PhysicsSystem* physics;
+	AudioBackend* audio;
 	RenderSystem* renderer;
 	float current_speed;
 	float next_barrier_spawn;
 	float next_bonus_spawn;
+	float next_traffic_spawn;
 	Entity player_car;
 	Entity title;
-	static std::unordered_map<int, bool> key_map;
-	static vec2 mouse_pos;
+	Prefab barrier_prefab;
+	Prefab bonus_prefab;
+	Prefab traffic_prefab;
+	InputSystem input;
 	static float target_angle;
 
-	// music references
-	Mix_Music* background_music;
-	Mix_Chunk* car_crash_sound;
-	Mix_Chunk* point_scored_sound;
+	// reused result buffer for spatial queries
+	std::vector<Entity> spawn_overlaps;
+
 
 	// C++ random number generator
+	uint32_t seed;
 	std::default_random_engine rng;
 	std::uniform_real_distribution<float> uniform_dist; // number between 0..1
 };
@@ -0,0 +1,40 @@
+// Offline packer: loads the loose textures, meshes and shaders the way the game
+// does, and writes the result into one archive the game memory maps at startup.
+//
+// usage: asset_packer <resources dir with data/ and shaders/> <output .pak>
+
+// stlib
+#include <chrono>
+#include <cstdio>
+
+// internal
+#include "render_assets.hpp"
+
+int main(int argc, char* argv[])
+{
+	if (argc != 3)
+	{
+		fprintf(stderr, "usage: %s <resources dir> <output .pak>\n", argv[0]);
+		return 1;
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	RenderAssets assets;
+	assets.resources_dir = argv[1];
+	assets.use_archive = false;
+	if (!assets.load())
+	{
+		fprintf(stderr, "Could not load the assets from %s\n", argv[1]);
+		return 1;
+	}
+	if (!assets.writeArchive(argv[2]))
+	{
+		fprintf(stderr, "Could not write %s\n", argv[2]);
+		return 1;
+	}
+
+	const float elapsed_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	printf("Packed %u atlas pages, %d textures and %d geometries into %s in %.1f ms\n",
+		(uint)assets.atlas_pages.size(), texture_count, geometry_count, argv[2], elapsed_ms);
+	return 0;
+}
@@ -0,0 +1,183 @@
+// Checks the texture atlas: SkylinePacker and pack_atlas never overlap two rects
+// or let one hang off its page, blit_to_atlas repeats the border pixels out
+// through the 2 px padding without touching anything past it, and
+// atlas_uv_rect sends the centre of every sprite texel to the centre of its
+// texel in the page.
+// Exits with 0 if every check passed, 1 otherwise.
+//
+// usage: atlas_check
+
+// stlib
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+// internal
+#include "texture_atlas.hpp"
+
+namespace {
+	int failures = 0;
+
+	void check(bool ok, const char* what) {
+		printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+		if (!ok)
+			failures++;
+	}
+
+	const int padding = 2; // as RenderAssets::atlas_padding
+	const unsigned char untouched = 0xcd;
+
+	bool overlap(ivec2 a_position, ivec2 a_size, ivec2 b_position, ivec2 b_size) {
+		return a_position.x < b_position.x + b_size.x && b_position.x < a_position.x + a_size.x &&
+			a_position.y < b_position.y + b_size.y && b_position.y < a_position.y + a_size.y;
+	}
+
+	bool inside(ivec2 position, ivec2 size, ivec2 page_size) {
+		return position.x >= 0 && position.y >= 0 &&
+			position.x + size.x <= page_size.x && position.y + size.y <= page_size.y;
+	}
+
+	// Random sizes from tiny to larger than the starting page
+	std::vector<ivec2> random_sizes(size_t count, int max_size, unsigned seed) {
+		std::default_random_engine rng(seed);
+		std::uniform_int_distribution<int> dist(1, max_size);
+		std::vector<ivec2> sizes(count);
+		for (ivec2& size : sizes)
+			size = { dist(rng), dist(rng) };
+		return sizes;
+	}
+
+	// Fills one page until it is full, true if nothing overlaps or hangs off it
+	bool skyline_packs_apart(unsigned seed) {
+		ivec2 page_size = { 256, 256 };
+		SkylinePacker packer(page_size);
+		std::vector<ivec2> sizes = random_sizes(1000, 40, seed);
+		std::vector<ivec2> positions;
+		std::vector<ivec2> packed;
+		for (ivec2 size : sizes) {
+			ivec2 position;
+			if (!packer.insert(size, position))
+				continue;
+			if (!inside(position, size, page_size))
+				return false;
+			for (size_t i = 0; i < packed.size(); i++)
+				if (overlap(position, size, positions[i], packed[i]))
+					return false;
+			positions.push_back(position);
+			packed.push_back(size);
+		}
+		return packed.size() > 1;
+	}
+
+	// Same for pack_atlas over several pages, with the padding around each rect
+	bool atlas_packs_apart(const std::vector<ivec2>& sizes, const std::vector<AtlasRect>& rects, ivec2 page_size, int page_count) {
+		ivec2 pad = { padding, padding };
+		for (size_t i = 0; i < rects.size(); i++) {
+			if (rects[i].page < 0 || rects[i].page >= page_count || rects[i].size.x != sizes[i].x || rects[i].size.y != sizes[i].y)
+				return false;
+			if (!inside(rects[i].position - pad, rects[i].size + pad + pad, page_size))
+				return false;
+			for (size_t j = 0; j < i; j++)
+				if (rects[j].page == rects[i].page &&
+					overlap(rects[i].position - pad, rects[i].size + pad + pad, rects[j].position - pad, rects[j].size + pad + pad))
+					return false;
+		}
+		return true;
+	}
+
+	// A pixel no two images or texels share
+	void fill_image(std::vector<unsigned char>& rgba, ivec2 size, size_t image) {
+		rgba.resize((size_t)size.x * size.y * 4);
+		for (int y = 0; y < size.y; y++)
+			for (int x = 0; x < size.x; x++) {
+				unsigned char* pixel = &rgba[((size_t)y * size.x + x) * 4];
+				pixel[0] = (unsigned char)x;
+				pixel[1] = (unsigned char)y;
+				pixel[2] = (unsigned char)image;
+				pixel[3] = (unsigned char)(image >> 8);
+			}
+	}
+
+	// Blits every image into its page, then checks each texel of the page:
+	// inside a rect it is the image's, in the padding the nearest border pixel
+	// of that image, and everywhere else untouched
+	bool blits_extrude(const std::vector<ivec2>& sizes, const std::vector<AtlasRect>& rects, ivec2 page_size, int page_count) {
+		size_t page_bytes = (size_t)page_size.x * page_size.y * 4;
+		std::vector<unsigned char> pages(page_bytes * page_count, untouched);
+		std::vector<std::vector<unsigned char>> images(sizes.size());
+		for (size_t i = 0; i < sizes.size(); i++) {
+			fill_image(images[i], sizes[i], i);
+			blit_to_atlas(&pages[page_bytes * rects[i].page], page_size, images[i].data(), rects[i], padding);
+		}
+
+		std::vector<int> owner(page_bytes / 4 * page_count, -1);
+		for (size_t i = 0; i < rects.size(); i++) {
+			const AtlasRect& rect = rects[i];
+			for (int y = -padding; y < rect.size.y + padding; y++)
+				for (int x = -padding; x < rect.size.x + padding; x++) {
+					size_t texel = (size_t)rect.page * page_size.x * page_size.y +
+						(size_t)(rect.position.y + y) * page_size.x + rect.position.x + x;
+					int src_x = std::min(std::max(x, 0), rect.size.x - 1);
+					int src_y = std::min(std::max(y, 0), rect.size.y - 1);
+					const unsigned char* expected = &images[i][((size_t)src_y * rect.size.x + src_x) * 4];
+					if (memcmp(&pages[texel * 4], expected, 4) != 0)
+						return false;
+					owner[texel] = (int)i;
+				}
+		}
+		for (size_t texel = 0; texel < owner.size(); texel++)
+			if (owner[texel] < 0)
+				for (int c = 0; c < 4; c++)
+					if (pages[texel * 4 + c] != untouched)
+						return false;
+		return true;
+	}
+
+	// The sprite quad's texcoords run 0 ... 1 over the image, so the centre of
+	// texel x sits at (x + 0.5) / width. Mapped through the uv rect it has to
+	// land on the centre of the same texel in the page, not between two.
+	bool uvs_hit_texel_centres(const std::vector<AtlasRect>& rects, ivec2 page_size) {
+		const float tolerance = 1e-3f; // of a texel
+		for (const AtlasRect& rect : rects) {
+			vec4 uv = atlas_uv_rect(rect, page_size);
+			for (int x = 0; x < rect.size.x; x++) {
+				float u = uv.x + uv.z * (x + 0.5f) / rect.size.x;
+				if (std::fabs(u * page_size.x - (rect.position.x + x + 0.5f)) > tolerance)
+					return false;
+			}
+			for (int y = 0; y < rect.size.y; y++) {
+				float v = uv.y + uv.w * (y + 0.5f) / rect.size.y;
+				if (std::fabs(v * page_size.y - (rect.position.y + y + 0.5f)) > tolerance)
+					return false;
+			}
+		}
+		return true;
+	}
+}
+
+int main()
+{
+	bool apart = true;
+	for (unsigned seed = 1; seed <= 20; seed++)
+		apart = apart && skyline_packs_apart(seed);
+	check(apart, "SkylinePacker never overlaps two rects or leaves the page");
+
+	// More than fits on one page, some larger than the starting page
+	std::vector<ivec2> sizes = random_sizes(300, 80, 7);
+	sizes.push_back({ 300, 20 });
+	ivec2 page_size = { 256, 256 };
+	int page_count = 0;
+	std::vector<AtlasRect> rects = pack_atlas(sizes, padding, page_size, page_count);
+	check(page_count > 1 && page_size.x >= 300 + 2 * padding, "pack_atlas grows the page and adds pages");
+	bool packed_apart = atlas_packs_apart(sizes, rects, page_size, page_count);
+	check(packed_apart, "pack_atlas keeps the padding of every rect apart and on its page");
+	// blitting rects that hang off their page would write past it
+	check(packed_apart && blits_extrude(sizes, rects, page_size, page_count),
+		"blit_to_atlas repeats the border pixels through the 2 px padding and no further");
+	check(uvs_hit_texel_centres(rects, page_size), "atlas_uv_rect maps sprite texel centres onto page texel centres");
+
+	printf("%d checks failed\n", failures);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,128 @@
+// Compares frames captured by the headless mode against golden images, for
+// visual regression checks on machines without a GPU. Capture with
+//   crashy_cars --headless --seed 1 --steps 120 --capture-every 30 --capture out
+// and compare with
+//   golden_compare golden out $(cd golden && ls *.png)
+// To accept a change, copy the captures over the golden images.
+//
+// A pixel differs when any channel is off by more than --tolerance (0..255).
+// A frame fails when more than --max-bad of its pixels (a fraction) differ, or
+// when it is missing or has another size. With --diff DIR every failing frame
+// gets an image there that shows the differing pixels in red.
+// Exits with 0 if all frames match, 1 if any failed, 2 on bad arguments.
+//
+// usage: golden_compare [--tolerance T] [--max-bad F] [--diff DIR] GOLDEN_DIR CAPTURE_DIR NAME...
+
+// stlib
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// internal
+#include "png_writer.hpp"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+namespace {
+	struct Image
+	{
+		ivec2 size = { 0, 0 };
+		stbi_uc* pixels = nullptr;
+		~Image() { stbi_image_free(pixels); }
+		bool load(const std::string& path) {
+			pixels = stbi_load(path.c_str(), &size.x, &size.y, NULL, 4);
+			if (pixels == nullptr)
+				fprintf(stderr, "Failed to read %s: %s\n", path.c_str(), stbi_failure_reason());
+			return pixels != nullptr;
+		}
+	};
+
+	void print_usage() {
+		fprintf(stderr, "usage: golden_compare [--tolerance T] [--max-bad F] [--diff DIR] GOLDEN_DIR CAPTURE_DIR NAME...\n");
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	int tolerance = 2;
+	double max_bad = 0.001;
+	std::string diff_dir;
+	std::vector<const char*> positional;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc)
+			tolerance = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--max-bad") == 0 && i + 1 < argc)
+			max_bad = atof(argv[++i]);
+		else if (strcmp(argv[i], "--diff") == 0 && i + 1 < argc)
+			diff_dir = argv[++i];
+		else if (strncmp(argv[i], "--", 2) == 0) {
+			print_usage();
+			return 2;
+		}
+		else
+			positional.push_back(argv[i]);
+	}
+	if (positional.size() < 3 || tolerance < 0 || max_bad < 0.) {
+		print_usage();
+		return 2;
+	}
+	std::string golden_dir = positional[0];
+	std::string capture_dir = positional[1];
+
+	int failed = 0;
+	for (size_t n = 2; n < positional.size(); n++) {
+		std::string name = positional[n];
+		Image golden, capture;
+		if (!golden.load(golden_dir + "/" + name) || !capture.load(capture_dir + "/" + name)) {
+			printf("FAIL %s: missing\n", name.c_str());
+			failed++;
+			continue;
+		}
+		if (golden.size.x != capture.size.x || golden.size.y != capture.size.y) {
+			printf("FAIL %s: %d x %d, expected %d x %d\n", name.c_str(),
+				capture.size.x, capture.size.y, golden.size.x, golden.size.y);
+			failed++;
+			continue;
+		}
+
+		size_t count = (size_t)golden.size.x * golden.size.y;
+		size_t bad = 0;
+		int worst = 0;
+		std::vector<unsigned char> diff(count * 4);
+		for (size_t p = 0; p < count; p++) {
+			const stbi_uc* a = golden.pixels + p * 4;
+			const stbi_uc* b = capture.pixels + p * 4;
+			int delta = 0;
+			for (int c = 0; c < 4; c++)
+				delta = std::max(delta, std::abs((int)a[c] - (int)b[c]));
+			worst = std::max(worst, delta);
+			unsigned char* d = &diff[p * 4];
+			if (delta > tolerance) {
+				bad++;
+				d[0] = 255; d[1] = 0; d[2] = 0;
+			}
+			else {
+				// the golden image, dimmed, to see where the red is
+				d[0] = a[0] / 4; d[1] = a[1] / 4; d[2] = a[2] / 4;
+			}
+			d[3] = 255;
+		}
+
+		double fraction = (double)bad / count;
+		bool ok = fraction <= max_bad;
+		printf("%s %s: %zu pixels differ (%.4f%%), largest difference %d\n",
+			ok ? "ok  " : "FAIL", name.c_str(), bad, fraction * 100., worst);
+		if (!ok) {
+			failed++;
+			if (!diff_dir.empty() && !write_png(diff_dir + "/" + name, diff.data(), golden.size))
+				fprintf(stderr, "Failed to write the diff of %s\n", name.c_str());
+		}
+	}
+
+	printf("%d of %d frames failed\n", failed, (int)positional.size() - 2);
+	return failed == 0 ? 0 : 1;
+}
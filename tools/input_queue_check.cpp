@@ -0,0 +1,111 @@
+// Checks the input event queue: values cross SpscQueue between two threads
+// complete and in order, and InputSystem never loses a key release, whether the
+// queue filled up with mouse moves or with key events. Build it with
+// -fsanitize=thread as well to have the queue checked for data races.
+// Exits with 0 if every check passed, 1 otherwise.
+//
+// usage: input_queue_check
+
+// stlib
+#include <cstdio>
+#include <thread>
+
+// internal
+#include "input_system.hpp"
+
+namespace {
+	int failures = 0;
+
+	void check(bool ok, const char* what) {
+		printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+		if (!ok)
+			failures++;
+	}
+
+	// One thread pushes count numbers, spinning while the queue is full, the
+	// other pops them and checks they come in order
+	bool spsc_in_order(size_t count) {
+		static SpscQueue<size_t, 64> queue;
+		std::thread producer([count]() {
+			for (size_t i = 0; i < count; i++)
+				while (!queue.push(i))
+					std::this_thread::yield();
+		});
+		bool in_order = true;
+		size_t expected = 0;
+		while (expected < count) {
+			size_t value;
+			if (!queue.pop(value)) {
+				std::this_thread::yield();
+				continue;
+			}
+			in_order = in_order && value == expected;
+			expected++;
+		}
+		producer.join();
+		size_t extra;
+		return in_order && !queue.pop(extra);
+	}
+
+	// Drains the queue like WorldSystem::process_input(), returns the events seen
+	size_t drain(InputSystem& input) {
+		input.flush();
+		input.begin_frame();
+		InputSystem::Event event;
+		size_t events = 0;
+		while (input.poll(event))
+			events++;
+		return events;
+	}
+}
+
+int main()
+{
+	check(spsc_in_order(1000000), "SpscQueue keeps 1000000 values in order across threads");
+
+	{
+		SpscQueue<int, 8> queue;
+		int pushed = 0;
+		while (queue.push(pushed, 2))
+			pushed++;
+		check(pushed == 5 && queue.push(pushed) && queue.push(pushed) && !queue.push(pushed),
+			"SpscQueue push keeps the requested slots free");
+	}
+
+	{
+		// Far more mouse moves than the queue holds between a press and a release
+		InputSystem input;
+		input.push_key(GLFW_KEY_UP, GLFW_PRESS, 0);
+		for (int i = 0; i < 10000; i++)
+			input.push_mouse_move({ (float)i, 0.f });
+		input.push_key(GLFW_KEY_UP, GLFW_RELEASE, 0);
+		drain(input);
+		check(input.pressed(GLFW_KEY_UP) && input.released(GLFW_KEY_UP) && !input.held(GLFW_KEY_UP),
+			"a release after a flood of mouse moves arrives in the same frame");
+		check(input.mouse_position().x == 9999.f, "the last mouse move arrives");
+		check(input.get_coalesced() > 0, "mouse moves that didn't fit are coalesced");
+	}
+
+	{
+		// More key events than the queue holds, they come over several frames
+		InputSystem input;
+		const size_t repeats = 1000;
+		input.push_key(GLFW_KEY_UP, GLFW_PRESS, 0);
+		for (size_t i = 0; i < repeats; i++)
+			input.push_key(GLFW_KEY_UP, GLFW_REPEAT, 0);
+		input.push_key(GLFW_KEY_UP, GLFW_RELEASE, 0);
+		size_t events = drain(input);
+		check(input.pressed(GLFW_KEY_UP) && input.held(GLFW_KEY_UP), "the press arrives first");
+		int frames = 1;
+		while (!input.released(GLFW_KEY_UP) && frames < 100) {
+			events += drain(input);
+			frames++;
+		}
+		check(input.released(GLFW_KEY_UP) && !input.held(GLFW_KEY_UP),
+			"a release behind a full queue of key events arrives");
+		check(events == repeats + 2, "no key event is lost");
+	}
+
+	printf("%d checks failed\n", failures);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,73 @@
+// Per entity cost of building sprite model matrices: the Transform chain the
+// renderer used to run per draw item, against compute_transforms() writing
+// straight into an array of instances.
+//
+// usage: transform_benchmark [sprites]
+
+// stlib
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+// internal
+#include "components.hpp"
+#include "transform_batch.hpp"
+
+namespace {
+	double elapsed_ns(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const size_t count = argc > 1 ? (size_t)atol(argv[1]) : 10000;
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> unit(0.f, 1.f);
+	TransformBatch batch;
+	for (size_t i = 0; i < count; i++)
+		batch.push({ unit(random) * window_width_px, unit(random) * window_height_px },
+			{ 20.f + unit(random) * 200.f, 20.f + unit(random) * 100.f }, (unit(random) - 0.5f) * 4.f * (float)M_PI);
+
+	std::vector<mat3> matrices(count);
+	std::vector<SpriteInstance> instances(count);
+	const int runs = 200;
+	double chain_ns = 1e30, batch_ns = 1e30;
+	for (int run = 0; run < runs; run++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < count; i++)
+		{
+			Transform transform;
+			transform.translate(batch.positions[i]);
+			transform.rotate(batch.angles[i]);
+			transform.scale(batch.scales[i]);
+			matrices[i] = transform.mat;
+		}
+		chain_ns = std::min(chain_ns, elapsed_ns(start));
+
+		start = std::chrono::steady_clock::now();
+		compute_transforms(batch, &instances[0].transform, sizeof(SpriteInstance));
+		batch_ns = std::min(batch_ns, elapsed_ns(start));
+	}
+
+	// Error relative to the size of the sprite, the translation is exact
+	float max_error = 0.f;
+	for (size_t i = 0; i < count; i++)
+	{
+		const mat3 batched = instances[i].transform.to_mat3();
+		for (int column = 0; column < 2; column++)
+			for (int row = 0; row < 2; row++)
+				max_error = std::max(max_error, std::abs(batched[column][row] - matrices[i][column][row]) / batch.scales[i][column]);
+		max_error = std::max(max_error, std::abs(batched[2][0] - matrices[i][2][0]) + std::abs(batched[2][1] - matrices[i][2][1]));
+	}
+
+	printf("%zu sprites, best of %d runs\n", count, runs);
+	printf("Transform chain:    %8.1f us, %6.2f ns per sprite\n", chain_ns / 1000.0, chain_ns / count);
+	printf("compute_transforms: %8.1f us, %6.2f ns per sprite, %.1fx\n", batch_ns / 1000.0, batch_ns / count, chain_ns / batch_ns);
+	printf("Largest difference per unit of scale: %g\n", max_error);
+	return 0;
+}